@@ -1,7 +1,16 @@
 #include <dawgdic/dawg-builder.h>
 #include <dawgdic/dictionary-builder.h>
+#include <dawgdic/dictionary-file-writer.h>
+#include <dawgdic/external-dawg-builder.h>
+#include <dawgdic/external-dictionary-builder.h>
 #include <dawgdic/guide-builder.h>
+#include <dawgdic/ordinal-table-builder.h>
+#include <dawgdic/parallel-dawg-builder.h>
 #include <dawgdic/ranked-guide-builder.h>
+#include <dawgdic/sorted-key-feeder.h>
+#include <dawgdic/value-table-builder.h>
+
+#include <sys/resource.h>
 
 #include <cstdlib>
 #include <fstream>
@@ -15,7 +24,12 @@ class CommandOptions {
  public:
   CommandOptions()
     : help_(false), tab_(false), guide_(false), ranked_(false),
-      lexicon_file_name_(), dic_file_name_() {}
+      container_(false), ordinal_(false), best_(false), wide_(false),
+      num_threads_(1),
+      memory_budget_(0), unsorted_(false),
+      policy_(dawgdic::SortedKeyFeeder::KEEP_LAST),
+      lexicon_file_name_(), dic_file_name_(),
+      profile_file_name_() {}
 
   // Reads options.
   bool help() const {
@@ -30,18 +44,46 @@ class CommandOptions {
   bool ranked() const {
     return ranked_;
   }
+  bool container() const {
+    return container_;
+  }
+  bool ordinal() const {
+    return ordinal_;
+  }
+  bool best() const {
+    return best_;
+  }
+  bool wide() const {
+    return wide_;
+  }
+  std::size_t num_threads() const {
+    return num_threads_;
+  }
+  std::size_t memory_budget() const {
+    return memory_budget_;
+  }
+  bool unsorted() const {
+    return unsorted_;
+  }
+  dawgdic::SortedKeyFeeder::DuplicatePolicy policy() const {
+    return policy_;
+  }
   const std::string &lexicon_file_name() const {
     return lexicon_file_name_;
   }
   const std::string &dic_file_name() const {
     return dic_file_name_;
   }
+  const std::string &profile_file_name() const {
+    return profile_file_name_;
+  }
 
   bool Parse(int argc, char *argv[]) {
     for (int i = 1; i < argc; ++i) {
       // Parses options.
       if (argv[i][0] == '-' && argv[i][1] != '\0') {
-        for (int j = 1; argv[i][j] != '\0'; ++j) {
+        bool has_argument = false;
+        for (int j = 1; !has_argument && argv[i][j] != '\0'; ++j) {
           switch (argv[i][j]) {
             case 'h': {
               help_ = true;
@@ -59,6 +101,56 @@ class CommandOptions {
               ranked_ = true;
               break;
             }
+            case 'c': {
+              container_ = true;
+              break;
+            }
+            case 'o': {
+              ordinal_ = true;
+              break;
+            }
+            case 'b': {
+              best_ = true;
+              ranked_ = true;
+              break;
+            }
+            case 'w': {
+              wide_ = true;
+              break;
+            }
+            case 'j': {
+              if (!ReadNumber(argc, argv, &i, j, &num_threads_)) {
+                return false;
+              }
+              has_argument = true;
+              break;
+            }
+            case 'm': {
+              if (!ReadSize(argc, argv, &i, j, &memory_budget_)) {
+                return false;
+              }
+              has_argument = true;
+              break;
+            }
+            case 'u': {
+              unsorted_ = true;
+              break;
+            }
+            case 'd': {
+              if (!ReadPolicy(argc, argv, &i, j, &policy_)) {
+                return false;
+              }
+              unsorted_ = true;
+              has_argument = true;
+              break;
+            }
+            case 'p': {
+              if (!ReadArgument(argc, argv, &i, j, &profile_file_name_)) {
+                return false;
+              }
+              has_argument = true;
+              break;
+            }
             default: {
               // Invalid option.
               return false;
@@ -82,6 +174,21 @@ class CommandOptions {
     if (dic_file_name_.empty()) {
       dic_file_name_ = "-";
     }
+
+    // Wide values are interned before sorting, so only their order of
+    // occurrence is available.
+    if (wide_ && unsorted_ &&
+        (policy_ == dawgdic::SortedKeyFeeder::KEEP_MAX ||
+         policy_ == dawgdic::SortedKeyFeeder::SUM_VALUES)) {
+      return false;
+    }
+
+    // A dictionary within a memory budget is written while it is built,
+    // so structures built from a dictionary in memory are not available.
+    if (memory_budget_ != 0 &&
+        (guide_ || ranked_ || container_ || ordinal_ || best_ || wide_)) {
+      return false;
+    }
     return true;
   }
 
@@ -92,7 +199,19 @@ class CommandOptions {
                "  -h  display this help and exit\n"
                "  -t  handle tab as separator\n"
                "  -g  build dictionary with guide\n"
-               "  -r  build dictionary with ranked guide\n";
+               "  -r  build dictionary with ranked guide\n"
+               "  -c  write dictionary in container format\n"
+               "  -o  build ordinal table (implies -c)\n"
+               "  -b  build best value table (implies -r -c)\n"
+               "  -w  store 64-bit values in value table (implies -t -c)\n"
+               "  -j  build dawg with worker threads (-j NumThreads)\n"
+               "  -m  build dictionary within memory budget, using TMPDIR\n"
+               "      (-m Bytes[K|M|G], not with -g -r -c -o -b -w)\n"
+               "  -u  sort keys and resolve duplicate keys\n"
+               "  -d  resolve duplicate keys by policy (implies -u)\n"
+               "      (-d first|last|max|sum, default: last)\n"
+               "  -p  pack keys in ProfileFile into hot region\n"
+               "      (-p ProfileFile)\n";
     *output << std::endl;
   }
 
@@ -101,18 +220,164 @@ private:
   bool tab_;
   bool guide_;
   bool ranked_;
+  bool container_;
+  bool ordinal_;
+  bool best_;
+  bool wide_;
+  std::size_t num_threads_;
+  std::size_t memory_budget_;
+  bool unsorted_;
+  dawgdic::SortedKeyFeeder::DuplicatePolicy policy_;
   std::string lexicon_file_name_;
   std::string dic_file_name_;
+  std::string profile_file_name_;
 
   // Disallows copies.
   CommandOptions(const CommandOptions &);
   CommandOptions &operator=(const CommandOptions &);
+
+  // Reads an argument of an option from the rest of the current argument
+  // or the next argument.
+  static bool ReadArgument(int argc, char *argv[], int *i, int j,
+                           std::string *argument) {
+    if (argv[*i][j + 1] != '\0') {
+      *argument = &argv[*i][j + 1];
+    } else if (*i + 1 < argc) {
+      *argument = argv[++*i];
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  // Reads a positive number of an option from the rest of the current
+  // argument or the next argument.
+  static bool ReadNumber(int argc, char *argv[], int *i, int j,
+                         std::size_t *number) {
+    std::string argument;
+    if (!ReadArgument(argc, argv, i, j, &argument)) {
+      return false;
+    }
+
+    char *end = NULL;
+    unsigned long value = std::strtoul(argument.c_str(), &end, 10);
+    if (*end != '\0' || value == 0) {
+      return false;
+    }
+    *number = static_cast<std::size_t>(value);
+    return true;
+  }
+
+  // Reads a positive size of an option with an optional unit, such as 64M.
+  static bool ReadSize(int argc, char *argv[], int *i, int j,
+                       std::size_t *size) {
+    std::string argument;
+    if (!ReadArgument(argc, argv, i, j, &argument)) {
+      return false;
+    }
+
+    char *end = NULL;
+    unsigned long value = std::strtoul(argument.c_str(), &end, 10);
+    int shift = 0;
+    switch (*end) {
+      case 'K':
+      case 'k': {
+        shift = 10;
+        ++end;
+        break;
+      }
+      case 'M':
+      case 'm': {
+        shift = 20;
+        ++end;
+        break;
+      }
+      case 'G':
+      case 'g': {
+        shift = 30;
+        ++end;
+        break;
+      }
+    }
+    if (*end != '\0' || value == 0) {
+      return false;
+    }
+    *size = static_cast<std::size_t>(value) << shift;
+    return true;
+  }
+
+  // Reads a policy for duplicate keys.
+  static bool ReadPolicy(int argc, char *argv[], int *i, int j,
+                         dawgdic::SortedKeyFeeder::DuplicatePolicy *policy) {
+    std::string argument;
+    if (!ReadArgument(argc, argv, i, j, &argument)) {
+      return false;
+    }
+
+    if (argument == "first") {
+      *policy = dawgdic::SortedKeyFeeder::KEEP_FIRST;
+    } else if (argument == "last") {
+      *policy = dawgdic::SortedKeyFeeder::KEEP_LAST;
+    } else if (argument == "max") {
+      *policy = dawgdic::SortedKeyFeeder::KEEP_MAX;
+    } else if (argument == "sum") {
+      *policy = dawgdic::SortedKeyFeeder::SUM_VALUES;
+    } else {
+      return false;
+    }
+    return true;
+  }
+};
+
+// Builder which sorts keys and resolves duplicate keys with a
+// SortedKeyFeeder, and then inserts them into another builder. Within a
+// memory budget, a run of keys takes half of it, because the last run is
+// kept while keys are inserted into the builder.
+template <typename BUILDER_TYPE>
+class SortingBuilder {
+ public:
+  SortingBuilder(const CommandOptions &options, BUILDER_TYPE *builder)
+    : feeder_(options.policy(), options.num_threads(),
+              (options.memory_budget() != 0) ? (options.memory_budget() / 2) :
+              static_cast<std::size_t>(
+                  dawgdic::SortedKeyFeeder::DEFAULT_RUN_SIZE)),
+      builder_(builder) {}
+
+  bool Insert(const char *key, dawgdic::ValueType value = 0) {
+    return feeder_.Insert(key, value);
+  }
+  bool Insert(const char *key, std::size_t length, dawgdic::ValueType value) {
+    return feeder_.Insert(key, length, value);
+  }
+
+  template <typename DAWG_TYPE>
+  bool Finish(DAWG_TYPE *dawg) {
+    if (!feeder_.Feed(builder_)) {
+      return false;
+    }
+    std::cerr << "no. sorted runs: "
+              << feeder_.num_of_spilled_runs() << std::endl;
+    std::cerr << "no. duplicate keys: "
+              << feeder_.num_of_duplicates() << std::endl;
+    return builder_->Finish(dawg);
+  }
+
+ private:
+  dawgdic::SortedKeyFeeder feeder_;
+  BUILDER_TYPE *builder_;
+
+  // Disallows copies.
+  SortingBuilder(const SortingBuilder &);
+  SortingBuilder &operator=(const SortingBuilder &);
 };
 
-// Builds a dawg from a sorted lexicon.
-bool BuildDawg(std::istream *lexicon_stream,
-               dawgdic::Dawg *dawg, bool tab_on) {
-  dawgdic::DawgBuilder dawg_builder;
+// Builds a dawg from a sorted lexicon with a builder, such as DawgBuilder
+// or ParallelDawgBuilder. If wide_values is not NULL, values are interned into
+// it, and their ids are inserted into a dawg.
+template <typename DAWG_TYPE, typename BUILDER_TYPE>
+bool BuildDawg(std::istream *lexicon_stream, DAWG_TYPE *dawg, bool tab_on,
+               dawgdic::ValueTableBuilder<dawgdic::UInt64Type> *wide_values,
+               BUILDER_TYPE *dawg_builder) {
 
   // Reads keys from an input stream and inserts them into a dawg.
   std::string key;
@@ -123,8 +388,27 @@ bool BuildDawg(std::istream *lexicon_stream,
       delim_pos = key.find_first_of('\t');
     }
 
-    if (delim_pos == std::string::npos) {
-      if (!dawg_builder.Insert(key.c_str())) {
+    if (wide_values != NULL) {
+      // A key without a value has 0 as its wide value.
+      dawgdic::UInt64Type record = 0;
+      std::size_t length = key.length();
+      if (delim_pos != std::string::npos) {
+        record = std::strtoull(key.c_str() + delim_pos + 1, NULL, 10);
+        length = delim_pos;
+      }
+
+      dawgdic::ValueType value;
+      if (!wide_values->Intern(record, &value)) {
+        std::cerr << "error: too many distinct values" << std::endl;
+        return false;
+      }
+      if (!dawg_builder->Insert(key.c_str(), length, value)) {
+        std::cerr << "error: failed to insert key: "
+                  << key << std::endl;
+        return false;
+      }
+    } else if (delim_pos == std::string::npos) {
+      if (!dawg_builder->Insert(key.c_str())) {
         std::cerr << "error: failed to insert key: "
                   << key << std::endl;
         return false;
@@ -147,7 +431,7 @@ bool BuildDawg(std::istream *lexicon_stream,
         value = MAX_VALUE;
       }
 
-      if (!dawg_builder.Insert(key.c_str(), delim_pos, value)) {
+      if (!dawg_builder->Insert(key.c_str(), delim_pos, value)) {
         std::cerr << "error: failed to insert key: "
                   << key << std::endl;
         return false;
@@ -159,7 +443,10 @@ bool BuildDawg(std::istream *lexicon_stream,
     }
   }
 
-  dawg_builder.Finish(dawg);
+  if (!dawg_builder->Finish(dawg)) {
+    std::cerr << "error: failed to build Dawg" << std::endl;
+    return false;
+  }
 
   std::cerr << "no. keys: " << key_count << std::endl;
   std::cerr << "no. states: "
@@ -176,10 +463,54 @@ bool BuildDawg(std::istream *lexicon_stream,
   return true;
 }
 
+// Builds a dawg from a lexicon, which is sorted first if it is unsorted.
+template <typename DAWG_TYPE, typename BUILDER_TYPE>
+bool BuildDawg(const CommandOptions &options, std::istream *lexicon_stream,
+               DAWG_TYPE *dawg,
+               dawgdic::ValueTableBuilder<dawgdic::UInt64Type> *wide_values,
+               BUILDER_TYPE *dawg_builder) {
+  bool tab_on = options.tab() || options.wide();
+  if (options.unsorted()) {
+    SortingBuilder<BUILDER_TYPE> sorting_builder(options, dawg_builder);
+    return BuildDawg(lexicon_stream, dawg, tab_on, wide_values,
+                     &sorting_builder);
+  }
+  return BuildDawg(lexicon_stream, dawg, tab_on, wide_values, dawg_builder);
+}
+
+// Reads keys and their optional weights from a profile.
+void ReadProfile(std::istream *profile_stream,
+                 dawgdic::AccessProfile *profile) {
+  std::string key;
+  while (std::getline(*profile_stream, key)) {
+    std::string::size_type delim_pos = key.find_first_of('\t');
+    if (delim_pos == std::string::npos) {
+      profile->Add(key.c_str(), key.length(), 1);
+    } else {
+      long long weight = std::strtoll(key.c_str() + delim_pos + 1, NULL, 10);
+      if (weight < 0) {
+        std::cerr << "warning: negative weight is replaced by 0: "
+                  << weight << std::endl;
+        weight = 0;
+      }
+      profile->Add(key.c_str(), delim_pos,
+                   static_cast<dawgdic::BaseType>(weight));
+    }
+  }
+
+  std::cerr << "no. profile keys: " << profile->size() << std::endl;
+}
+
 // Builds a dictionary from a dawg.
-bool BuildDictionary(const dawgdic::Dawg &dawg, dawgdic::Dictionary *dic) {
+bool BuildDictionary(const dawgdic::Dawg &dawg,
+                     const dawgdic::AccessProfile *profile,
+                     dawgdic::Dictionary *dic) {
   dawgdic::BaseType num_of_unused_units = 0;
-  if (!dawgdic::DictionaryBuilder::Build(dawg, dic, &num_of_unused_units)) {
+  bool is_built = (profile != NULL) ?
+      dawgdic::DictionaryBuilder::Build(dawg, *profile, dic,
+                                        &num_of_unused_units) :
+      dawgdic::DictionaryBuilder::Build(dawg, dic, &num_of_unused_units);
+  if (!is_built) {
     std::cerr << "error: failed to build Dictionary" << std::endl;
     return false;
   }
@@ -193,17 +524,23 @@ bool BuildDictionary(const dawgdic::Dawg &dawg, dawgdic::Dictionary *dic) {
   return true;
 }
 
-// Builds a ranked guide from a dawg and its dictionary.
+// Builds a ranked guide from a dawg and its dictionary. A best value
+// table is built together if given.
 bool BuildRankedGuide(const dawgdic::Dawg &dawg,
                       const dawgdic::Dictionary &dic,
-                      dawgdic::RankedGuide *guide) {
-  if (!dawgdic::RankedGuideBuilder::Build(dawg, dic, guide)) {
+                      dawgdic::RankedGuide *guide,
+                      dawgdic::BestValueTable *table) {
+  if (!dawgdic::RankedGuideBuilder::Build(dawg, dic, guide, table)) {
     std::cerr << "failed to build RankedGuide" << std::endl;
     return false;
   }
 
   std::cerr << "no. units: " << guide->size() << std::endl;
   std::cerr << "guide size: " << guide->total_size() << std::endl;
+  if (table != NULL) {
+    std::cerr << "best value table size: " << table->total_size()
+              << std::endl;
+  }
 
   return true;
 }
@@ -222,6 +559,93 @@ bool BuildGuide(const dawgdic::Dawg &dawg,
   return true;
 }
 
+// Builds an ordinal table from a dawg and its dictionary.
+bool BuildOrdinalTable(const dawgdic::Dawg &dawg,
+                       const dawgdic::Dictionary &dic,
+                       dawgdic::OrdinalTable *table) {
+  if (!dawgdic::OrdinalTableBuilder::Build(dawg, dic, table)) {
+    std::cerr << "failed to build OrdinalTable" << std::endl;
+    return false;
+  }
+
+  std::cerr << "no. ordinals: " << table->num_of_keys() << std::endl;
+  std::cerr << "ordinal table size: " << table->total_size() << std::endl;
+
+  return true;
+}
+
+// Gets the peak resident set size of the process in KiB.
+bool GetPeakMemory(std::size_t *peak_memory) {
+  struct rusage usage;
+  if (::getrusage(RUSAGE_SELF, &usage) != 0) {
+    return false;
+  }
+  *peak_memory = static_cast<std::size_t>(usage.ru_maxrss);
+  return true;
+}
+
+// Shows the peak resident set size of the process.
+void ShowPeakMemory() {
+  std::size_t peak_memory;
+  if (GetPeakMemory(&peak_memory)) {
+    std::cerr << "peak memory: " << peak_memory << " KiB" << std::endl;
+  }
+}
+
+// Builds a dictionary within a memory budget, and writes it while it is
+// built. A sorter of keys and a dawg builder share the budget, and then
+// a dawg and a dictionary builder share it.
+bool BuildExternalDictionary(const CommandOptions &options,
+                             std::istream *lexicon_stream,
+                             const dawgdic::AccessProfile *profile,
+                             std::ostream *dic_stream) {
+  std::size_t memory_budget = options.memory_budget();
+  dawgdic::ExternalDawgBuilder dawg_builder(
+      options.unsorted() ? (memory_budget / 2) : memory_budget);
+  dawgdic::PagedDawg dawg;
+  if (!BuildDawg(options, lexicon_stream, &dawg, NULL, &dawg_builder)) {
+    return false;
+  }
+  std::cerr << "no. spilled batches: "
+            << dawg_builder.num_of_spilled_batches() << std::endl;
+  std::cerr << "no. partitions: "
+            << dawg_builder.num_of_partitions() << std::endl;
+  std::cerr << "peak dawg memory: "
+            << dawg_builder.peak_memory_usage() << std::endl;
+  if (!dawg_builder.is_within_budget()) {
+    std::cerr << "warning: dawg phase exceeded memory budget" << std::endl;
+  }
+
+  std::size_t dawg_memory = dawg.memory_usage();
+  dawgdic::ExternalDictionaryBuilder dic_builder(
+      (dawg_memory < memory_budget) ? (memory_budget - dawg_memory) : 0);
+  bool is_built = (profile != NULL) ?
+      dic_builder.Build(dawg, *profile, dic_stream) :
+      dic_builder.Build(dawg, dic_stream);
+  if (!is_built) {
+    std::cerr << "error: failed to build Dictionary" << std::endl;
+    return false;
+  }
+  double unused_ratio = 100.0 * dic_builder.num_of_unused_units() /
+      dic_builder.num_of_units();
+
+  std::cerr << "no. elements: " << dic_builder.num_of_units() << std::endl;
+  std::cerr << "no. unused elements: " << dic_builder.num_of_unused_units()
+            << " (" << unused_ratio << "%)" << std::endl;
+  std::cerr << "dictionary size: "
+            << sizeof(dawgdic::DictionaryUnit) * dic_builder.num_of_units()
+            << std::endl;
+  std::cerr << "peak dictionary memory: "
+            << dawg_memory + dic_builder.peak_memory_usage() << std::endl;
+  if (dawg_memory + dic_builder.peak_memory_usage() > memory_budget) {
+    std::cerr << "warning: dictionary phase exceeded memory budget"
+              << std::endl;
+  }
+
+  ShowPeakMemory();
+  return true;
+}
+
 }  // namespace
 
 int main(int argc, char *argv[]) {
@@ -264,36 +688,117 @@ int main(int argc, char *argv[]) {
     dic_stream = &dic_file;
   }
 
+  // Reads a profile.
+  dawgdic::AccessProfile profile;
+  const std::string &profile_file_name = options.profile_file_name();
+  if (!profile_file_name.empty()) {
+    std::ifstream profile_file(profile_file_name.c_str(), std::ios::binary);
+    if (!profile_file) {
+      std::cerr << "error: failed to open ProfileFile: "
+                << profile_file_name << std::endl;
+      return 1;
+    }
+    ReadProfile(&profile_file, &profile);
+  }
+
+  if (options.memory_budget() != 0) {
+    return BuildExternalDictionary(options, lexicon_stream,
+        profile_file_name.empty() ? NULL : &profile, dic_stream) ? 0 : 1;
+  }
+
   dawgdic::Dawg dawg;
-  if (!BuildDawg(lexicon_stream, &dawg, options.tab())) {
-    return 1;
+  dawgdic::ValueTableBuilder<dawgdic::UInt64Type> wide_value_builder;
+  dawgdic::ValueTableBuilder<dawgdic::UInt64Type> *wide_value_sink =
+      options.wide() ? &wide_value_builder : NULL;
+  if (options.num_threads() > 1) {
+    dawgdic::ParallelDawgBuilder dawg_builder(options.num_threads());
+    if (!BuildDawg(options, lexicon_stream, &dawg, wide_value_sink,
+                   &dawg_builder)) {
+      return 1;
+    }
+  } else {
+    dawgdic::DawgBuilder dawg_builder;
+    if (!BuildDawg(options, lexicon_stream, &dawg, wide_value_sink,
+                   &dawg_builder)) {
+      return 1;
+    }
+  }
+
+  dawgdic::ValueTable<dawgdic::UInt64Type> wide_values;
+  if (options.wide()) {
+    wide_value_builder.Finish(&wide_values);
+    std::cerr << "no. wide values: " << wide_values.size() << std::endl;
+    std::cerr << "value table size: "
+              << wide_values.total_size() << std::endl;
   }
 
   dawgdic::Dictionary dic;
-  if (!BuildDictionary(dawg, &dic)) {
+  if (!BuildDictionary(dawg, profile_file_name.empty() ? NULL : &profile,
+                       &dic)) {
     return 1;
   }
 
+  // Builds a guide.
+  dawgdic::Guide guide;
+  dawgdic::RankedGuide ranked_guide;
+  dawgdic::BestValueTable best_value_table;
+  if (options.ranked()) {
+    if (!BuildRankedGuide(dawg, dic, &ranked_guide,
+                          options.best() ? &best_value_table : NULL)) {
+      return 1;
+    }
+  } else if (options.guide()) {
+    if (!BuildGuide(dawg, dic, &guide)) {
+      return 1;
+    }
+  }
+
+  // Builds an ordinal table.
+  dawgdic::OrdinalTable ordinal_table;
+  if (options.ordinal()) {
+    if (!BuildOrdinalTable(dawg, dic, &ordinal_table)) {
+      return 1;
+    }
+  }
+
+  ShowPeakMemory();
+
+  if (options.container() || options.ordinal() || options.best() ||
+      options.wide()) {
+    dawgdic::DictionaryFileWriter writer;
+    writer.Add(dic);
+    if (options.ranked()) {
+      writer.Add(ranked_guide);
+    } else if (options.guide()) {
+      writer.Add(guide);
+    }
+    if (options.ordinal()) {
+      writer.Add(ordinal_table);
+    }
+    if (options.best()) {
+      writer.Add(best_value_table);
+    }
+    if (options.wide()) {
+      writer.Add(wide_values);
+    }
+    if (!writer.Write(dic_stream)) {
+      std::cerr << "error: failed to write DicFile" << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
   if (!dic.Write(dic_stream)) {
     std::cerr << "error: failed to write Dictionary" << std::endl;
     return 1;
   }
 
-  // Builds a guide.
   if (options.ranked()) {
-    dawgdic::RankedGuide guide;
-    if (!BuildRankedGuide(dawg, dic, &guide)) {
-      return 1;
-    }
-    if (!guide.Write(dic_stream)) {
+    if (!ranked_guide.Write(dic_stream)) {
       std::cerr << "error: failed to write RankedGuide" << std::endl;
       return 1;
     }
   } else if (options.guide()) {
-    dawgdic::Guide guide;
-    if (!BuildGuide(dawg, dic, &guide)) {
-      return 1;
-    }
     if (!guide.Write(dic_stream)) {
       std::cerr << "error: failed to write Guide" << std::endl;
       return 1;
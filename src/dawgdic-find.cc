@@ -1,6 +1,10 @@
 #include <dawgdic/completer.h>
 #include <dawgdic/dictionary.h>
+#include <dawgdic/dictionary-file.h>
+#include <dawgdic/ordinal-mapper.h>
+#include <dawgdic/pattern-search.h>
 #include <dawgdic/ranked-completer.h>
+#include <dawgdic/value-table.h>
 
 #include <fstream>
 #include <iostream>
@@ -12,8 +16,9 @@ namespace {
 class CommandOptions {
  public:
   CommandOptions()
-    : help_(false), guide_(false), ranked_(false),
-      dic_file_name_(), lexicon_file_name_() {}
+    : help_(false), guide_(false), ranked_(false), ordinal_(false),
+      wide_(false), pattern_(false), huge_pages_(false), dic_file_name_(),
+      lexicon_file_name_() {}
 
   // Reads options.
   bool help() const {
@@ -25,6 +30,18 @@ class CommandOptions {
   bool ranked() const {
     return ranked_;
   }
+  bool ordinal() const {
+    return ordinal_;
+  }
+  bool wide() const {
+    return wide_;
+  }
+  bool pattern() const {
+    return pattern_;
+  }
+  bool huge_pages() const {
+    return huge_pages_;
+  }
   const std::string &dic_file_name() const {
     return dic_file_name_;
   }
@@ -50,6 +67,22 @@ class CommandOptions {
               ranked_ = true;
               break;
             }
+            case 'o': {
+              ordinal_ = true;
+              break;
+            }
+            case 'w': {
+              wide_ = true;
+              break;
+            }
+            case 'p': {
+              pattern_ = true;
+              break;
+            }
+            case 'H': {
+              huge_pages_ = true;
+              break;
+            }
             default: {
               // Invalid option.
               return false;
@@ -82,7 +115,11 @@ class CommandOptions {
                "Options:\n"
                "  -h  display this help and exit\n"
                "  -g  load dictionary with guide\n"
-               "  -r  load dictionary with ranked guide\n";
+               "  -r  load dictionary with ranked guide\n"
+               "  -o  map keys to ordinals with ordinal table\n"
+               "  -w  find 64-bit values in value table\n"
+               "  -p  find keys matching patterns with guide\n"
+               "  -H  load dictionary into huge pages\n";
     *output << std::endl;
   }
 
@@ -90,6 +127,10 @@ private:
   bool help_;
   bool guide_;
   bool ranked_;
+  bool ordinal_;
+  bool wide_;
+  bool pattern_;
+  bool huge_pages_;
   std::string dic_file_name_;
   std::string lexicon_file_name_;
 
@@ -98,23 +139,42 @@ private:
   CommandOptions &operator=(const CommandOptions &);
 };
 
-// Example of finding prefix keys from each line of an input text.
-void FindPrefixKeys(const dawgdic::Dictionary &dic, std::istream *input) {
+// Reads an object from a mapped file, or from the standard input.
+template <typename OBJECT_TYPE>
+bool LoadObject(const dawgdic::DictionaryFile &dic_file, bool huge_pages,
+                OBJECT_TYPE *object) {
+  if (dic_file.is_open()) {
+    return dic_file.Map(object);
+  } else if (huge_pages) {
+    return object->Read(&std::cin,
+                        dawgdic::HugePageBuffer::TRANSPARENT_HUGE_PAGES);
+  }
+  return object->Read(&std::cin);
+}
+
+// Example of finding prefix keys from each line of an input text. If
+// wide_values is not NULL, values of keys are read from it.
+void FindPrefixKeys(
+    const dawgdic::Dictionary &dic,
+    const dawgdic::ValueTable<dawgdic::UInt64Type> *wide_values,
+    std::istream *input) {
+  std::vector<dawgdic::PrefixMatch> matches;
   std::string line;
   while (std::getline(*input, line)) {
     std::cout << line << ':';
 
-    dawgdic::BaseType index = dic.root();
-    for (std::size_t i = 0; i < line.length(); ++i) {
-      if (!dic.Follow(line[i], &index)) {
-        break;
-      }
-
-      // Reads a value.
-      if (dic.has_value(index)) {
-        std::cout << ' ';
-        std::cout.write(line.c_str(), i + 1);
-        std::cout << " = " << dic.value(index) << ';';
+    if (matches.size() <= line.length()) {
+      matches.resize(line.length() + 1);
+    }
+    std::size_t num_of_matches = dic.CommonPrefixSearch(
+        line.c_str(), line.length(), &matches[0], matches.size());
+    for (std::size_t i = 0; i < num_of_matches; ++i) {
+      std::cout << ' ';
+      std::cout.write(line.c_str(), matches[i].length());
+      if (wide_values != NULL) {
+        std::cout << " = " << wide_values->value(matches[i].value()) << ';';
+      } else {
+        std::cout << " = " << matches[i].value() << ';';
       }
     }
     std::cout << std::endl;
@@ -142,6 +202,45 @@ void CompleteKeys(const dawgdic::Dictionary &dic,
   }
 }
 
+// Example of finding keys which match a pattern in each line of an input
+// text.
+void FindPatternKeys(const dawgdic::Dictionary &dic,
+                     const dawgdic::Guide &guide, std::istream *input) {
+  dawgdic::PatternSearch search(dic, guide);
+  dawgdic::CompletionBuffer results;
+  std::string line;
+  while (std::getline(*input, line)) {
+    std::cout << line << ':';
+
+    if (search.Find(line.c_str(), line.length(), &results)) {
+      for (std::size_t i = 0; i < results.size(); ++i) {
+        std::cout << ' ';
+        std::cout.write(results.key(i), results.length(i));
+        std::cout << " = " << results.value(i);
+      }
+    } else {
+      std::cout << " invalid pattern";
+    }
+    std::cout << std::endl;
+  }
+}
+
+// Example of mapping each line of an input text to its ordinal.
+void FindOrdinals(const dawgdic::Dictionary &dic,
+                  const dawgdic::OrdinalTable &table, std::istream *input) {
+  dawgdic::OrdinalMapper mapper(dic, table);
+  std::string line;
+  while (std::getline(*input, line)) {
+    std::cout << line << ':';
+
+    dawgdic::BaseType id;
+    if (mapper.Rank(line.c_str(), line.length(), &id) && mapper.Select(id)) {
+      std::cout << ' ' << mapper.key() << " = " << id;
+    }
+    std::cout << std::endl;
+  }
+}
+
 }  // namespace
 
 int main(int argc, char *argv[]) {
@@ -157,19 +256,20 @@ int main(int argc, char *argv[]) {
   const std::string &dic_file_name = options.dic_file_name();
   const std::string &lexicon_file_name = options.lexicon_file_name();
 
-  std::istream *dic_stream = &std::cin;
   std::istream *lexicon_stream = &std::cin;
 
-  // Opens a dictionary file.
-  std::ifstream dic_file;
+  // Maps a dictionary file into memory.
+  dawgdic::DictionaryFile dic_file;
   if (dic_file_name != "-") {
-    dic_file.open(dic_file_name.c_str(), std::ios::binary);
-    if (!dic_file) {
+    int map_flags = dawgdic::MappedFile::WILL_NEED;
+    if (options.huge_pages()) {
+      map_flags |= dawgdic::MappedFile::HUGE_PAGES;
+    }
+    if (!dic_file.Open(dic_file_name.c_str(), map_flags)) {
       std::cerr << "error: failed to open DicFile: "
                 << dic_file_name << std::endl;
       return 1;
     }
-    dic_stream = &dic_file;
   }
 
   // Opens a lexicon file.
@@ -185,27 +285,52 @@ int main(int argc, char *argv[]) {
   }
 
   dawgdic::Dictionary dic;
-  if (!dic.Read(dic_stream)) {
+  if (!LoadObject(dic_file, options.huge_pages(), &dic)) {
     std::cerr << "error: failed to read Dictionary" << std::endl;
     return 1;
   }
+  if (options.huge_pages()) {
+    std::cerr << "huge pages: " << dic.huge_page_bytes()
+              << " bytes" << std::endl;
+  }
 
-  if (options.ranked()) {
+  if (options.ordinal()) {
+    dawgdic::OrdinalTable table;
+    if (!dic_file.Map(&table)) {
+      std::cerr << "error: failed to read OrdinalTable" << std::endl;
+      return 1;
+    }
+    FindOrdinals(dic, table, lexicon_stream);
+  } else if (options.ranked()) {
     dawgdic::RankedGuide guide;
-    if (!guide.Read(dic_stream)) {
+    if (!LoadObject(dic_file, options.huge_pages(), &guide)) {
       std::cerr << "error: failed to read RankedGuide" << std::endl;
       return 1;
     }
     CompleteKeys<dawgdic::RankedCompleter>(dic, guide, lexicon_stream);
+  } else if (options.pattern()) {
+    dawgdic::Guide guide;
+    if (!LoadObject(dic_file, options.huge_pages(), &guide)) {
+      std::cerr << "error: failed to read Guide" << std::endl;
+      return 1;
+    }
+    FindPatternKeys(dic, guide, lexicon_stream);
   } else if (options.guide()) {
     dawgdic::Guide guide;
-    if (!guide.Read(dic_stream)) {
+    if (!LoadObject(dic_file, options.huge_pages(), &guide)) {
       std::cerr << "error: failed to read Guide" << std::endl;
       return 1;
     }
     CompleteKeys<dawgdic::Completer>(dic, guide, lexicon_stream);
+  } else if (options.wide()) {
+    dawgdic::ValueTable<dawgdic::UInt64Type> wide_values;
+    if (!dic_file.Map(&wide_values)) {
+      std::cerr << "error: failed to read ValueTable" << std::endl;
+      return 1;
+    }
+    FindPrefixKeys(dic, &wide_values, lexicon_stream);
   } else {
-    FindPrefixKeys(dic, lexicon_stream);
+    FindPrefixKeys(dic, NULL, lexicon_stream);
   }
 
   return 0;
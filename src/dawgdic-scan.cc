@@ -0,0 +1,209 @@
+#include <dawgdic/dictionary.h>
+#include <dawgdic/dictionary-file.h>
+#include <dawgdic/text-scanner.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+namespace {
+
+class CommandOptions {
+ public:
+  CommandOptions()
+    : help_(false), num_threads_(1),
+      chunk_size_(dawgdic::TextScanner::DEFAULT_CHUNK_SIZE),
+      dic_file_name_(), text_file_name_() {}
+
+  // Reads options.
+  bool help() const {
+    return help_;
+  }
+  std::size_t num_threads() const {
+    return num_threads_;
+  }
+  std::size_t chunk_size() const {
+    return chunk_size_;
+  }
+  const std::string &dic_file_name() const {
+    return dic_file_name_;
+  }
+  const std::string &text_file_name() const {
+    return text_file_name_;
+  }
+
+  bool Parse(int argc, char *argv[]) {
+    for (int i = 1; i < argc; ++i) {
+      // Parses options.
+      if (argv[i][0] == '-' && argv[i][1] != '\0') {
+        bool has_argument = false;
+        for (int j = 1; !has_argument && argv[i][j] != '\0'; ++j) {
+          switch (argv[i][j]) {
+            case 'h': {
+              help_ = true;
+              break;
+            }
+            case 'j': {
+              if (!ReadNumber(argc, argv, &i, j, &num_threads_)) {
+                return false;
+              }
+              has_argument = true;
+              break;
+            }
+            case 's': {
+              if (!ReadNumber(argc, argv, &i, j, &chunk_size_)) {
+                return false;
+              }
+              has_argument = true;
+              break;
+            }
+            default: {
+              // Invalid option.
+              return false;
+            }
+          }
+        }
+      } else if (dic_file_name_.empty()) {
+        dic_file_name_ = argv[i];
+      } else if (text_file_name_.empty()) {
+        text_file_name_ = argv[i];
+      } else {
+        // Too many arguments.
+        return false;
+      }
+    }
+
+    // A dictionary is mapped into memory, so its file name is required.
+    if (dic_file_name_.empty() || dic_file_name_ == "-") {
+      return false;
+    }
+    if (text_file_name_.empty()) {
+      text_file_name_ = "-";
+    }
+    return true;
+  }
+
+  static void ShowUsage(std::ostream *output) {
+    *output << "Usage: - [Options] DicFile [TextFile]\n"
+               "\n"
+               "Options:\n"
+               "  -h  display this help and exit\n"
+               "  -j  scan text with worker threads (-j NumThreads)\n"
+               "  -s  start offsets per chunk (-s ChunkSize)\n";
+    *output << std::endl;
+  }
+
+private:
+  bool help_;
+  std::size_t num_threads_;
+  std::size_t chunk_size_;
+  std::string dic_file_name_;
+  std::string text_file_name_;
+
+  // Disallows copies.
+  CommandOptions(const CommandOptions &);
+  CommandOptions &operator=(const CommandOptions &);
+
+  // Reads a positive number of an option from the rest of the current
+  // argument or the next argument.
+  static bool ReadNumber(int argc, char *argv[], int *i, int j,
+                         std::size_t *number) {
+    const char *argument = NULL;
+    if (argv[*i][j + 1] != '\0') {
+      argument = &argv[*i][j + 1];
+    } else if (*i + 1 < argc) {
+      argument = argv[++*i];
+    } else {
+      return false;
+    }
+
+    char *end = NULL;
+    unsigned long value = std::strtoul(argument, &end, 10);
+    if (*end != '\0' || value == 0) {
+      return false;
+    }
+    *number = static_cast<std::size_t>(value);
+    return true;
+  }
+};
+
+// Writes matches as lines of "offset<TAB>key<TAB>value".
+class MatchWriter {
+ public:
+  MatchWriter(const char *text, std::ostream *output)
+    : text_(text), output_(output) {}
+
+  void operator()(const dawgdic::TextMatch &match) {
+    *output_ << match.offset() << '\t';
+    output_->write(text_ + match.offset(), match.length());
+    *output_ << '\t' << match.value() << '\n';
+  }
+
+ private:
+  const char *text_;
+  std::ostream *output_;
+
+  // Disallows copies.
+  MatchWriter(const MatchWriter &);
+  MatchWriter &operator=(const MatchWriter &);
+};
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  CommandOptions options;
+  if (!options.Parse(argc, argv)) {
+    CommandOptions::ShowUsage(&std::cerr);
+    return 1;
+  } else if (options.help()) {
+    CommandOptions::ShowUsage(&std::cerr);
+    return 0;
+  }
+
+  const std::string &dic_file_name = options.dic_file_name();
+  const std::string &text_file_name = options.text_file_name();
+
+  // Maps a dictionary file into memory.
+  dawgdic::DictionaryFile dic_file;
+  if (!dic_file.Open(dic_file_name.c_str(),
+                     dawgdic::MappedFile::WILL_NEED)) {
+    std::cerr << "error: failed to open DicFile: "
+              << dic_file_name << std::endl;
+    return 1;
+  }
+
+  dawgdic::Dictionary dic;
+  if (!dic_file.Map(&dic)) {
+    std::cerr << "error: failed to read Dictionary" << std::endl;
+    return 1;
+  }
+
+  // Maps a text file into memory, or reads a text from the standard input.
+  const char *text = NULL;
+  std::size_t text_length = 0;
+  dawgdic::MappedFile text_file;
+  std::string text_buf;
+  if (text_file_name != "-") {
+    if (!text_file.Open(text_file_name.c_str(),
+                        dawgdic::MappedFile::WILL_NEED)) {
+      std::cerr << "error: failed to open TextFile: "
+                << text_file_name << std::endl;
+      return 1;
+    }
+    text = static_cast<const char *>(text_file.address());
+    text_length = text_file.size();
+  } else {
+    text_buf.assign(std::istreambuf_iterator<char>(std::cin),
+                    std::istreambuf_iterator<char>());
+    text = text_buf.data();
+    text_length = text_buf.length();
+  }
+
+  dawgdic::TextScanner scanner(dic, options.chunk_size());
+  MatchWriter writer(text, &std::cout);
+  scanner.Scan(text, text_length, options.num_threads(), &writer);
+  std::cout.flush();
+
+  return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef DAWGDIC_ACCESS_PROFILE_H
+#define DAWGDIC_ACCESS_PROFILE_H
+
+#include <vector>
+
+#include "base-types.h"
+
+namespace dawgdic {
+
+// Access frequencies of keys, such as a sample of a query log. Keys need not
+// be sorted or registered in a dictionary, and repeated keys are summed up.
+class AccessProfile {
+ public:
+  AccessProfile() : labels_(), key_ends_(), weights_() {}
+
+  // Number of added keys.
+  SizeType size() const {
+    return weights_.size();
+  }
+
+  // Reads an added key and its weight.
+  const UCharType *key(SizeType id) const {
+    return labels_.empty() ? NULL : &labels_[0] + key_begin(id);
+  }
+  SizeType length(SizeType id) const {
+    return key_ends_[id] - key_begin(id);
+  }
+  BaseType weight(SizeType id) const {
+    return weights_[id];
+  }
+
+  // Adds a key with its weight.
+  void Add(const CharType *key, BaseType weight = 1) {
+    SizeType length = 0;
+    while (key[length] != '\0') {
+      ++length;
+    }
+    Add(key, length, weight);
+  }
+  void Add(const CharType *key, SizeType length, BaseType weight) {
+    for (SizeType i = 0; i < length; ++i) {
+      labels_.push_back(static_cast<UCharType>(key[i]));
+    }
+    key_ends_.push_back(labels_.size());
+    weights_.push_back(weight);
+  }
+
+  // Removes all keys.
+  void Clear() {
+    std::vector<UCharType>(0).swap(labels_);
+    std::vector<SizeType>(0).swap(key_ends_);
+    std::vector<BaseType>(0).swap(weights_);
+  }
+
+ private:
+  std::vector<UCharType> labels_;
+  std::vector<SizeType> key_ends_;
+  std::vector<BaseType> weights_;
+
+  // Disallows copies.
+  AccessProfile(const AccessProfile &);
+  AccessProfile &operator=(const AccessProfile &);
+
+  SizeType key_begin(SizeType id) const {
+    return (id == 0) ? 0 : key_ends_[id - 1];
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_ACCESS_PROFILE_H
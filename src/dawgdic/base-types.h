@@ -15,6 +15,9 @@ typedef int ValueType;
 // 32-bit unsigned integer.
 typedef unsigned int BaseType;
 
+// 64-bit unsigned integer.
+typedef unsigned long long UInt64Type;
+
 // 32 or 64-bit unsigned integer.
 typedef std::size_t SizeType;
 
@@ -0,0 +1,206 @@
+#ifndef DAWGDIC_BATCH_KERNEL_H
+#define DAWGDIC_BATCH_KERNEL_H
+
+#include "base-types.h"
+#include "dictionary-unit.h"
+
+// SIMD kernels need GCC 4.9 or later (or Clang) on x86, which compile
+// functions for a target given by an attribute. Define DAWGDIC_NO_SIMD to
+// disable them.
+#if !defined(DAWGDIC_NO_SIMD) && \
+    (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define DAWGDIC_X86_KERNELS
+#include <immintrin.h>
+#endif  // DAWGDIC_X86_KERNELS
+
+namespace dawgdic {
+
+// Kernels which follow transitions of multiple lanes at once. A step reads
+// the units of lanes with gather instructions, computes the next indices,
+// and checks their labels. The default kernel is detected once by features
+// of the CPU, and SCALAR_KERNEL means the scalar batch lookup. Another
+// kernel is given to each batch lookup, so no global state is changed.
+class BatchKernel {
+ public:
+  enum KernelType {
+    SCALAR_KERNEL,
+    AVX2_KERNEL,
+    AVX512_KERNEL
+  };
+
+  enum {
+    // Maximum number of lanes of a kernel.
+    MAX_NUM_OF_LANES = 32
+  };
+
+  // Kernel used for batch lookups by default.
+  static KernelType type() {
+    static const KernelType type = Detect();
+    return type;
+  }
+  // Number of lanes of a kernel.
+  static SizeType num_of_lanes(KernelType type) {
+    switch (type) {
+      case AVX2_KERNEL: {
+        return 16;
+      }
+      case AVX512_KERNEL: {
+        return 32;
+      }
+      default: {
+        return 1;
+      }
+    }
+  }
+
+  // Checks if a kernel runs on the CPU.
+  static bool IsSupported(KernelType type) {
+    switch (type) {
+      case SCALAR_KERNEL: {
+        return true;
+      }
+#ifdef DAWGDIC_X86_KERNELS
+      case AVX2_KERNEL: {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+      }
+      case AVX512_KERNEL: {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f") != 0;
+      }
+#endif  // DAWGDIC_X86_KERNELS
+      default: {
+        return false;
+      }
+    }
+  }
+
+  // Follows a transition of each lane. Lanes have indices, their units
+  // and labels, and then indices and units are overwritten with those of
+  // the next units. The i-th bit of the result is set if the label of the
+  // i-th lane matches. Idle lanes must be at the root with label 0.
+  static unsigned Step(KernelType type, const DictionaryUnit *units,
+                       BaseType *indices, DictionaryUnit *lane_units,
+                       const BaseType *labels) {
+#ifdef DAWGDIC_X86_KERNELS
+    if (type == AVX512_KERNEL) {
+      return Avx512Step(units, indices, lane_units, labels);
+    } else if (type == AVX2_KERNEL) {
+      return Avx2Step(units, indices, lane_units, labels);
+    }
+#endif  // DAWGDIC_X86_KERNELS
+    return ScalarStep(units, indices, lane_units, labels);
+  }
+
+ private:
+  // Disallows instantiation.
+  BatchKernel();
+
+  // Selects AVX512_KERNEL if it runs on the CPU. AVX2_KERNEL is not
+  // selected by default because its gathers are not faster than prefetches
+  // of the scalar batch lookup, but a lookup can be given it.
+  static KernelType Detect() {
+    if (IsSupported(AVX512_KERNEL)) {
+      return AVX512_KERNEL;
+    }
+    return SCALAR_KERNEL;
+  }
+
+  static unsigned ScalarStep(const DictionaryUnit *units,
+                             BaseType *indices, DictionaryUnit *lane_units,
+                             const BaseType *labels) {
+    indices[0] ^= lane_units[0].offset() ^ labels[0];
+    lane_units[0] = units[indices[0]];
+    return (lane_units[0].label() == labels[0]) ? 1 : 0;
+  }
+
+#ifdef DAWGDIC_X86_KERNELS
+  // DictionaryUnit::offset() and DictionaryUnit::label() in 8 lanes. Two
+  // vectors are processed at once so that their gathers overlap.
+  __attribute__((target("avx2")))
+  static unsigned Avx2Step(const DictionaryUnit *units, BaseType *indices,
+                           DictionaryUnit *lane_units,
+                           const BaseType *labels) {
+    return Avx2Step8(units, indices, lane_units, labels) |
+        (Avx2Step8(units, indices + 8, lane_units + 8, labels + 8) << 8);
+  }
+
+  __attribute__((target("avx2")))
+  static unsigned Avx2Step8(const DictionaryUnit *units, BaseType *indices,
+                            DictionaryUnit *lane_units,
+                            const BaseType *labels) {
+    const int *bases = reinterpret_cast<const int *>(units);
+    __m256i index_vec = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(indices));
+    __m256i base_vec = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(lane_units));
+    __m256i label_vec = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(labels));
+
+    __m256i shift_vec = _mm256_srli_epi32(_mm256_and_si256(base_vec,
+        _mm256_set1_epi32(DictionaryUnit::EXTENSION_BIT)), 6);
+    __m256i offset_vec = _mm256_sllv_epi32(
+        _mm256_srli_epi32(base_vec, 10), shift_vec);
+    index_vec = _mm256_xor_si256(_mm256_xor_si256(index_vec, offset_vec),
+                                 label_vec);
+
+    base_vec = _mm256_i32gather_epi32(bases, index_vec, 4);
+    __m256i match_vec = _mm256_cmpeq_epi32(_mm256_and_si256(base_vec,
+        _mm256_set1_epi32(static_cast<int>(
+            DictionaryUnit::IS_LEAF_BIT | 0xFF))), label_vec);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(indices), index_vec);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lane_units), base_vec);
+    return static_cast<unsigned>(
+        _mm256_movemask_ps(_mm256_castsi256_ps(match_vec)));
+  }
+
+  // DictionaryUnit::offset() and DictionaryUnit::label() in 16 lanes.
+  __attribute__((target("avx512f")))
+  static unsigned Avx512Step(const DictionaryUnit *units, BaseType *indices,
+                             DictionaryUnit *lane_units,
+                             const BaseType *labels) {
+    return Avx512Step16(units, indices, lane_units, labels) |
+        (Avx512Step16(units, indices + 16, lane_units + 16, labels + 16)
+         << 16);
+  }
+
+  __attribute__((target("avx512f")))
+  static unsigned Avx512Step16(const DictionaryUnit *units,
+                               BaseType *indices, DictionaryUnit *lane_units,
+                               const BaseType *labels) {
+    const int *bases = reinterpret_cast<const int *>(units);
+    __m512i index_vec = _mm512_loadu_si512(indices);
+    __m512i base_vec = _mm512_loadu_si512(lane_units);
+    __m512i label_vec = _mm512_loadu_si512(labels);
+
+    // Masked forms avoid uninitialized sources in unmasked intrinsics,
+    // which some versions of GCC warn about.
+    const __mmask16 all_lanes = 0xFFFF;
+
+    __m512i shift_vec = _mm512_maskz_srli_epi32(all_lanes,
+        _mm512_and_si512(base_vec,
+            _mm512_set1_epi32(DictionaryUnit::EXTENSION_BIT)), 6);
+    __m512i offset_vec = _mm512_maskz_sllv_epi32(all_lanes,
+        _mm512_maskz_srli_epi32(all_lanes, base_vec, 10), shift_vec);
+    index_vec = _mm512_xor_si512(_mm512_xor_si512(index_vec, offset_vec),
+                                 label_vec);
+
+    base_vec = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(),
+                                           all_lanes, index_vec, bases, 4);
+    __mmask16 match_mask = _mm512_cmpeq_epi32_mask(_mm512_and_si512(base_vec,
+        _mm512_set1_epi32(static_cast<int>(
+            DictionaryUnit::IS_LEAF_BIT | 0xFF))), label_vec);
+
+    _mm512_storeu_si512(indices, index_vec);
+    _mm512_storeu_si512(lane_units, base_vec);
+    return static_cast<unsigned>(match_mask);
+  }
+#endif  // DAWGDIC_X86_KERNELS
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_BATCH_KERNEL_H
@@ -0,0 +1,142 @@
+#ifndef DAWGDIC_BEST_VALUE_TABLE_H
+#define DAWGDIC_BEST_VALUE_TABLE_H
+
+#include "dictionary.h"
+
+#include <iostream>
+#include <vector>
+
+namespace dawgdic {
+
+// Side array of a dictionary which has the best value of keys under each
+// state, in the order of a ranked guide. A unit at the index of a state has
+// the value of the first key completed from the state, and other units have
+// -1. The table is built by RankedGuideBuilder.
+class BestValueTable {
+ public:
+  BestValueTable() : units_(NULL), size_(0), units_buf_() {}
+
+  const ValueType *units() const {
+    return units_;
+  }
+  SizeType size() const {
+    return size_;
+  }
+  SizeType total_size() const {
+    return sizeof(ValueType) * size_;
+  }
+  SizeType file_size() const {
+    return sizeof(BaseType) + total_size();
+  }
+
+  // Best value of keys under a state.
+  ValueType value(BaseType index) const {
+    return units_[index];
+  }
+
+  // Finds the best value of keys which start with a prefix.
+  bool Find(const Dictionary &dic, const CharType *prefix,
+            ValueType *value) const {
+    BaseType index = dic.root();
+    return size_ != 0 && dic.Follow(prefix, &index) &&
+        FindValue(index, value);
+  }
+  bool Find(const Dictionary &dic, const CharType *prefix, SizeType length,
+            ValueType *value) const {
+    BaseType index = dic.root();
+    return size_ != 0 && dic.Follow(prefix, length, &index) &&
+        FindValue(index, value);
+  }
+
+  // Reads a table from an input stream.
+  bool Read(std::istream *input) {
+    BaseType base_size;
+    if (!input->read(reinterpret_cast<char *>(&base_size), sizeof(BaseType))) {
+      return false;
+    }
+
+    SizeType size = static_cast<SizeType>(base_size);
+    std::vector<ValueType> units_buf(size);
+    if (!input->read(reinterpret_cast<char *>(&units_buf[0]),
+                     sizeof(ValueType) * size)) {
+      return false;
+    }
+
+    SwapUnitsBuf(&units_buf);
+    return true;
+  }
+
+  // Writes a table to an output stream.
+  bool Write(std::ostream *output) const {
+    BaseType base_size = static_cast<BaseType>(size_);
+    if (!output->write(reinterpret_cast<const char *>(&base_size),
+                       sizeof(BaseType))) {
+      return false;
+    }
+
+    if (!output->write(reinterpret_cast<const char *>(units_),
+                       sizeof(ValueType) * size_)) {
+      return false;
+    }
+
+    return true;
+  }
+
+  // Maps memory with its size.
+  void Map(const void *address) {
+    Clear();
+    units_ = reinterpret_cast<const ValueType *>(
+        static_cast<const BaseType *>(address) + 1);
+    size_ = *static_cast<const BaseType *>(address);
+  }
+  void Map(const void *address, SizeType size) {
+    Clear();
+    units_ = static_cast<const ValueType *>(address);
+    size_ = size;
+  }
+
+  // Swaps tables.
+  void Swap(BestValueTable *table) {
+    std::swap(units_, table->units_);
+    std::swap(size_, table->size_);
+    units_buf_.swap(table->units_buf_);
+  }
+
+  // Initializes a table.
+  void Clear() {
+    units_ = NULL;
+    size_ = 0;
+    std::vector<ValueType>(0).swap(units_buf_);
+  }
+
+ public:
+  // Following member function is called from RankedGuideBuilder.
+
+  // Swaps buffers for units.
+  void SwapUnitsBuf(std::vector<ValueType> *units_buf) {
+    units_ = &(*units_buf)[0];
+    size_ = static_cast<BaseType>(units_buf->size());
+    units_buf_.swap(*units_buf);
+  }
+
+ private:
+  const ValueType *units_;
+  SizeType size_;
+  std::vector<ValueType> units_buf_;
+
+  // Disallows copies.
+  BestValueTable(const BestValueTable &);
+  BestValueTable &operator=(const BestValueTable &);
+
+  bool FindValue(BaseType index, ValueType *value) const {
+    if (index >= size_ || units_[index] < 0) {
+      return false;
+    }
+    *value = units_[index];
+    return true;
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_BEST_VALUE_TABLE_H
@@ -6,10 +6,13 @@
 namespace dawgdic {
 
 // This class works as an array of bit flags with compact memory management.
+// BLOCK_SIZE is the default number of bytes per block. See ObjectPool.
 template <SizeType BLOCK_SIZE = 1 << 10>
 class BitPool {
  public:
-  BitPool() : pool_(), size_(0) {}
+  explicit BitPool(BlockAllocator *allocator = NULL,
+                   SizeType block_size = BLOCK_SIZE)
+    : pool_(allocator, block_size), size_(0) {}
 
   // Accessors.
   void set(SizeType index, bool bit) {
@@ -27,15 +30,33 @@ class BitPool {
     return (pool_[pool_index] & bit_flag) ? true : false;
   }
 
+  // Number of bytes allocated for bits.
+  SizeType memory_usage() const {
+    return pool_.memory_usage();
+  }
+
   // Deletes all bits and frees memory.
   void Clear() {
     pool_.Clear();
     size_ = 0;
   }
 
+  // Deletes all bits, but keeps memory for new bits.
+  void Reset() {
+    pool_.Reset();
+    size_ = 0;
+  }
+
   // Swaps bit pools.
   void Swap(BitPool *bit_pool) {
     pool_.Swap(&bit_pool->pool_);
+    std::swap(size_, bit_pool->size_);
+  }
+
+  // Maps an array of bytes, each of which has 8 bits, as a read-only pool.
+  void Map(const UCharType *bytes, SizeType size) {
+    pool_.Map(bytes, (size + 7) / 8);
+    size_ = size;
   }
 
   // Allocates memory for a new bit and returns its ID.
@@ -50,7 +71,7 @@ class BitPool {
   }
 
  private:
-  ObjectPool<UCharType> pool_;
+  ObjectPool<UCharType, BLOCK_SIZE> pool_;
   SizeType size_;
 
   // Disallows copies.
@@ -0,0 +1,40 @@
+#ifndef DAWGDIC_BLOCK_ALLOCATOR_H
+#define DAWGDIC_BLOCK_ALLOCATOR_H
+
+#include <new>
+
+#include "base-types.h"
+
+namespace dawgdic {
+
+// Allocator of memory blocks for object pools. The default allocator uses
+// operator new, and derived classes may keep freed blocks for reuse.
+// A block is freed with the size given to Allocate().
+class BlockAllocator {
+ public:
+  BlockAllocator() {}
+  virtual ~BlockAllocator() {}
+
+  // Allocator shared by pools which are not given an allocator. It has no
+  // state, so it is used from any threads.
+  static BlockAllocator *Default() {
+    static BlockAllocator allocator;
+    return &allocator;
+  }
+
+  virtual void *Allocate(SizeType size) {
+    return ::operator new(size);
+  }
+  virtual void Free(void *block, SizeType) {
+    ::operator delete(block);
+  }
+
+ private:
+  // Disallows copies.
+  BlockAllocator(const BlockAllocator &);
+  BlockAllocator &operator=(const BlockAllocator &);
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_BLOCK_ALLOCATOR_H
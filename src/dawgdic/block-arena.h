@@ -0,0 +1,89 @@
+#ifndef DAWGDIC_BLOCK_ARENA_H
+#define DAWGDIC_BLOCK_ARENA_H
+
+#include <map>
+#include <vector>
+
+#include "block-allocator.h"
+
+namespace dawgdic {
+
+// Block allocator which keeps freed blocks for later pools, so that
+// building many small dawgs does not allocate and free memory each time.
+// Blocks are cached per size, and are freed by Clear() or the destructor.
+// An arena must outlive pools which use it, and is not thread-safe.
+class BlockArena : public BlockAllocator {
+ public:
+  BlockArena() : free_blocks_(), num_of_blocks_(0), num_of_free_blocks_(0),
+                 num_of_reuses_(0), memory_usage_(0) {}
+  virtual ~BlockArena() {
+    Clear();
+  }
+
+  // Number of blocks allocated from the heap, which are in use or free.
+  SizeType num_of_blocks() const {
+    return num_of_blocks_;
+  }
+  // Number of blocks kept for reuse.
+  SizeType num_of_free_blocks() const {
+    return num_of_free_blocks_;
+  }
+  // Number of blocks which are given from the cache.
+  SizeType num_of_reuses() const {
+    return num_of_reuses_;
+  }
+  // Number of bytes of blocks allocated from the heap.
+  SizeType memory_usage() const {
+    return memory_usage_;
+  }
+
+  virtual void *Allocate(SizeType size) {
+    std::vector<void *> &blocks = free_blocks_[size];
+    if (!blocks.empty()) {
+      void *block = blocks.back();
+      blocks.pop_back();
+      --num_of_free_blocks_;
+      ++num_of_reuses_;
+      return block;
+    }
+    void *block = ::operator new(size);
+    ++num_of_blocks_;
+    memory_usage_ += size;
+    return block;
+  }
+  virtual void Free(void *block, SizeType size) {
+    free_blocks_[size].push_back(block);
+    ++num_of_free_blocks_;
+  }
+
+  // Frees blocks kept for reuse. Blocks in use are not affected.
+  void Clear() {
+    for (FreeBlockMap::iterator it = free_blocks_.begin();
+         it != free_blocks_.end(); ++it) {
+      for (SizeType i = 0; i < it->second.size(); ++i) {
+        ::operator delete(it->second[i]);
+      }
+      num_of_blocks_ -= it->second.size();
+      memory_usage_ -= it->first * it->second.size();
+    }
+    FreeBlockMap().swap(free_blocks_);
+    num_of_free_blocks_ = 0;
+  }
+
+ private:
+  typedef std::map<SizeType, std::vector<void *> > FreeBlockMap;
+
+  FreeBlockMap free_blocks_;
+  SizeType num_of_blocks_;
+  SizeType num_of_free_blocks_;
+  SizeType num_of_reuses_;
+  SizeType memory_usage_;
+
+  // Disallows copies.
+  BlockArena(const BlockArena &);
+  BlockArena &operator=(const BlockArena &);
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_BLOCK_ARENA_H
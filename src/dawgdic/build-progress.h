@@ -0,0 +1,74 @@
+#ifndef DAWGDIC_BUILD_PROGRESS_H
+#define DAWGDIC_BUILD_PROGRESS_H
+
+#include "base-types.h"
+
+namespace dawgdic {
+
+// Progress of a builder which visits states of a dawg, such as
+// DictionaryBuilder and GuideBuilder. A builder updates counters while it
+// runs, so another thread can monitor a long build by reading them,
+// though the values read may be a little stale. Counters are read and
+// written with relaxed atomic operations, which require GCC builtins. Only
+// one builder may update a progress at a time.
+class BuildProgress {
+ public:
+  BuildProgress()
+    : num_of_states_(0), num_of_visited_states_(0), max_depth_(0) {}
+
+  // Number of states of a dawg, which estimates the amount of work. A
+  // merged state may be visited more than once, so the number of visited
+  // states may exceed this number a little.
+  SizeType num_of_states() const {
+    return Load(&num_of_states_);
+  }
+  // Number of visited states.
+  SizeType num_of_visited_states() const {
+    return Load(&num_of_visited_states_);
+  }
+  // Maximum number of states on a stack of a builder.
+  SizeType max_depth() const {
+    return Load(&max_depth_);
+  }
+
+  // Initializes counters.
+  void Clear() {
+    Start(0);
+  }
+
+  // Starts a build which visits a given number of states.
+  void Start(SizeType num_of_states) {
+    Store(&num_of_states_, num_of_states);
+    Store(&num_of_visited_states_, 0);
+    Store(&max_depth_, 0);
+  }
+
+  // Counts a visited state and its depth. The only updater does not need
+  // an atomic increment.
+  void Visit(SizeType depth) {
+    Store(&num_of_visited_states_, Load(&num_of_visited_states_) + 1);
+    if (depth > Load(&max_depth_)) {
+      Store(&max_depth_, depth);
+    }
+  }
+
+ private:
+  SizeType num_of_states_;
+  SizeType num_of_visited_states_;
+  SizeType max_depth_;
+
+  // Disallows copies.
+  BuildProgress(const BuildProgress &);
+  BuildProgress &operator=(const BuildProgress &);
+
+  static SizeType Load(const SizeType *counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+  }
+  static void Store(SizeType *counter, SizeType value) {
+    __atomic_store_n(counter, value, __ATOMIC_RELAXED);
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_BUILD_PROGRESS_H
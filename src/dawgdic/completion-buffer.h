@@ -0,0 +1,79 @@
+#ifndef DAWGDIC_COMPLETION_BUFFER_H
+#define DAWGDIC_COMPLETION_BUFFER_H
+
+#include <vector>
+
+#include "base-types.h"
+
+namespace dawgdic {
+
+// Buffer of completed keys and their values. Keys are packed into one
+// array with terminating null characters. Clear() keeps memory, so a
+// buffer which is reused for queries stops allocating memory once it has
+// grown to the largest result.
+class CompletionBuffer {
+ public:
+  CompletionBuffer() : keys_(), key_offsets_(), values_() {}
+
+  // Number of keys.
+  SizeType size() const {
+    return values_.size();
+  }
+  bool empty() const {
+    return values_.empty();
+  }
+  // Number of bytes allocated for keys and values.
+  SizeType memory_usage() const {
+    return sizeof(CharType) * keys_.capacity() +
+        sizeof(SizeType) * key_offsets_.capacity() +
+        sizeof(ValueType) * values_.capacity();
+  }
+
+  const CharType *key(SizeType id) const {
+    return &keys_[key_offsets_[id]];
+  }
+  SizeType length(SizeType id) const {
+    return key_offsets_[id + 1] - key_offsets_[id] - 1;
+  }
+  ValueType value(SizeType id) const {
+    return values_[id];
+  }
+
+  // Allocates memory in advance.
+  void Reserve(SizeType num_of_keys, SizeType num_of_bytes) {
+    keys_.reserve(num_of_bytes);
+    key_offsets_.reserve(num_of_keys + 1);
+    values_.reserve(num_of_keys);
+  }
+
+  // Removes keys, but keeps memory.
+  void Clear() {
+    keys_.clear();
+    key_offsets_.clear();
+    values_.clear();
+  }
+
+  // Appends a key.
+  void Append(const CharType *key, SizeType length, ValueType value) {
+    if (key_offsets_.empty()) {
+      key_offsets_.push_back(0);
+    }
+    keys_.insert(keys_.end(), key, key + length);
+    keys_.push_back('\0');
+    key_offsets_.push_back(keys_.size());
+    values_.push_back(value);
+  }
+
+ private:
+  std::vector<CharType> keys_;
+  std::vector<SizeType> key_offsets_;
+  std::vector<ValueType> values_;
+
+  // Disallows copies.
+  CompletionBuffer(const CompletionBuffer &);
+  CompletionBuffer &operator=(const CompletionBuffer &);
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_COMPLETION_BUFFER_H
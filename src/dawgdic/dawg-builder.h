@@ -2,7 +2,9 @@
 #define DAWGDIC_DAWG_BUILDER_H
 
 #include <algorithm>
-#include <stack>
+#include <ctime>
+#include <iostream>
+#include <utility>
 #include <vector>
 
 #include "dawg.h"
@@ -10,23 +12,41 @@
 
 namespace dawgdic {
 
-// DAWG builder.
+// DAWG builder. Units are allocated in blocks of block_size objects from
+// an allocator, which may be a BlockArena shared by builders. A dawg takes
+// blocks from a builder, and returns them to the allocator.
+//
+// Fixed transitions can be spilled to a stream to free memory, and they
+// keep their indices. See ExternalDawgBuilder.
 class DawgBuilder {
  public:
   explicit DawgBuilder(SizeType initial_hash_table_size =
-                       DEFAULT_INITIAL_HASH_TABLE_SIZE)
+                       DEFAULT_INITIAL_HASH_TABLE_SIZE,
+                       BlockAllocator *allocator = NULL,
+                       SizeType block_size = DEFAULT_BLOCK_SIZE)
     : initial_hash_table_size_(initial_hash_table_size),
-      base_pool_(), label_pool_(), flag_pool_(), unit_pool_(),
-      hash_table_(), unfixed_units_(), unused_units_(), num_of_states_(1),
-      num_of_merged_transitions_(0), num_of_merging_states_(0) {}
+      allocator_(allocator), block_size_(block_size),
+      base_pool_(allocator, block_size), label_pool_(allocator, block_size),
+      flag_pool_(allocator, block_size), unit_pool_(allocator, block_size),
+      hash_table_(), old_hash_table_(), num_of_migrated_slots_(0),
+      next_migration_(0), unfixed_units_(), free_unit_index_(0),
+      num_of_free_units_(0), num_of_spilled_transitions_(0),
+      num_of_spilled_states_(0), num_of_states_(1),
+      num_of_merged_transitions_(0), num_of_merging_states_(0),
+      num_of_lookups_(0), num_of_probes_(0), max_probe_length_(0),
+      num_of_expansions_(0), num_of_rehashed_states_(0), rehash_time_(0.0) {}
 
   // Number of units.
   SizeType size() const {
-    return base_pool_.size();
+    return num_of_spilled_transitions_ + base_pool_.size();
   }
   // Number of transitions.
   SizeType num_of_transitions() const {
-    return base_pool_.size() - 1;
+    return size() - 1;
+  }
+  // Number of units spilled by Spill().
+  SizeType num_of_spilled_transitions() const {
+    return num_of_spilled_transitions_;
   }
   // Number of states.
   SizeType num_of_states() const {
@@ -45,21 +65,65 @@ class DawgBuilder {
   SizeType num_of_merging_states() const {
     return num_of_merging_states_;
   }
+  // Number of bytes allocated for units and a hash table.
+  SizeType memory_usage() const {
+    return base_pool_.memory_usage() + label_pool_.memory_usage() +
+        flag_pool_.memory_usage() + unit_pool_.memory_usage() +
+        sizeof(PairType) * (hash_table_.capacity() +
+        old_hash_table_.capacity()) +
+        sizeof(BaseType) * unfixed_units_.capacity();
+  }
+  // Number of bytes which the next expansion of the hash table adds to
+  // memory_usage() at most.
+  SizeType expansion_memory_usage() const {
+    return sizeof(PairType) * (hash_table_.size() << 1);
+  }
+
+  // Statistics of the hash table for merging states, which are kept after
+  // Finish() until the next build starts.
+
+  // Number of lookups of states.
+  SizeType num_of_lookups() const {
+    return num_of_lookups_;
+  }
+  // Number of slots probed by lookups.
+  SizeType num_of_probes() const {
+    return num_of_probes_;
+  }
+  // Maximum number of slots probed by a lookup.
+  SizeType max_probe_length() const {
+    return max_probe_length_;
+  }
+  // Number of times the hash table has been expanded.
+  SizeType num_of_expansions() const {
+    return num_of_expansions_;
+  }
+  // Number of states moved from old tables to expanded tables.
+  SizeType num_of_rehashed_states() const {
+    return num_of_rehashed_states_;
+  }
+  // Processor time in seconds for moving states.
+  double rehash_time() const {
+    return rehash_time_;
+  }
 
   // Initializes a builder.
   void Clear() {
-    base_pool_.Clear();
-    label_pool_.Clear();
-    flag_pool_.Clear();
+    // Pools may have been swapped with those of a dawg.
+    ObjectPool<BaseUnit>(allocator_, block_size_).Swap(&base_pool_);
+    ObjectPool<UCharType>(allocator_, block_size_).Swap(&label_pool_);
+    BitPool<>(allocator_, block_size_).Swap(&flag_pool_);
     unit_pool_.Clear();
 
-    std::vector<BaseType>(0).swap(hash_table_);
-    while (!unfixed_units_.empty()) {
-      unfixed_units_.pop();
-    }
-    while (!unused_units_.empty()) {
-      unused_units_.pop();
-    }
+    std::vector<PairType>(0).swap(hash_table_);
+    std::vector<PairType>(0).swap(old_hash_table_);
+    num_of_migrated_slots_ = 0;
+    next_migration_ = 0;
+    std::vector<BaseType>(0).swap(unfixed_units_);
+    free_unit_index_ = 0;
+    num_of_free_units_ = 0;
+    num_of_spilled_transitions_ = 0;
+    num_of_spilled_states_ = 0;
 
     num_of_states_ = 1;
     num_of_merged_transitions_ = 0;
@@ -98,6 +162,10 @@ class DawgBuilder {
       Init();
     }
 
+    if (num_of_spilled_transitions_ != 0) {
+      return false;
+    }
+
     FixUnits(0);
     base_pool_[0].set_base(unit_pool_[0].base());
     label_pool_[0] = unit_pool_[0].label();
@@ -115,22 +183,101 @@ class DawgBuilder {
     return true;
   }
 
+  // Writes fixed transitions to an output stream, and frees them and the
+  // hash table. Each transition is written as a 64-bit record, whose lower
+  // 32 bits are its base value, and whose next 8 bits and 1 bit are its
+  // label and merging flag. The first record is a placeholder of the root.
+  // Spilled transitions keep their indices, but they are no longer merged
+  // with new states, so equivalent states may be spilled more than once.
+  bool Spill(std::ostream *output) {
+    // Initializes a builder if not initialized.
+    if (hash_table_.empty()) {
+      Init();
+    }
+
+    std::vector<UInt64Type> records;
+    for (SizeType begin = 0; begin < base_pool_.size();
+         begin += SPILL_BUF_SIZE) {
+      SizeType end = std::min(begin + SPILL_BUF_SIZE, base_pool_.size());
+      records.clear();
+      for (SizeType i = begin; i < end; ++i) {
+        records.push_back(base_pool_[i].base() |
+            (static_cast<UInt64Type>(label_pool_[i]) << 32) |
+            (static_cast<UInt64Type>(flag_pool_.get(i)) << 40));
+      }
+      if (!output->write(reinterpret_cast<const char *>(&records[0]),
+                         sizeof(UInt64Type) * records.size())) {
+        return false;
+      }
+    }
+
+    num_of_spilled_transitions_ += base_pool_.size();
+    num_of_spilled_states_ = num_of_states_;
+    base_pool_.Clear();
+    label_pool_.Clear();
+    flag_pool_.Clear();
+    InitHashTable();
+    return true;
+  }
+
+  // Finishes building a dawg whose transitions are spilled. All the units
+  // are fixed, and the rest of transitions are spilled. The root is not
+  // written again, and its base value is returned instead. Statistics are
+  // kept until Clear(), which must be called before the next build.
+  bool Finish(std::ostream *output, BaseType *root_base) {
+    // Initializes a builder if not initialized.
+    if (hash_table_.empty()) {
+      Init();
+    }
+
+    FixUnits(0);
+    *root_base = unit_pool_[0].base();
+    return Spill(output);
+  }
+
  private:
   enum {
-    DEFAULT_INITIAL_HASH_TABLE_SIZE = 1 << 8
+    DEFAULT_INITIAL_HASH_TABLE_SIZE = 1 << 8,
+    DEFAULT_BLOCK_SIZE = 1 << 10,
+    // Number of transitions spilled at once.
+    SPILL_BUF_SIZE = 1 << 12,
+    // An expanded hash table takes states from its old table in steps,
+    // each of which moves MIGRATION_SIZE slots per MIGRATION_INTERVAL new
+    // states. Two slots per state finish moving before the next expansion.
+    MIGRATION_INTERVAL = 1 << 9,
+    MIGRATION_SIZE = MIGRATION_INTERVAL * 2
   };
 
+  // Pair of the first transition of a state and its hash value.
+  typedef std::pair<BaseType, BaseType> PairType;
+
   const SizeType initial_hash_table_size_;
+  BlockAllocator *allocator_;
+  const SizeType block_size_;
   ObjectPool<BaseUnit> base_pool_;
   ObjectPool<UCharType> label_pool_;
   BitPool<> flag_pool_;
   ObjectPool<DawgUnit> unit_pool_;
-  std::vector<BaseType> hash_table_;
-  std::stack<BaseType> unfixed_units_;
-  std::stack<BaseType> unused_units_;
+  std::vector<PairType> hash_table_;
+  std::vector<PairType> old_hash_table_;
+  SizeType num_of_migrated_slots_;
+  SizeType next_migration_;
+  std::vector<BaseType> unfixed_units_;
+  // Freed units are linked by their siblings.
+  BaseType free_unit_index_;
+  SizeType num_of_free_units_;
+  // Spilled transitions precede those in pools.
+  SizeType num_of_spilled_transitions_;
+  SizeType num_of_spilled_states_;
   SizeType num_of_states_;
   SizeType num_of_merged_transitions_;
   SizeType num_of_merging_states_;
+  SizeType num_of_lookups_;
+  SizeType num_of_probes_;
+  SizeType max_probe_length_;
+  SizeType num_of_expansions_;
+  SizeType num_of_rehashed_states_;
+  double rehash_time_;
 
   // Disallows copies.
   DawgBuilder(const DawgBuilder &);
@@ -143,6 +290,13 @@ class DawgBuilder {
       Init();
     }
 
+    // Sibling indices of units are limited, and a key needs a unit for
+    // each label and the end of the key.
+    if (unit_pool_.size() - num_of_free_units_ + length + 1 >
+        DawgUnit::MAX_SIBLING) {
+      return false;
+    }
+
     BaseType index = 0;
     SizeType key_pos = 0;
 
@@ -181,7 +335,7 @@ class DawgBuilder {
       unit_pool_[child_index].set_sibling(unit_pool_[index].child());
       unit_pool_[child_index].set_label(key_label);
       unit_pool_[index].set_child(child_index);
-      unfixed_units_.push(child_index);
+      unfixed_units_.push_back(child_index);
 
       index = child_index;
     }
@@ -191,22 +345,50 @@ class DawgBuilder {
 
   // Initializes an object.
   void Init() {
-    hash_table_.resize(initial_hash_table_size_, 0);
+    InitHashTable();
+
+    num_of_lookups_ = 0;
+    num_of_probes_ = 0;
+    max_probe_length_ = 0;
+    num_of_expansions_ = 0;
+    num_of_rehashed_states_ = 0;
+    rehash_time_ = 0.0;
+
     AllocateUnit();
     AllocateTransition();
     unit_pool_[0].set_label(0xFF);
-    unfixed_units_.push(0);
+    unfixed_units_.push_back(0);
+  }
+
+  // Initializes a hash table.
+  void InitHashTable() {
+    // The size of a hash table is a power of 2 for masking hash values.
+    SizeType hash_table_size = 4;
+    while (hash_table_size < initial_hash_table_size_) {
+      hash_table_size <<= 1;
+    }
+    std::vector<PairType>(hash_table_size, PairType(0, 0)).swap(hash_table_);
+    std::vector<PairType>(0).swap(old_hash_table_);
+    num_of_migrated_slots_ = 0;
+    next_migration_ = num_of_states_ + MIGRATION_INTERVAL;
   }
 
   // Fixes units corresponding to the last inserted key.
   // Also, some of units are merged into equivalent transitions.
   void FixUnits(BaseType index) {
-    while (unfixed_units_.top() != index) {
-      BaseType unfixed_index = unfixed_units_.top();
-      unfixed_units_.pop();
+    while (unfixed_units_.back() != index) {
+      BaseType unfixed_index = unfixed_units_.back();
+      unfixed_units_.pop_back();
 
-      if (num_of_states_ >= hash_table_.size() - (hash_table_.size() >> 2)) {
+      // States of spilled transitions are not in the hash table.
+      if (num_of_states_ - num_of_spilled_states_ >=
+          hash_table_.size() - (hash_table_.size() >> 2)) {
         ExpandHashTable();
+      } else if (num_of_states_ >= next_migration_) {
+        next_migration_ = num_of_states_ + MIGRATION_INTERVAL;
+        if (!old_hash_table_.empty()) {
+          MigrateHashTable(MIGRATION_SIZE);
+        }
       }
 
       BaseType num_of_siblings = 0;
@@ -214,15 +396,18 @@ class DawgBuilder {
         ++num_of_siblings;
       }
 
+      BaseType hash_value = HashUnit(unfixed_index);
       BaseType hash_id;
-      BaseType matched_index = FindUnit(unfixed_index, &hash_id);
+      BaseType matched_index = FindUnit(unfixed_index, hash_value, &hash_id);
       if (matched_index != 0) {
         num_of_merged_transitions_ += num_of_siblings;
 
         // Records a merging state.
-        if (flag_pool_.get(matched_index) == false) {
+        BaseType matched_id = matched_index -
+            static_cast<BaseType>(num_of_spilled_transitions_);
+        if (flag_pool_.get(matched_id) == false) {
           ++num_of_merging_states_;
-          flag_pool_.set(matched_index, true);
+          flag_pool_.set(matched_id, true);
         }
       } else {
         // Fixes units into pairs of base values and labels.
@@ -231,12 +416,14 @@ class DawgBuilder {
           transition_index = AllocateTransition();
         }
         for (BaseType i = unfixed_index; i != 0; i = unit_pool_[i].sibling()) {
-          base_pool_[transition_index].set_base(unit_pool_[i].base());
-          label_pool_[transition_index] = unit_pool_[i].label();
+          BaseType transition_id = transition_index -
+              static_cast<BaseType>(num_of_spilled_transitions_);
+          base_pool_[transition_id].set_base(unit_pool_[i].base());
+          label_pool_[transition_id] = unit_pool_[i].label();
           --transition_index;
         }
         matched_index = transition_index + 1;
-        hash_table_[hash_id] = matched_index;
+        hash_table_[hash_id] = PairType(matched_index, hash_value);
         ++num_of_states_;
       }
 
@@ -247,55 +434,91 @@ class DawgBuilder {
         FreeUnit(current);
       }
 
-      unit_pool_[unfixed_units_.top()].set_child(matched_index);
+      unit_pool_[unfixed_units_.back()].set_child(matched_index);
     }
-    unfixed_units_.pop();
+    unfixed_units_.pop_back();
   }
 
-  // Expands a hash table.
+  // Expands a hash table. States of the old table are moved to the new
+  // table in the following steps, and stored hash values save rescanning
+  // transitions.
   void ExpandHashTable() {
+    if (!old_hash_table_.empty()) {
+      MigrateHashTable(old_hash_table_.size());
+    }
+
     SizeType hash_table_size = hash_table_.size() << 1;
-    std::vector<BaseType>(0).swap(hash_table_);
-    hash_table_.resize(hash_table_size, 0);
-
-    // Builds a new hash table.
-    BaseType count = 0;
-    for (SizeType i = 1; i < base_pool_.size(); ++i) {
-      BaseType index = static_cast<BaseType>(i);
-      if (label_pool_[index] == '\0' || base_pool_[index].is_state()) {
-        BaseType hash_id;
-        FindTransition(index, &hash_id);
-        hash_table_[hash_id] = index;
-        ++count;
+    old_hash_table_.swap(hash_table_);
+    std::vector<PairType>(hash_table_size, PairType(0, 0)).swap(hash_table_);
+    num_of_migrated_slots_ = 0;
+    ++num_of_expansions_;
+  }
+
+  // Moves states in the next slots of the old table to the current table.
+  void MigrateHashTable(SizeType num_of_slots) {
+    std::clock_t start_time = std::clock();
+
+    BaseType mask = static_cast<BaseType>(hash_table_.size() - 1);
+    SizeType end = std::min(num_of_migrated_slots_ + num_of_slots,
+                            old_hash_table_.size());
+    for (SizeType i = num_of_migrated_slots_; i < end; ++i) {
+      if (old_hash_table_[i].first == 0) {
+        continue;
+      }
+      BaseType hash_id = old_hash_table_[i].second & mask;
+      while (hash_table_[hash_id].first != 0) {
+        hash_id = (hash_id + 1) & mask;
       }
+      hash_table_[hash_id] = old_hash_table_[i];
+      ++num_of_rehashed_states_;
     }
+    num_of_migrated_slots_ = end;
+
+    if (num_of_migrated_slots_ == old_hash_table_.size()) {
+      std::vector<PairType>(0).swap(old_hash_table_);
+      num_of_migrated_slots_ = 0;
+    }
+    rehash_time_ += static_cast<double>(std::clock() - start_time) /
+        CLOCKS_PER_SEC;
   }
 
-  // Finds a transition from a hash table.
-  BaseType FindTransition(BaseType index, BaseType *hash_id) const {
-    *hash_id = HashTransition(index) % hash_table_.size();
-    for ( ; ; *hash_id = (*hash_id + 1) % hash_table_.size()) {
-      BaseType transition_id = hash_table_[*hash_id];
-      if (transition_id == 0) {
-        break;
-      }
+  // Finds a unit from a hash table. If not found, hash_id is set to an
+  // empty slot of the current table. States which are not yet moved are
+  // found in the old table.
+  BaseType FindUnit(BaseType unit_index, BaseType hash_value,
+                    BaseType *hash_id) {
+    ++num_of_lookups_;
+    SizeType probe_length = 0;
+    BaseType matched_index = FindUnit(hash_table_, unit_index, hash_value,
+                                      hash_id, &probe_length);
+    if (matched_index == 0 && !old_hash_table_.empty()) {
+      BaseType old_hash_id;
+      matched_index = FindUnit(old_hash_table_, unit_index, hash_value,
+                               &old_hash_id, &probe_length);
+    }
 
-      // There must not be the same base value.
+    num_of_probes_ += probe_length;
+    if (probe_length > max_probe_length_) {
+      max_probe_length_ = probe_length;
     }
-    return 0;
+    return matched_index;
   }
 
-  // Finds a unit from a hash table.
-  BaseType FindUnit(BaseType unit_index, BaseType *hash_id) const {
-    *hash_id = HashUnit(unit_index) % hash_table_.size();
-    for ( ; ; *hash_id = (*hash_id + 1) % hash_table_.size()) {
-      BaseType transition_id = hash_table_[*hash_id];
-      if (transition_id == 0) {
+  // Finds a unit from a table by linear probing. Stored hash values are
+  // compared before transitions.
+  BaseType FindUnit(const std::vector<PairType> &table, BaseType unit_index,
+                    BaseType hash_value, BaseType *hash_id,
+                    SizeType *probe_length) const {
+    BaseType mask = static_cast<BaseType>(table.size() - 1);
+    for (*hash_id = hash_value & mask; ; *hash_id = (*hash_id + 1) & mask) {
+      ++*probe_length;
+      const PairType &pair = table[*hash_id];
+      if (pair.first == 0) {
         break;
       }
 
-      if (AreEqual(unit_index, transition_id)) {
-        return transition_id;
+      if (pair.second == hash_value && AreEqual(unit_index, pair.first)) {
+        return pair.first;
       }
     }
     return 0;
@@ -303,6 +526,8 @@ class DawgBuilder {
 
   // Compares a unit and a transition.
   bool AreEqual(BaseType unit_index, BaseType transition_index) const {
+    transition_index -= static_cast<BaseType>(num_of_spilled_transitions_);
+
     // Compares the numbers of transitions.
     for (BaseType i = unit_pool_[unit_index].sibling(); i != 0;
          i = unit_pool_[i].sibling()) {
@@ -326,21 +551,6 @@ class DawgBuilder {
     return true;
   }
 
-  // Calculates a hash value from a transition.
-  BaseType HashTransition(BaseType index) const {
-    BaseType hash_value = 0;
-    for ( ; index != 0; ++index) {
-      BaseType base = base_pool_[index].base();
-      UCharType label = label_pool_[index];
-      hash_value ^= Hash((label << 24) ^ base);
-
-      if (base_pool_[index].has_sibling() == false) {
-        break;
-      }
-    }
-    return hash_value;
-  }
-
   // Calculates a hash value from a unit.
   BaseType HashUnit(BaseType index) const {
     BaseType hash_value = 0;
@@ -364,29 +574,34 @@ class DawgBuilder {
     return key;
   }
 
-  // Gets a transition from object pools.
+  // Gets a transition from object pools. Its index follows spilled
+  // transitions.
   BaseType AllocateTransition() {
     flag_pool_.Allocate();
     base_pool_.Allocate();
-    return static_cast<BaseType>(label_pool_.Allocate());
+    return static_cast<BaseType>(num_of_spilled_transitions_ +
+                                 label_pool_.Allocate());
   }
 
-  // Gets a unit from an object pool.
+  // Gets a unit from a free list or an object pool. The root unit is never
+  // freed, so 0 terminates a free list.
   BaseType AllocateUnit() {
-    BaseType index = 0;
-    if (unused_units_.empty()) {
+    BaseType index = free_unit_index_;
+    if (index == 0) {
       index = static_cast<BaseType>(unit_pool_.Allocate());
     } else {
-      index = unused_units_.top();
-      unused_units_.pop();
+      free_unit_index_ = unit_pool_[index].sibling();
+      --num_of_free_units_;
     }
     unit_pool_[index].Clear();
     return index;
   }
 
-  // Returns a unit to an object pool.
+  // Returns a unit to a free list.
   void FreeUnit(BaseType index) {
-    unused_units_.push(index);
+    unit_pool_[index].set_sibling(free_unit_index_);
+    free_unit_index_ = index;
+    ++num_of_free_units_;
   }
 };
 
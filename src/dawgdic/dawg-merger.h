@@ -0,0 +1,360 @@
+#ifndef DAWGDIC_DAWG_MERGER_H
+#define DAWGDIC_DAWG_MERGER_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "dawg.h"
+
+namespace dawgdic {
+
+// Merger of dawgs which are built from consecutive ranges of a sorted
+// lexicon, such that keys of different ranges start with different labels.
+// States of each dawg are added in order of their transitions, which is
+// the order in which a sequential DawgBuilder fixes them, so the merged
+// dawg is the same as a dawg built from the whole lexicon.
+class DawgMerger {
+ public:
+  explicit DawgMerger(SizeType initial_hash_table_size =
+                      DEFAULT_INITIAL_HASH_TABLE_SIZE)
+    : initial_hash_table_size_(initial_hash_table_size),
+      base_pool_(), label_pool_(), flag_pool_(), hash_table_(),
+      old_hash_table_(), num_of_migrated_slots_(0), next_migration_(0),
+      root_bases_(), root_labels_(), index_map_(), group_bases_(),
+      group_labels_(), num_of_states_(1), num_of_merged_transitions_(0),
+      num_of_merging_states_(0) {}
+
+  // Number of transitions.
+  SizeType num_of_transitions() const {
+    return (base_pool_.size() != 0) ? (base_pool_.size() - 1) : 0;
+  }
+  // Number of states.
+  SizeType num_of_states() const {
+    return num_of_states_;
+  }
+  // Number of bytes allocated for transitions and a hash table.
+  SizeType memory_usage() const {
+    return base_pool_.memory_usage() + label_pool_.memory_usage() +
+        flag_pool_.memory_usage() + sizeof(PairType) *
+        (hash_table_.capacity() + old_hash_table_.capacity()) +
+        sizeof(BaseType) * (index_map_.capacity() + root_bases_.capacity()) +
+        root_labels_.capacity();
+  }
+
+  // Initializes a merger.
+  void Clear() {
+    base_pool_.Clear();
+    label_pool_.Clear();
+    flag_pool_.Clear();
+
+    std::vector<PairType>(0).swap(hash_table_);
+    std::vector<PairType>(0).swap(old_hash_table_);
+    num_of_migrated_slots_ = 0;
+    next_migration_ = 0;
+    std::vector<BaseType>(0).swap(root_bases_);
+    std::vector<UCharType>(0).swap(root_labels_);
+    std::vector<BaseType>(0).swap(index_map_);
+    std::vector<BaseType>(0).swap(group_bases_);
+    std::vector<UCharType>(0).swap(group_labels_);
+
+    num_of_states_ = 1;
+    num_of_merged_transitions_ = 0;
+    num_of_merging_states_ = 0;
+  }
+
+  // Adds a dawg of the next range. Fails if its first labels are not
+  // greater than those of the previous dawgs.
+  bool Add(const Dawg &dawg) {
+    // Initializes a merger if not initialized.
+    if (hash_table_.empty()) {
+      Init();
+    }
+
+    if (dawg.size() <= 1) {
+      return true;
+    }
+    BaseType root_index = dawg.child(dawg.root());
+    if (!root_labels_.empty() &&
+        dawg.label(root_index) <= root_labels_.back()) {
+      return false;
+    }
+
+    std::vector<BaseType>(dawg.size(), 0).swap(index_map_);
+    for (BaseType begin = 1; begin < dawg.size(); ) {
+      BaseType end = begin;
+      while (dawg.sibling(end) != 0) {
+        ++end;
+      }
+      ++end;
+
+      if (begin == root_index) {
+        // Transitions from the root are merged in Finish().
+        for (BaseType i = begin; i < end; ++i) {
+          root_bases_.push_back(MapBase(dawg, i));
+          root_labels_.push_back(dawg.label(i));
+        }
+      } else {
+        group_bases_.clear();
+        group_labels_.clear();
+        for (BaseType i = begin; i < end; ++i) {
+          group_bases_.push_back(MapBase(dawg, i));
+          group_labels_.push_back(dawg.label(i));
+        }
+        BaseType index = FixGroup();
+
+        // Merging states of a dawg are also merging in a merged dawg.
+        if (dawg.is_merging(begin)) {
+          SetMerging(index);
+        }
+        index_map_[begin] = index;
+      }
+      begin = end;
+    }
+    num_of_merged_transitions_ += dawg.num_of_merged_transitions();
+    return true;
+  }
+
+  // Finishes merging dawgs.
+  bool Finish(Dawg *dawg) {
+    // Initializes a merger if not initialized.
+    if (hash_table_.empty()) {
+      Init();
+    }
+
+    BaseType root_base = 0;
+    if (!root_bases_.empty()) {
+      // Transitions from the root of a merged dawg have siblings except
+      // the last one, and only the first one has a flag of a state.
+      for (SizeType i = 0; i < root_bases_.size(); ++i) {
+        root_bases_[i] = (root_bases_[i] & ~static_cast<BaseType>(3)) |
+            ((i == 0) ? 2 : 0) | ((i + 1 < root_bases_.size()) ? 1 : 0);
+      }
+      group_bases_.swap(root_bases_);
+      group_labels_.swap(root_labels_);
+      root_base = FixGroup() << 2;
+    }
+    base_pool_[0].set_base(root_base);
+    label_pool_[0] = 0xFF;
+
+    dawg->set_num_of_states(num_of_states_);
+    dawg->set_num_of_merged_transitions(num_of_merged_transitions_);
+    dawg->set_num_of_merged_states(num_of_transitions()
+        + num_of_merged_transitions_ + 1 - num_of_states_);
+    dawg->set_num_of_merging_states(num_of_merging_states_);
+
+    dawg->SwapBasePool(&base_pool_);
+    dawg->SwapLabelPool(&label_pool_);
+    dawg->SwapFlagPool(&flag_pool_);
+
+    Clear();
+    return true;
+  }
+
+ private:
+  enum {
+    DEFAULT_INITIAL_HASH_TABLE_SIZE = 1 << 8,
+    // An expanded hash table takes states from its old table in steps, as
+    // that of DawgBuilder does.
+    MIGRATION_INTERVAL = 1 << 9,
+    MIGRATION_SIZE = MIGRATION_INTERVAL * 2
+  };
+
+  // Pair of the first transition of a state and its hash value.
+  typedef std::pair<BaseType, BaseType> PairType;
+
+  const SizeType initial_hash_table_size_;
+  ObjectPool<BaseUnit> base_pool_;
+  ObjectPool<UCharType> label_pool_;
+  BitPool<> flag_pool_;
+  std::vector<PairType> hash_table_;
+  std::vector<PairType> old_hash_table_;
+  SizeType num_of_migrated_slots_;
+  SizeType next_migration_;
+  std::vector<BaseType> root_bases_;
+  std::vector<UCharType> root_labels_;
+  std::vector<BaseType> index_map_;
+  std::vector<BaseType> group_bases_;
+  std::vector<UCharType> group_labels_;
+  SizeType num_of_states_;
+  SizeType num_of_merged_transitions_;
+  SizeType num_of_merging_states_;
+
+  // Disallows copies.
+  DawgMerger(const DawgMerger &);
+  DawgMerger &operator=(const DawgMerger &);
+
+  // Initializes an object.
+  void Init() {
+    // The size of a hash table is a power of 2 for masking hash values.
+    SizeType hash_table_size = 4;
+    while (hash_table_size < initial_hash_table_size_) {
+      hash_table_size <<= 1;
+    }
+    hash_table_.resize(hash_table_size, PairType(0, 0));
+    next_migration_ = MIGRATION_INTERVAL;
+    AllocateTransition();
+  }
+
+  // Gets a base value of a transition, whose child is replaced with an
+  // index of a merged dawg.
+  BaseType MapBase(const Dawg &dawg, BaseType index) const {
+    BaseType base = (static_cast<BaseType>(dawg.value(index)) << 1) |
+        (dawg.sibling(index) ? 1 : 0);
+    if (dawg.is_leaf(index)) {
+      return base;
+    }
+    return (index_map_[dawg.child(index)] << 2) | (base & 3);
+  }
+
+  // Finds a state of the current group of transitions, or adds it as a
+  // new state, and returns its index.
+  BaseType FixGroup() {
+    if (num_of_states_ >= hash_table_.size() - (hash_table_.size() >> 2)) {
+      ExpandHashTable();
+    } else if (num_of_states_ >= next_migration_) {
+      next_migration_ = num_of_states_ + MIGRATION_INTERVAL;
+      if (!old_hash_table_.empty()) {
+        MigrateHashTable(MIGRATION_SIZE);
+      }
+    }
+
+    BaseType hash_value = HashGroup();
+    BaseType hash_id;
+    BaseType matched_index = FindGroup(hash_value, &hash_id);
+    if (matched_index != 0) {
+      num_of_merged_transitions_ += group_bases_.size();
+      SetMerging(matched_index);
+      return matched_index;
+    }
+
+    matched_index = AllocateTransition();
+    for (SizeType i = 1; i < group_bases_.size(); ++i) {
+      AllocateTransition();
+    }
+    for (SizeType i = 0; i < group_bases_.size(); ++i) {
+      base_pool_[matched_index + i].set_base(group_bases_[i]);
+      label_pool_[matched_index + i] = group_labels_[i];
+    }
+    hash_table_[hash_id] = PairType(matched_index, hash_value);
+    ++num_of_states_;
+    return matched_index;
+  }
+
+  // Records a merging state.
+  void SetMerging(BaseType index) {
+    if (flag_pool_.get(index) == false) {
+      ++num_of_merging_states_;
+      flag_pool_.set(index, true);
+    }
+  }
+
+  // Expands a hash table. States of the old table are moved to the new
+  // table in the following steps, and stored hash values save rescanning
+  // transitions.
+  void ExpandHashTable() {
+    if (!old_hash_table_.empty()) {
+      MigrateHashTable(old_hash_table_.size());
+    }
+
+    SizeType hash_table_size = hash_table_.size() << 1;
+    old_hash_table_.swap(hash_table_);
+    std::vector<PairType>(hash_table_size, PairType(0, 0)).swap(hash_table_);
+    num_of_migrated_slots_ = 0;
+  }
+
+  // Moves states in the next slots of the old table to the current table.
+  void MigrateHashTable(SizeType num_of_slots) {
+    BaseType mask = static_cast<BaseType>(hash_table_.size() - 1);
+    SizeType end = std::min(num_of_migrated_slots_ + num_of_slots,
+                            old_hash_table_.size());
+    for (SizeType i = num_of_migrated_slots_; i < end; ++i) {
+      if (old_hash_table_[i].first == 0) {
+        continue;
+      }
+      BaseType hash_id = old_hash_table_[i].second & mask;
+      while (hash_table_[hash_id].first != 0) {
+        hash_id = (hash_id + 1) & mask;
+      }
+      hash_table_[hash_id] = old_hash_table_[i];
+    }
+    num_of_migrated_slots_ = end;
+
+    if (num_of_migrated_slots_ == old_hash_table_.size()) {
+      std::vector<PairType>(0).swap(old_hash_table_);
+      num_of_migrated_slots_ = 0;
+    }
+  }
+
+  // Finds the current group from a hash table. If not found, hash_id is set
+  // to an empty slot of the current table. States which are not yet moved
+  // are found in the old table.
+  BaseType FindGroup(BaseType hash_value, BaseType *hash_id) const {
+    BaseType matched_index = FindGroup(hash_table_, hash_value, hash_id);
+    if (matched_index == 0 && !old_hash_table_.empty()) {
+      BaseType old_hash_id;
+      matched_index = FindGroup(old_hash_table_, hash_value, &old_hash_id);
+    }
+    return matched_index;
+  }
+
+  // Finds the current group from a table by linear probing. Stored hash
+  // values are compared before transitions.
+  BaseType FindGroup(const std::vector<PairType> &table, BaseType hash_value,
+                     BaseType *hash_id) const {
+    BaseType mask = static_cast<BaseType>(table.size() - 1);
+    for (*hash_id = hash_value & mask; ; *hash_id = (*hash_id + 1) & mask) {
+      const PairType &pair = table[*hash_id];
+      if (pair.first == 0) {
+        break;
+      }
+
+      if (pair.second == hash_value && AreEqual(pair.first)) {
+        return pair.first;
+      }
+    }
+    return 0;
+  }
+
+  // Compares the current group and transitions of a state.
+  bool AreEqual(BaseType index) const {
+    for (SizeType i = 0; i < group_bases_.size(); ++i, ++index) {
+      if (group_bases_[i] != base_pool_[index].base() ||
+          group_labels_[i] != label_pool_[index]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Calculates a hash value from the current group.
+  BaseType HashGroup() const {
+    BaseType hash_value = 0;
+    for (SizeType i = 0; i < group_bases_.size(); ++i) {
+      hash_value ^= Hash((group_labels_[i] << 24) ^ group_bases_[i]);
+    }
+    return hash_value;
+  }
+
+  // 32-bit mix function, which is the same as that of DawgBuilder.
+  static BaseType Hash(BaseType key) {
+    key = ~key + (key << 15);
+    key = key ^ (key >> 12);
+    key = key + (key << 2);
+    key = key ^ (key >> 4);
+    key = key * 2057;
+    key = key ^ (key >> 16);
+    return key;
+  }
+
+  // Gets a transition from object pools.
+  BaseType AllocateTransition() {
+    flag_pool_.Allocate();
+    base_pool_.Allocate();
+    return static_cast<BaseType>(label_pool_.Allocate());
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_DAWG_MERGER_H
@@ -5,76 +5,89 @@
 
 namespace dawgdic {
 
-// Unit for building a dawg.
+// Unit for building a dawg, which is packed into 8 bytes. The first word
+// has a child index or a value and the flag of a sibling. The second word
+// has a sibling index, the flag of a state and a label.
 class DawgUnit {
  public:
-  DawgUnit()
-    : child_(0), sibling_(0), label_('\0'),
-      is_state_(false), has_sibling_(false) {}
+  enum {
+    // Upper bound of sibling indices, which are indices of units.
+    MAX_SIBLING = (1 << 23) - 1
+  };
+
+  DawgUnit() : child_(0), sibling_(0) {}
 
   // Writes values.
   void set_child(BaseType child) {
-    child_ = child;
+    child_ = (child_ & HAS_SIBLING_BIT) | child;
   }
   void set_sibling(BaseType sibling) {
-    sibling_ = sibling;
+    sibling_ = (sibling_ & ~SIBLING_MASK) | (sibling << 9);
   }
   void set_value(ValueType value) {
-    child_ = value;
+    set_child(static_cast<BaseType>(value));
   }
   void set_label(UCharType label) {
-    label_ = label;
+    sibling_ = (sibling_ & ~LABEL_MASK) | label;
   }
   void set_is_state(bool is_state) {
-    is_state_ = is_state;
+    if (is_state) {
+      sibling_ |= IS_STATE_BIT;
+    } else {
+      sibling_ &= ~IS_STATE_BIT;
+    }
   }
   void set_has_sibling(bool has_sibling) {
-    has_sibling_ = has_sibling;
+    if (has_sibling) {
+      child_ |= HAS_SIBLING_BIT;
+    } else {
+      child_ &= ~HAS_SIBLING_BIT;
+    }
   }
 
   // Reads values.
   BaseType child() const {
-    return child_;
+    return child_ & ~HAS_SIBLING_BIT;
   }
   BaseType sibling() const {
-    return sibling_;
+    return sibling_ >> 9;
   }
   ValueType value() const {
-    return static_cast<ValueType>(child_);
+    return static_cast<ValueType>(child());
   }
   UCharType label() const {
-    return label_;
+    return static_cast<UCharType>(sibling_ & LABEL_MASK);
   }
   bool is_state() const {
-    return is_state_;
+    return (sibling_ & IS_STATE_BIT) != 0;
   }
   bool has_sibling() const {
-    return has_sibling_;
+    return (child_ & HAS_SIBLING_BIT) != 0;
   }
 
   // Calculates a base value of a unit.
   BaseType base() const {
-    if (label_ == '\0') {
-      return (child_ << 1) | (has_sibling_ ? 1 : 0);
+    BaseType has_sibling = child_ >> 31;
+    if (label() == '\0') {
+      return (child() << 1) | has_sibling;
     }
-    return (child_ << 2) | (is_state_ ? 2 : 0) | (has_sibling_ ? 1 : 0);
+    return (child() << 2) | (is_state() ? 2 : 0) | has_sibling;
   }
 
   // Initializes a unit.
   void Clear() {
     child_ = 0;
     sibling_ = 0;
-    label_ = '\0';
-    is_state_ = false;
-    has_sibling_ = false;
   }
 
  private:
+  static const BaseType LABEL_MASK = 0xFF;
+  static const BaseType IS_STATE_BIT = static_cast<BaseType>(1) << 8;
+  static const BaseType SIBLING_MASK = ~static_cast<BaseType>(0x1FF);
+  static const BaseType HAS_SIBLING_BIT = static_cast<BaseType>(1) << 31;
+
   BaseType child_;
   BaseType sibling_;
-  UCharType label_;
-  bool is_state_;
-  bool has_sibling_;
 
   // Copyable.
 };
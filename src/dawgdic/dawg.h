@@ -1,6 +1,10 @@
 #ifndef DAWGDIC_DAWG_H
 #define DAWGDIC_DAWG_H
 
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
 #include "base-unit.h"
 #include "bit-pool.h"
 #include "object-pool.h"
@@ -44,6 +48,17 @@ class Dawg {
     return num_of_merging_states_;
   }
 
+  // Number of bytes allocated for units. A mapped dawg uses no memory.
+  SizeType memory_usage() const {
+    return base_pool_.memory_usage() + label_pool_.memory_usage() +
+        flag_pool_.memory_usage();
+  }
+  // Number of bytes written by Write().
+  SizeType file_size() const {
+    return sizeof(BaseType) * (NUM_OF_HEADER_FIELDS + size()) +
+        LabelsSize(size()) + FlagsSize(size());
+  }
+
   // Reads values.
   BaseType child(BaseType index) const {
     return base_pool_[index].child();
@@ -65,13 +80,100 @@ class Dawg {
     return flag_pool_.get(index);
   }
 
+  // Layout of a file written by Write(), which is also read by PagedDawg.
+  enum {
+    // Number of statistics written before units.
+    NUM_OF_HEADER_FIELDS = 5
+  };
+  // Sizes of arrays, which are aligned to base values.
+  static SizeType LabelsSize(SizeType size) {
+    return (size + sizeof(BaseType) - 1) & ~(sizeof(BaseType) - 1);
+  }
+  static SizeType FlagsSize(SizeType size) {
+    return LabelsSize((size + 7) / 8);
+  }
+
+  // Writes a dawg to an output stream. Its units are written as arrays of
+  // base values, labels and flags, so that Map() can use them in place.
+  bool Write(std::ostream *output) const {
+    BaseType header[NUM_OF_HEADER_FIELDS] = {
+      static_cast<BaseType>(size()),
+      static_cast<BaseType>(num_of_states_),
+      static_cast<BaseType>(num_of_merged_transitions_),
+      static_cast<BaseType>(num_of_merged_states_),
+      static_cast<BaseType>(num_of_merging_states_)
+    };
+    if (!output->write(reinterpret_cast<const char *>(header),
+                       sizeof(header))) {
+      return false;
+    }
+
+    std::vector<BaseType> bases;
+    std::vector<UCharType> bytes;
+    for (SizeType begin = 0; begin < size(); begin += WRITE_BUF_SIZE) {
+      SizeType end = std::min(begin + WRITE_BUF_SIZE, size());
+      bases.clear();
+      for (SizeType i = begin; i < end; ++i) {
+        bases.push_back(base_pool_[i].base());
+      }
+      if (!output->write(reinterpret_cast<const char *>(&bases[0]),
+                         sizeof(BaseType) * bases.size())) {
+        return false;
+      }
+    }
+
+    bytes.resize(LabelsSize(size()), 0);
+    for (SizeType i = 0; i < size(); ++i) {
+      bytes[i] = label_pool_[i];
+    }
+    if (!bytes.empty() &&
+        !output->write(reinterpret_cast<const char *>(&bytes[0]),
+                       bytes.size())) {
+      return false;
+    }
+
+    std::vector<UCharType>(FlagsSize(size()), 0).swap(bytes);
+    for (SizeType i = 0; i < size(); ++i) {
+      if (flag_pool_.get(i)) {
+        bytes[i / 8] |= static_cast<UCharType>(1 << (i % 8));
+      }
+    }
+    if (!bytes.empty() &&
+        !output->write(reinterpret_cast<const char *>(&bytes[0]),
+                       bytes.size())) {
+      return false;
+    }
+    return true;
+  }
+
+  // Maps memory written by Write(), such as a mapped file, which must be
+  // alive while a dawg is used.
+  void Map(const void *address) {
+    Clear();
+    const BaseType *header = static_cast<const BaseType *>(address);
+    SizeType size = header[0];
+    num_of_states_ = header[1];
+    num_of_merged_transitions_ = header[2];
+    num_of_merged_states_ = header[3];
+    num_of_merging_states_ = header[4];
+
+    const BaseType *bases = header + NUM_OF_HEADER_FIELDS;
+    const UCharType *labels = reinterpret_cast<const UCharType *>(
+        bases + size);
+    base_pool_.Map(reinterpret_cast<const BaseUnit *>(bases), size);
+    label_pool_.Map(labels, size);
+    flag_pool_.Map(labels + LabelsSize(size), size);
+  }
+
   // Clears object pools.
   void Clear() {
     base_pool_.Clear();
     label_pool_.Clear();
     flag_pool_.Clear();
     num_of_states_ = 0;
+    num_of_merged_transitions_ = 0;
     num_of_merged_states_ = 0;
+    num_of_merging_states_ = 0;
   }
 
   // Swaps dawgs.
@@ -119,6 +221,11 @@ class Dawg {
   }
 
  private:
+  enum {
+    // Number of base values written at once.
+    WRITE_BUF_SIZE = 1 << 12
+  };
+
   ObjectPool<BaseUnit> base_pool_;
   ObjectPool<UCharType> label_pool_;
   BitPool<> flag_pool_;
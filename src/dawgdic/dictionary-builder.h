@@ -1,30 +1,68 @@
 #ifndef DAWGDIC_DICTIONARY_BUILDER_H
 #define DAWGDIC_DICTIONARY_BUILDER_H
 
+#include <algorithm>
+#include <queue>
 #include <vector>
 
+#include "access-profile.h"
+#include "build-progress.h"
 #include "dawg.h"
 #include "dictionary.h"
-#include "dictionary-extra-unit.h"
+#include "dictionary-extra-block.h"
 #include "link-table.h"
 
 namespace dawgdic {
 
-class DictionaryBuilder {
+// Builder of a dictionary from a dawg. The types of a dawg, an array of
+// units and a table of links are parameters, so that a dictionary is also
+// built from a PagedDawg into files. See ExternalDictionaryBuilder.
+template <typename DAWG_TYPE, typename UNIT_ARRAY_TYPE,
+          typename LINK_TABLE_TYPE>
+class BasicDictionaryBuilder {
  public:
   enum {
     // Number of units in a block.
-    BLOCK_SIZE = 256,
+    BLOCK_SIZE = DictionaryExtraBlock::SIZE,
     // Number of blocks kept unfixed.
     NUM_OF_UNFIXED_BLOCKS = 16,
     // Number of units kept unfixed.
-    UNFIXED_SIZE = BLOCK_SIZE * NUM_OF_UNFIXED_BLOCKS
+    UNFIXED_SIZE = BLOCK_SIZE * NUM_OF_UNFIXED_BLOCKS,
+    // Default number of units in a hot region (1 MiB).
+    DEFAULT_HOT_REGION_SIZE = 1 << 18
   };
 
-  // Builds a dictionary from a list-form dawg.
-  static bool Build(const Dawg &dawg, Dictionary *dic,
-                    BaseType *num_of_unused_units = NULL) {
-    DictionaryBuilder builder(dawg, dic);
+  // Builds a dictionary from a list-form dawg. If a progress is given, it
+  // is updated while building.
+  static bool Build(const DAWG_TYPE &dawg, Dictionary *dic,
+                    BaseType *num_of_unused_units = NULL,
+                    BuildProgress *progress = NULL) {
+    return Build(dawg, static_cast<const AccessProfile *>(NULL), 0, dic,
+                 num_of_unused_units, progress);
+  }
+
+  // Builds a dictionary whose frequently accessed units are packed into
+  // a hot region at the front of the units. Nodes are arranged in
+  // descending order of their weights given by a profile until the hot
+  // region is filled, and the rest of nodes are arranged depth-first.
+  static bool Build(const DAWG_TYPE &dawg, const AccessProfile &profile,
+                    Dictionary *dic, BaseType *num_of_unused_units = NULL,
+                    SizeType hot_region_size = DEFAULT_HOT_REGION_SIZE,
+                    BuildProgress *progress = NULL) {
+    return Build(dawg, &profile, hot_region_size, dic, num_of_unused_units,
+                 progress);
+  }
+
+  // Builds units of a dictionary into an empty array. A table of links
+  // must be initialized for merging states of a dawg. A profile is
+  // optional, and it is used as above if given.
+  static bool BuildUnits(const DAWG_TYPE &dawg, const AccessProfile *profile,
+                         SizeType hot_region_size, UNIT_ARRAY_TYPE *units,
+                         LINK_TABLE_TYPE *link_table,
+                         BaseType *num_of_unused_units = NULL,
+                         BuildProgress *progress = NULL) {
+    BasicDictionaryBuilder builder(dawg, units, link_table, profile,
+                                   hot_region_size, progress);
     if (!builder.BuildDictionary()) {
       return false;
     }
@@ -35,50 +73,176 @@ class DictionaryBuilder {
   }
 
  private:
-  const Dawg &dawg_;
-  Dictionary *dic_;
+  // Frame of a stack for building a dictionary depth-first, which keeps
+  // the next child of a node and an offset to its children.
+  class Frame {
+   public:
+    Frame(BaseType dawg_child_index, BaseType offset)
+      : dawg_child_index_(dawg_child_index), offset_(offset) {}
+
+    void set_dawg_child_index(BaseType dawg_child_index) {
+      dawg_child_index_ = dawg_child_index;
+    }
+
+    BaseType dawg_child_index() const {
+      return dawg_child_index_;
+    }
+    BaseType offset() const {
+      return offset_;
+    }
+
+   private:
+    BaseType dawg_child_index_;
+    BaseType offset_;
+
+    // Copyable.
+  };
+
+  // Node waiting to be arranged in a hot region. Its profile range is
+  // a range of sorted profile keys which pass through the node.
+  class HotNode {
+   public:
+    HotNode(BaseType dawg_index, BaseType dic_index, SizeType depth,
+            SizeType profile_begin, SizeType profile_end,
+            UInt64Type weight, SizeType order)
+      : dawg_index_(dawg_index), dic_index_(dic_index), depth_(depth),
+        profile_begin_(profile_begin), profile_end_(profile_end),
+        weight_(weight), order_(order) {}
+
+    BaseType dawg_index() const {
+      return dawg_index_;
+    }
+    BaseType dic_index() const {
+      return dic_index_;
+    }
+    SizeType depth() const {
+      return depth_;
+    }
+    SizeType profile_begin() const {
+      return profile_begin_;
+    }
+    SizeType profile_end() const {
+      return profile_end_;
+    }
+    UInt64Type weight() const {
+      return weight_;
+    }
+
+    // For popping the heaviest node first.
+    bool operator<(const HotNode &rhs) const {
+      if (weight_ != rhs.weight_) {
+        return weight_ < rhs.weight_;
+      }
+      return order_ > rhs.order_;
+    }
+
+   private:
+    BaseType dawg_index_;
+    BaseType dic_index_;
+    SizeType depth_;
+    SizeType profile_begin_;
+    SizeType profile_end_;
+    UInt64Type weight_;
+    SizeType order_;
+
+    // Copyable.
+  };
+
+  // For sorting profile keys.
+  class ProfileKeyComparer {
+   public:
+    explicit ProfileKeyComparer(const AccessProfile &profile)
+      : profile_(&profile) {}
 
-  std::vector<DictionaryUnit> units_;
-  std::vector<DictionaryExtraUnit *> extras_;
+    bool operator()(SizeType lhs, SizeType rhs) const {
+      return std::lexicographical_compare(
+          profile_->key(lhs), profile_->key(lhs) + profile_->length(lhs),
+          profile_->key(rhs), profile_->key(rhs) + profile_->length(rhs));
+    }
+
+   private:
+    const AccessProfile *profile_;
+  };
+
+  const DAWG_TYPE &dawg_;
+  UNIT_ARRAY_TYPE *units_;
+  LINK_TABLE_TYPE *link_table_;
+  const AccessProfile *profile_;
+  SizeType hot_region_size_;
+  BuildProgress *progress_;
+
+  std::vector<DictionaryExtraBlock *> extras_;
   std::vector<UCharType> labels_;
-  LinkTable link_table_;
-  BaseType unfixed_index_;
+  std::vector<Frame> frames_;
+  std::vector<SizeType> profile_ids_;
+  std::vector<UInt64Type> profile_weights_;
+  // Ids of blocks which have unfixed units, in ascending order.
+  std::vector<BaseType> unfixed_block_ids_;
   BaseType num_of_unused_units_;
 
   // Masks for offsets.
   static const BaseType UPPER_MASK = ~(DictionaryUnit::OFFSET_MAX - 1);
   static const BaseType LOWER_MASK = 0xFF;
 
-  // Disallows copies.
-  DictionaryBuilder(const DictionaryBuilder &);
-  DictionaryBuilder &operator=(const DictionaryBuilder &);
+  enum {
+    // Number of unfixed units in a block which are checked one by one
+    // before bit sets are used.
+    MAX_NUM_OF_SCALAR_CHECKS = 16,
+    // Number of frames allocated to a stack in advance.
+    INITIAL_STACK_SIZE = 1 << 10
+  };
 
-  DictionaryBuilder(const Dawg &dawg, Dictionary *dic)
-    : dawg_(dawg), dic_(dic), units_(), extras_(), labels_(),
-      link_table_(), unfixed_index_(), num_of_unused_units_(0) {}
-  ~DictionaryBuilder() {
+  // Disallows copies.
+  BasicDictionaryBuilder(const BasicDictionaryBuilder &);
+  BasicDictionaryBuilder &operator=(const BasicDictionaryBuilder &);
+
+  BasicDictionaryBuilder(const DAWG_TYPE &dawg, UNIT_ARRAY_TYPE *units,
+                         LINK_TABLE_TYPE *link_table,
+                         const AccessProfile *profile,
+                         SizeType hot_region_size, BuildProgress *progress)
+    : dawg_(dawg), units_(units), link_table_(link_table), profile_(profile),
+      hot_region_size_(hot_region_size), progress_(progress), extras_(),
+      labels_(), frames_(), profile_ids_(), profile_weights_(),
+      unfixed_block_ids_(), num_of_unused_units_(0) {}
+  ~BasicDictionaryBuilder() {
     for (SizeType i = 0; i < extras_.size(); ++i) {
-      delete [] extras_[i];
+      delete extras_[i];
     }
   }
 
+  // Builds a dictionary with a table of links initialized as usual.
+  static bool Build(const DAWG_TYPE &dawg, const AccessProfile *profile,
+                    SizeType hot_region_size, Dictionary *dic,
+                    BaseType *num_of_unused_units, BuildProgress *progress) {
+    std::vector<DictionaryUnit> units;
+    LinkTable link_table;
+    link_table.Init(dawg.num_of_merging_states() +
+        (dawg.num_of_merging_states() >> 1));
+    if (!BuildUnits(dawg, profile, hot_region_size, &units, &link_table,
+                    num_of_unused_units, progress)) {
+      return false;
+    }
+    dic->SwapUnitsBuf(&units);
+    return true;
+  }
+
   // Accesses units.
   DictionaryUnit &units(BaseType index) {
-    return units_[index];
+    return (*units_)[index];
   }
   const DictionaryUnit &units(BaseType index) const {
-    return units_[index];
+    return (*units_)[index];
   }
-  DictionaryExtraUnit &extras(BaseType index) {
-    return extras_[index / BLOCK_SIZE][index % BLOCK_SIZE];
+  DictionaryExtraBlock &extras(BaseType index) {
+    return *extras_[index / BLOCK_SIZE];
   }
-  const DictionaryExtraUnit &extras(BaseType index) const {
-    return extras_[index / BLOCK_SIZE][index % BLOCK_SIZE];
+  const DictionaryExtraBlock &extras(BaseType index) const {
+    return *extras_[index / BLOCK_SIZE];
   }
 
   // Number of units.
   BaseType num_of_units() const {
-    return static_cast<BaseType>(units_.size());
+    return static_cast<BaseType>(units_->size());
   }
   // Number of blocks.
   BaseType num_of_blocks() const {
@@ -87,28 +251,166 @@ class DictionaryBuilder {
 
   // Builds a dictionary from a list-form dawg.
   bool BuildDictionary() {
-    link_table_.Init(dawg_.num_of_merging_states() +
-        (dawg_.num_of_merging_states() >> 1));
+    frames_.reserve(INITIAL_STACK_SIZE);
+    if (progress_ != NULL) {
+      progress_->Start(dawg_.num_of_states());
+    }
 
     ReserveUnit(0);
-    extras(0).set_is_used();
+    extras(0).set_is_used(0);
     units(0).set_offset(1);
     units(0).set_label('\0');
 
     if (dawg_.size() > 1) {
-      if (!BuildDictionary(dawg_.root(), 0)) {
+      if (profile_ != NULL) {
+        if (!BuildHotRegion()) {
+          return false;
+        }
+      } else if (!BuildDictionary(dawg_.root(), 0)) {
         return false;
       }
     }
 
     FixAllBlocks();
-
-    dic_->SwapUnitsBuf(&units_);
     return true;
   }
 
-  // Builds a dictionary from a dawg.
+  // Builds a double-array from a dawg in depth-first order. A stack of
+  // frames is used instead of recursion, so the depth is not limited by
+  // the stack size of a thread.
   bool BuildDictionary(BaseType dawg_index, BaseType dic_index) {
+    BaseType offset = 0;
+    if (!ArrangeNode(dawg_index, dic_index, &offset)) {
+      return false;
+    } else if (offset == 0) {
+      return true;
+    }
+    VisitNode(0);
+
+    frames_.clear();
+    frames_.push_back(Frame(dawg_.child(dawg_index), offset));
+    while (!frames_.empty()) {
+      BaseType dawg_child_index = frames_.back().dawg_child_index();
+      if (dawg_child_index == 0) {
+        frames_.pop_back();
+        continue;
+      }
+      frames_.back().set_dawg_child_index(dawg_.sibling(dawg_child_index));
+
+      BaseType dic_child_index =
+          frames_.back().offset() ^ dawg_.label(dawg_child_index);
+      if (!ArrangeNode(dawg_child_index, dic_child_index, &offset)) {
+        return false;
+      } else if (offset != 0) {
+        VisitNode(frames_.size());
+        frames_.push_back(Frame(dawg_.child(dawg_child_index), offset));
+      }
+    }
+    return true;
+  }
+
+  // Builds a dictionary in descending order of weights until a hot region
+  // is filled, and then builds the rest of a dictionary depth-first.
+  bool BuildHotRegion() {
+    SortProfile();
+
+    std::priority_queue<HotNode> nodes;
+    SizeType order = 0;
+    nodes.push(HotNode(dawg_.root(), 0, 0, 0, profile_ids_.size(),
+                       profile_weights_.back(), order++));
+
+    while (!nodes.empty()) {
+      HotNode node = nodes.top();
+      if (node.weight() == 0 || num_of_units() >= hot_region_size_) {
+        break;
+      }
+      nodes.pop();
+
+      BaseType offset = 0;
+      if (!ArrangeNode(node.dawg_index(), node.dic_index(), &offset)) {
+        return false;
+      } else if (offset == 0) {
+        continue;
+      }
+      VisitNode(node.depth());
+
+      // Splits a profile range into ranges of child nodes.
+      SizeType depth = node.depth();
+      SizeType profile_begin = node.profile_begin();
+      for (BaseType dawg_child_index = dawg_.child(node.dawg_index());
+           dawg_child_index != 0;
+           dawg_child_index = dawg_.sibling(dawg_child_index)) {
+        UCharType label = dawg_.label(dawg_child_index);
+        if (label == '\0') {
+          continue;
+        }
+        while (profile_begin < node.profile_end() &&
+               ProfileLabel(profile_begin, depth) < label) {
+          ++profile_begin;
+        }
+        SizeType profile_end = profile_begin;
+        while (profile_end < node.profile_end() &&
+               ProfileLabel(profile_end, depth) == label) {
+          ++profile_end;
+        }
+
+        UInt64Type weight = profile_weights_[profile_end] -
+            profile_weights_[profile_begin];
+        nodes.push(HotNode(dawg_child_index, offset ^ label, depth + 1,
+                           profile_begin, profile_end, weight, order++));
+        profile_begin = profile_end;
+      }
+    }
+
+    // Frees memory for a profile.
+    std::vector<SizeType>(0).swap(profile_ids_);
+    std::vector<UInt64Type>(0).swap(profile_weights_);
+
+    // Builds the rest of a dictionary.
+    for ( ; !nodes.empty(); nodes.pop()) {
+      if (!BuildDictionary(nodes.top().dawg_index(), nodes.top().dic_index())) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Counts a node whose children are arranged.
+  void VisitNode(SizeType depth) {
+    if (progress_ != NULL) {
+      progress_->Visit(depth);
+    }
+  }
+
+  // Sorts profile keys and calculates cumulative weights.
+  void SortProfile() {
+    profile_ids_.resize(profile_->size());
+    for (SizeType i = 0; i < profile_ids_.size(); ++i) {
+      profile_ids_[i] = i;
+    }
+    std::sort(profile_ids_.begin(), profile_ids_.end(),
+              ProfileKeyComparer(*profile_));
+
+    profile_weights_.resize(profile_ids_.size() + 1);
+    profile_weights_[0] = 0;
+    for (SizeType i = 0; i < profile_ids_.size(); ++i) {
+      profile_weights_[i + 1] = profile_weights_[i] +
+          profile_->weight(profile_ids_[i]);
+    }
+  }
+
+  // Reads a label of a sorted profile key. The end of a key is handled as
+  // the smallest label '\0'.
+  UCharType ProfileLabel(SizeType sorted_id, SizeType depth) const {
+    SizeType id = profile_ids_[sorted_id];
+    return (depth < profile_->length(id)) ? profile_->key(id)[depth] : '\0';
+  }
+
+  // Arranges child nodes of a given node. An offset to child units is
+  // returned if they are newly arranged, or 0 otherwise.
+  bool ArrangeNode(BaseType dawg_index, BaseType dic_index,
+                   BaseType *new_offset) {
+    *new_offset = 0;
     if (dawg_.is_leaf(dawg_index)) {
       return true;
     }
@@ -116,7 +418,7 @@ class DictionaryBuilder {
     // Uses an existing offset if available.
     BaseType dawg_child_index = dawg_.child(dawg_index);
     if (dawg_.is_merging(dawg_child_index)) {
-      BaseType offset = link_table_.Find(dawg_child_index);
+      BaseType offset = link_table_->Find(dawg_child_index);
       if (offset != 0) {
         offset ^= dic_index;
         if (!(offset & UPPER_MASK) || !(offset & LOWER_MASK)) {
@@ -135,19 +437,11 @@ class DictionaryBuilder {
       return false;
     }
 
-    if (dawg_.is_merging(dawg_child_index))
-      link_table_.Insert(dawg_child_index, offset); {
+    if (dawg_.is_merging(dawg_child_index)) {
+      link_table_->Insert(dawg_child_index, offset);
     }
 
-    // Builds a double-array in depth-first order.
-    do {
-      BaseType dic_child_index = offset ^ dawg_.label(dawg_child_index);
-      if (!BuildDictionary(dawg_child_index, dic_child_index)) {
-        return false;
-      }
-      dawg_child_index = dawg_.sibling(dawg_child_index);
-    } while (dawg_child_index != 0);
-
+    *new_offset = offset;
     return true;
   }
 
@@ -181,33 +475,110 @@ class DictionaryBuilder {
 
       dawg_child_index = dawg_.sibling(dawg_child_index);
     }
-    extras(offset).set_is_used();
+    extras(offset).set_is_used(offset % BLOCK_SIZE);
 
     return offset;
   }
 
-  // Finds a good offset.
+  // Finds a good offset. Unfixed blocks are scanned in ascending order of
+  // units, and the first unfixed unit which gives a good offset for the
+  // first label is chosen.
   BaseType FindGoodOffset(BaseType index) const {
-    if (unfixed_index_ >= num_of_units()) {
-      return num_of_units() | (index & 0xFF);
+    for (SizeType i = 0; i < unfixed_block_ids_.size(); ++i) {
+      BaseType offset;
+      if (FindGoodOffset(index, unfixed_block_ids_[i], &offset)) {
+        return offset;
+      }
     }
+    return num_of_units() | (index & 0xFF);
+  }
 
-    // Scans unused units to find a good offset.
-    BaseType unfixed_index = unfixed_index_;
-    do {
-      BaseType offset = unfixed_index ^ labels_[0];
-      if (IsGoodOffset(index, offset)) {
-        return offset;
+  // Finds a good offset in a block.
+  bool FindGoodOffset(BaseType index, BaseType block_id,
+                      BaseType *offset) const {
+    const DictionaryExtraBlock &block = *extras_[block_id];
+
+    // Checks the first unfixed units one by one, because a good offset is
+    // often found soon. The rest are checked with bit sets.
+    BaseType begin = block_id * BLOCK_SIZE;
+    SizeType num_of_checks = 0;
+    for (SizeType i = 0; i < DictionaryExtraBlock::NUM_OF_WORDS; ++i) {
+      for (UInt64Type bits = ~block.fixed_bits(i); bits != 0;
+           bits &= bits - 1) {
+        if (num_of_checks++ == MAX_NUM_OF_SCALAR_CHECKS) {
+          return FindGoodOffset(index, block, begin, offset);
+        }
+        BaseType unit_id = static_cast<BaseType>(
+            i * DictionaryExtraBlock::WORD_SIZE + FindLowestBit(bits));
+        *offset = begin | (unit_id ^ labels_[0]);
+        if (IsGoodOffset(index, block, *offset)) {
+          return true;
+        }
       }
-      unfixed_index = extras(unfixed_index).next();
-    } while (unfixed_index != unfixed_index_);
+    }
+    return false;
+  }
 
-    return num_of_units() | (index & 0xFF);
+  // Finds a good offset in a block with bit sets of offsets. Bit sets of
+  // unfixed units are permuted by labels and then mask offsets, so a label
+  // is checked for all the offsets in a block at once.
+  bool FindGoodOffset(BaseType index, const DictionaryExtraBlock &block,
+                      BaseType begin, BaseType *offset) const {
+    UInt64Type unfixed_bits[DictionaryExtraBlock::NUM_OF_WORDS];
+    for (SizeType i = 0; i < DictionaryExtraBlock::NUM_OF_WORDS; ++i) {
+      unfixed_bits[i] = ~block.fixed_bits(i);
+    }
+
+    // Offsets whose first children are unfixed and which are not used.
+    UInt64Type offset_bits[DictionaryExtraBlock::NUM_OF_WORDS];
+    PermuteBits(unfixed_bits, labels_[0], offset_bits);
+    for (SizeType i = 0; i < DictionaryExtraBlock::NUM_OF_WORDS; ++i) {
+      offset_bits[i] &= ~block.used_bits(i);
+    }
+
+    // A distant offset is available only if it has the same lower bits.
+    if ((index ^ begin) & UPPER_MASK) {
+      BaseType id = index & LOWER_MASK;
+      for (SizeType i = 0; i < DictionaryExtraBlock::NUM_OF_WORDS; ++i) {
+        if (i != id / DictionaryExtraBlock::WORD_SIZE) {
+          offset_bits[i] = 0;
+        }
+      }
+      offset_bits[id / DictionaryExtraBlock::WORD_SIZE] &=
+          static_cast<UInt64Type>(1) << (id % DictionaryExtraBlock::WORD_SIZE);
+    }
+
+    // Removes offsets which cause collisions.
+    UInt64Type label_bits[DictionaryExtraBlock::NUM_OF_WORDS];
+    for (SizeType label_id = 1; label_id < labels_.size(); ++label_id) {
+      PermuteBits(unfixed_bits, labels_[label_id], label_bits);
+      UInt64Type any_bits = 0;
+      for (SizeType i = 0; i < DictionaryExtraBlock::NUM_OF_WORDS; ++i) {
+        offset_bits[i] &= label_bits[i];
+        any_bits |= offset_bits[i];
+      }
+      if (any_bits == 0) {
+        return false;
+      }
+    }
+
+    // Chooses the first unit for the first label.
+    PermuteBits(offset_bits, labels_[0], label_bits);
+    for (SizeType i = 0; i < DictionaryExtraBlock::NUM_OF_WORDS; ++i) {
+      if (label_bits[i] != 0) {
+        BaseType unit_id = static_cast<BaseType>(
+            i * DictionaryExtraBlock::WORD_SIZE + FindLowestBit(label_bits[i]));
+        *offset = begin | (unit_id ^ labels_[0]);
+        return true;
+      }
+    }
+    return false;
   }
 
   // Checks if a given offset is valid or not.
-  bool IsGoodOffset(BaseType index, BaseType offset) const {
-    if (extras(offset).is_used()) {
+  bool IsGoodOffset(BaseType index, const DictionaryExtraBlock &block,
+                    BaseType offset) const {
+    if (block.is_used(offset % BLOCK_SIZE)) {
       return false;
     }
 
@@ -218,7 +589,7 @@ class DictionaryBuilder {
 
     // Finds a collision.
     for (SizeType i = 1; i < labels_.size(); ++i) {
-      if (extras(offset ^ labels_[i]).is_fixed()) {
+      if (block.is_fixed((offset ^ labels_[i]) % BLOCK_SIZE)) {
         return false;
       }
     }
@@ -226,22 +597,59 @@ class DictionaryBuilder {
     return true;
   }
 
+  // Permutes a bit set of a block, so that the i-th bit of the result is
+  // the (i ^ label)-th bit of a given set.
+  static void PermuteBits(const UInt64Type *src, UCharType label,
+                          UInt64Type *dest) {
+    static const UInt64Type MASKS[] = {
+      0x5555555555555555ULL, 0x3333333333333333ULL, 0x0F0F0F0F0F0F0F0FULL,
+      0x00FF00FF00FF00FFULL, 0x0000FFFF0000FFFFULL, 0x00000000FFFFFFFFULL
+    };
+
+    SizeType word_label = label / DictionaryExtraBlock::WORD_SIZE;
+    for (SizeType i = 0; i < DictionaryExtraBlock::NUM_OF_WORDS; ++i) {
+      dest[i] = src[i ^ word_label];
+    }
+    for (SizeType bit = 0; bit < 6; ++bit) {
+      if ((label >> bit) & 1) {
+        UInt64Type mask = MASKS[bit];
+        SizeType shift = static_cast<SizeType>(1) << bit;
+        for (SizeType i = 0; i < DictionaryExtraBlock::NUM_OF_WORDS; ++i) {
+          dest[i] = ((dest[i] & mask) << shift) | ((dest[i] >> shift) & mask);
+        }
+      }
+    }
+  }
+
+  // Finds the lowest bit of a non-zero word.
+  static SizeType FindLowestBit(UInt64Type bits) {
+#if defined(__GNUC__)
+    return static_cast<SizeType>(__builtin_ctzll(bits));
+#else  // defined(__GNUC__)
+    SizeType bit = 0;
+    while (((bits >> bit) & 1) == 0) {
+      ++bit;
+    }
+    return bit;
+#endif  // defined(__GNUC__)
+  }
+
   // Reserves an unused unit.
   void ReserveUnit(BaseType index) {
     if (index >= num_of_units()) {
       ExpandDictionary();
     }
+    DictionaryExtraBlock &block = extras(index);
+    if (block.is_fixed(index % BLOCK_SIZE)) {
+      return;
+    }
+    block.set_is_fixed(index % BLOCK_SIZE);
 
-    // Removes an unused unit from a circular linked list.
-    if (index == unfixed_index_) {
-      unfixed_index_ = extras(index).next();
-      if (unfixed_index_ == index) {
-        unfixed_index_ = num_of_units();
-      }
+    // Removes a block whose units are all fixed.
+    if (block.is_full()) {
+      unfixed_block_ids_.erase(std::find(unfixed_block_ids_.begin(),
+          unfixed_block_ids_.end(), index / BLOCK_SIZE));
     }
-    extras(extras(index).prev()).set_next(extras(index).next());
-    extras(extras(index).next()).set_prev(extras(index).prev());
-    extras(index).set_is_fixed();
   }
 
   // Expands a dictionary.
@@ -257,35 +665,18 @@ class DictionaryBuilder {
       FixBlock(src_num_of_blocks - NUM_OF_UNFIXED_BLOCKS);
     }
 
-    units_.resize(dest_num_of_units);
+    units_->resize(dest_num_of_units);
     extras_.resize(dest_num_of_blocks, 0);
 
     // Allocates memory to a new block.
     if (dest_num_of_blocks > NUM_OF_UNFIXED_BLOCKS) {
       BaseType block_id = src_num_of_blocks - NUM_OF_UNFIXED_BLOCKS;
       std::swap(extras_[block_id], extras_.back());
-      for (BaseType i = src_num_of_units; i < dest_num_of_units; ++i) {
-        extras(i).clear();
-      }
+      extras_.back()->clear();
     } else {
-      extras_.back() = new DictionaryExtraUnit[BLOCK_SIZE];
-    }
-
-    // Creates a circular linked list for a new block.
-    for (BaseType i = src_num_of_units + 1; i < dest_num_of_units; ++i) {
-      extras(i - 1).set_next(i);
-      extras(i).set_prev(i - 1);
+      extras_.back() = new DictionaryExtraBlock;
     }
-
-    extras(src_num_of_units).set_prev(dest_num_of_units - 1);
-    extras(dest_num_of_units - 1).set_next(src_num_of_units);
-
-    // Merges 2 circular linked lists.
-    extras(src_num_of_units).set_prev(extras(unfixed_index_).prev());
-    extras(dest_num_of_units - 1).set_next(unfixed_index_);
-
-    extras(extras(unfixed_index_).prev()).set_next(src_num_of_units);
-    extras(unfixed_index_).set_prev(dest_num_of_units - 1);
+    unfixed_block_ids_.push_back(src_num_of_blocks);
   }
 
   // Fixes all blocks to avoid invalid transitions.
@@ -309,7 +700,7 @@ class DictionaryBuilder {
     // Finds an unused offset.
     BaseType unused_offset_for_label = 0;
     for (BaseType offset = begin; offset != end; ++offset) {
-      if (!extras(offset).is_used()) {
+      if (!extras(offset).is_used(offset % BLOCK_SIZE)) {
         unused_offset_for_label = offset;
         break;
       }
@@ -317,7 +708,7 @@ class DictionaryBuilder {
 
     // Labels of unused units are modified.
     for (BaseType index = begin; index != end; ++index) {
-      if (!extras(index).is_fixed()) {
+      if (!extras(index).is_fixed(index % BLOCK_SIZE)) {
         ReserveUnit(index);
         units(index).set_label(
             static_cast<UCharType>(index ^ unused_offset_for_label));
@@ -327,6 +718,9 @@ class DictionaryBuilder {
   }
 };
 
+typedef BasicDictionaryBuilder<Dawg, std::vector<DictionaryUnit>, LinkTable>
+    DictionaryBuilder;
+
 }  // namespace dawgdic
 
 #endif  // DAWGDIC_DICTIONARY_BUILDER_H
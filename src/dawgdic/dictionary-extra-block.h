@@ -0,0 +1,77 @@
+#ifndef DAWGDIC_DICTIONARY_EXTRA_BLOCK_H
+#define DAWGDIC_DICTIONARY_EXTRA_BLOCK_H
+
+#include "base-types.h"
+
+namespace dawgdic {
+
+// Extra block of units for building a dictionary. Flags of units are
+// packed into bit sets, whose words are read for checking many units at
+// once.
+class DictionaryExtraBlock {
+ public:
+  enum {
+    // Number of units in a block.
+    SIZE = 256,
+    // Number of bits in a word.
+    WORD_SIZE = 64,
+    // Number of words in a bit set.
+    NUM_OF_WORDS = SIZE / WORD_SIZE
+  };
+
+  DictionaryExtraBlock() {
+    clear();
+  }
+
+  void clear() {
+    for (SizeType i = 0; i < NUM_OF_WORDS; ++i) {
+      fixed_bits_[i] = used_bits_[i] = 0;
+    }
+    num_of_fixed_units_ = 0;
+  }
+
+  // Sets a unit as fixed, which must not be fixed yet.
+  void set_is_fixed(BaseType id) {
+    fixed_bits_[id / WORD_SIZE] |=
+        static_cast<UInt64Type>(1) << (id % WORD_SIZE);
+    ++num_of_fixed_units_;
+  }
+  // Sets if an index is used as an offset or not.
+  void set_is_used(BaseType id) {
+    used_bits_[id / WORD_SIZE] |=
+        static_cast<UInt64Type>(1) << (id % WORD_SIZE);
+  }
+
+  // Reads if a unit is fixed or not.
+  bool is_fixed(BaseType id) const {
+    return ((fixed_bits_[id / WORD_SIZE] >> (id % WORD_SIZE)) & 1) == 1;
+  }
+  // Reads if an index is used as an offset or not.
+  bool is_used(BaseType id) const {
+    return ((used_bits_[id / WORD_SIZE] >> (id % WORD_SIZE)) & 1) == 1;
+  }
+
+  // Reads if all the units are fixed or not.
+  bool is_full() const {
+    return num_of_fixed_units_ == SIZE;
+  }
+
+  // Reads words of bit sets.
+  UInt64Type fixed_bits(SizeType word_id) const {
+    return fixed_bits_[word_id];
+  }
+  UInt64Type used_bits(SizeType word_id) const {
+    return used_bits_[word_id];
+  }
+
+ private:
+  UInt64Type fixed_bits_[NUM_OF_WORDS];
+  UInt64Type used_bits_[NUM_OF_WORDS];
+  BaseType num_of_fixed_units_;
+
+  // Copyable.
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_DICTIONARY_EXTRA_BLOCK_H
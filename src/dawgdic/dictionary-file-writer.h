@@ -0,0 +1,140 @@
+#ifndef DAWGDIC_DICTIONARY_FILE_WRITER_H
+#define DAWGDIC_DICTIONARY_FILE_WRITER_H
+
+#include <iostream>
+#include <vector>
+
+#include "best-value-table.h"
+#include "dictionary.h"
+#include "file-section.h"
+#include "guide.h"
+#include "ordinal-table.h"
+#include "ranked-guide.h"
+#include "value-table.h"
+
+namespace dawgdic {
+
+// Writer of container files, which are read by DictionaryFile.
+class DictionaryFileWriter {
+ public:
+  explicit DictionaryFileWriter(
+      SizeType alignment = FileSection::DEFAULT_ALIGNMENT)
+    : alignment_(alignment), sections_(), addresses_() {}
+
+  SizeType alignment() const {
+    return alignment_;
+  }
+  SizeType num_of_sections() const {
+    return sections_.size();
+  }
+
+  // Adds objects as sections. Objects must be kept until Write() is called.
+  void Add(const Dictionary &dic) {
+    AddSection(FileSection::DICTIONARY, dic.units(), dic.total_size());
+  }
+  void Add(const Guide &guide) {
+    AddSection(FileSection::GUIDE, guide.units(), guide.total_size());
+  }
+  void Add(const RankedGuide &guide) {
+    AddSection(FileSection::RANKED_GUIDE, guide.units(), guide.total_size());
+  }
+  void Add(const OrdinalTable &table) {
+    AddSection(FileSection::ORDINAL_TABLE, table.units(), table.total_size());
+  }
+  void Add(const BestValueTable &table) {
+    AddSection(FileSection::BEST_VALUE_TABLE, table.units(),
+               table.total_size());
+  }
+  template <typename VALUE_TYPE>
+  void Add(const ValueTable<VALUE_TYPE> &table) {
+    AddSection(FileSection::VALUE_TABLE, table.units(), table.total_size());
+  }
+
+  // Adds a section with its checksum.
+  void AddSection(BaseType type, const void *address, SizeType size) {
+    FileSection section;
+    section.set_type(type);
+    section.set_size(size);
+    section.set_checksum(FileSection::Checksum(address, size));
+    sections_.push_back(section);
+    addresses_.push_back(address);
+  }
+
+  // Writes a header and sections to an output stream.
+  bool Write(std::ostream *output) const {
+    std::vector<FileSection> sections(sections_);
+    SizeType offset = Align(FileSection::HEADER_SIZE +
+                            sizeof(FileSection) * sections.size());
+    for (SizeType i = 0; i < sections.size(); ++i) {
+      sections[i].set_offset(offset);
+      offset = Align(offset + static_cast<SizeType>(sections[i].size()));
+    }
+
+    // Writes a header.
+    BaseType fields[4] = {
+      FileSection::FORMAT_VERSION, static_cast<BaseType>(sections.size()),
+      static_cast<BaseType>(alignment_), 0
+    };
+    if (!output->write(FileSection::magic(), FileSection::MAGIC_SIZE) ||
+        !output->write(reinterpret_cast<const char *>(fields),
+                       sizeof(fields))) {
+      return false;
+    }
+    if (!sections.empty() &&
+        !output->write(reinterpret_cast<const char *>(&sections[0]),
+                       sizeof(FileSection) * sections.size())) {
+      return false;
+    }
+    offset = FileSection::HEADER_SIZE + sizeof(FileSection) * sections.size();
+
+    // Writes sections.
+    for (SizeType i = 0; i < sections.size(); ++i) {
+      SizeType section_offset = static_cast<SizeType>(sections[i].offset());
+      SizeType section_size = static_cast<SizeType>(sections[i].size());
+      if (!WritePadding(section_offset - offset, output) ||
+          !output->write(static_cast<const char *>(addresses_[i]),
+                         section_size)) {
+        return false;
+      }
+      offset = section_offset + section_size;
+    }
+    return WritePadding(Align(offset) - offset, output);
+  }
+
+  // Removes all sections.
+  void Clear() {
+    std::vector<FileSection>(0).swap(sections_);
+    std::vector<const void *>(0).swap(addresses_);
+  }
+
+ private:
+  SizeType alignment_;
+  std::vector<FileSection> sections_;
+  std::vector<const void *> addresses_;
+
+  // Disallows copies.
+  DictionaryFileWriter(const DictionaryFileWriter &);
+  DictionaryFileWriter &operator=(const DictionaryFileWriter &);
+
+  // Rounds up an offset to the alignment.
+  SizeType Align(SizeType offset) const {
+    return (offset + alignment_ - 1) / alignment_ * alignment_;
+  }
+
+  // Writes zeros.
+  static bool WritePadding(SizeType size, std::ostream *output) {
+    static const char ZEROS[64] = { '\0' };
+    while (size > 0) {
+      SizeType chunk_size = (size < sizeof(ZEROS)) ? size : sizeof(ZEROS);
+      if (!output->write(ZEROS, chunk_size)) {
+        return false;
+      }
+      size -= chunk_size;
+    }
+    return true;
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_DICTIONARY_FILE_WRITER_H
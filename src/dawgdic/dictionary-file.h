@@ -0,0 +1,233 @@
+#ifndef DAWGDIC_DICTIONARY_FILE_H
+#define DAWGDIC_DICTIONARY_FILE_H
+
+#include <cstring>
+
+#include "best-value-table.h"
+#include "dictionary.h"
+#include "file-section.h"
+#include "guide.h"
+#include "mapped-file.h"
+#include "ordinal-table.h"
+#include "ranked-guide.h"
+#include "value-table.h"
+
+namespace dawgdic {
+
+// Dictionary file mapped into memory. A file is either a container file
+// written by DictionaryFileWriter, or a raw file which consists of a
+// dictionary and an optional guide. Objects given to Map() refer to the
+// mapped memory, so they are valid until Close() is called.
+class DictionaryFile {
+ public:
+  DictionaryFile() : file_(), sections_(NULL), num_of_sections_(0) {}
+
+  const MappedFile &file() const {
+    return file_;
+  }
+  bool is_open() const {
+    return file_.is_open();
+  }
+  bool is_container() const {
+    return sections_ != NULL;
+  }
+
+  // Section table of a container file.
+  SizeType num_of_sections() const {
+    return num_of_sections_;
+  }
+  const FileSection &section(SizeType id) const {
+    return sections_[id];
+  }
+  const void *section_address(const FileSection &section) const {
+    return static_cast<const char *>(file_.address()) + section.offset();
+  }
+
+  // Maps a file into memory and reads its header.
+  // Flags are passed to MappedFile::Open().
+  bool Open(const char *file_name, int flags = 0) {
+    Close();
+    if (!file_.Open(file_name, flags)) {
+      return false;
+    }
+    if (!ReadHeader()) {
+      Close();
+      return false;
+    }
+    return true;
+  }
+
+  // Unmaps a file.
+  void Close() {
+    file_.Close();
+    sections_ = NULL;
+    num_of_sections_ = 0;
+  }
+
+  // Finds a section of a given type. Returns NULL if there is no such
+  // section or the file is not a container.
+  const FileSection *FindSection(BaseType type) const {
+    for (SizeType i = 0; i < num_of_sections_; ++i) {
+      if (sections_[i].type() == type) {
+        return &sections_[i];
+      }
+    }
+    return NULL;
+  }
+
+  // Checks checksums of sections. This reads all the pages of a file.
+  bool Verify() const {
+    for (SizeType i = 0; i < num_of_sections_; ++i) {
+      const FileSection &section = sections_[i];
+      if (section.has_checksum() && section.checksum() !=
+          FileSection::Checksum(section_address(section),
+                                static_cast<SizeType>(section.size()))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Points a dictionary at the mapped memory.
+  bool Map(Dictionary *dic) const {
+    if (is_container()) {
+      return MapSection<DictionaryUnit>(FileSection::DICTIONARY, dic);
+    }
+    return MapObject<DictionaryUnit>(0, dic);
+  }
+
+  // Points a guide at the mapped memory.
+  bool Map(Guide *guide) const {
+    if (is_container()) {
+      return MapSection<GuideUnit>(FileSection::GUIDE, guide);
+    }
+    return MapObject<GuideUnit>(guide_offset(), guide);
+  }
+  bool Map(RankedGuide *guide) const {
+    if (is_container()) {
+      return MapSection<RankedGuideUnit>(FileSection::RANKED_GUIDE, guide);
+    }
+    return MapObject<RankedGuideUnit>(guide_offset(), guide);
+  }
+
+  // Points an ordinal table at the mapped memory. A raw file has no table.
+  bool Map(OrdinalTable *table) const {
+    if (is_container()) {
+      return MapSection<BaseType>(FileSection::ORDINAL_TABLE, table);
+    }
+    return false;
+  }
+  // Points a best value table at the mapped memory. A raw file has no
+  // table.
+  bool Map(BestValueTable *table) const {
+    if (is_container()) {
+      return MapSection<ValueType>(FileSection::BEST_VALUE_TABLE, table);
+    }
+    return false;
+  }
+  // Points a value table at the mapped memory. Its values must have the
+  // same width as written values.
+  template <typename VALUE_TYPE>
+  bool Map(ValueTable<VALUE_TYPE> *table) const {
+    if (is_container()) {
+      return MapSection<VALUE_TYPE>(FileSection::VALUE_TABLE, table);
+    }
+    return false;
+  }
+
+ private:
+  MappedFile file_;
+  const FileSection *sections_;
+  SizeType num_of_sections_;
+
+  // Disallows copies.
+  DictionaryFile(const DictionaryFile &);
+  DictionaryFile &operator=(const DictionaryFile &);
+
+  // Reads the header of a container file. A file without the magic string
+  // is handled as a raw file.
+  bool ReadHeader() {
+    const char *address = static_cast<const char *>(file_.address());
+    if (file_.size() < FileSection::HEADER_SIZE ||
+        std::memcmp(address, FileSection::magic(),
+                    FileSection::MAGIC_SIZE) != 0) {
+      return true;
+    }
+
+    const BaseType *fields = reinterpret_cast<const BaseType *>(
+        address + FileSection::MAGIC_SIZE);
+    BaseType version = fields[0];
+    SizeType num_of_sections = fields[1];
+    if (version != FileSection::FORMAT_VERSION || num_of_sections >
+        (file_.size() - FileSection::HEADER_SIZE) / sizeof(FileSection)) {
+      return false;
+    }
+
+    const FileSection *sections = reinterpret_cast<const FileSection *>(
+        address + FileSection::HEADER_SIZE);
+    for (SizeType i = 0; i < num_of_sections; ++i) {
+      UInt64Type offset = sections[i].offset();
+      UInt64Type size = sections[i].size();
+      if (offset > file_.size() || size > file_.size() - offset ||
+          offset % sizeof(UInt64Type) != 0) {
+        return false;
+      }
+    }
+
+    sections_ = sections;
+    num_of_sections_ = num_of_sections;
+    return true;
+  }
+
+  // Maps an object to a section of a container file.
+  template <typename UNIT_TYPE, typename OBJECT_TYPE>
+  bool MapSection(BaseType type, OBJECT_TYPE *object) const {
+    const FileSection *section = FindSection(type);
+    if (section == NULL || section->size() % sizeof(UNIT_TYPE) != 0) {
+      return false;
+    }
+
+    object->Map(section_address(*section),
+                static_cast<SizeType>(section->size() / sizeof(UNIT_TYPE)));
+    return true;
+  }
+
+  // In a raw file, a guide follows a dictionary.
+  SizeType guide_offset() const {
+    SizeType num_of_units = 0;
+    if (!ReadSize(0, &num_of_units)) {
+      return file_.size();
+    }
+    return sizeof(BaseType) + sizeof(DictionaryUnit) * num_of_units;
+  }
+
+  // Reads the number of units at a given offset of a raw file.
+  bool ReadSize(SizeType offset, SizeType *size) const {
+    if (!file_.is_open() || offset + sizeof(BaseType) > file_.size()) {
+      return false;
+    }
+    *size = *reinterpret_cast<const BaseType *>(
+        static_cast<const char *>(file_.address()) + offset);
+    return true;
+  }
+
+  // Maps an object of a raw file after checking its size.
+  template <typename UNIT_TYPE, typename OBJECT_TYPE>
+  bool MapObject(SizeType offset, OBJECT_TYPE *object) const {
+    SizeType num_of_units = 0;
+    if (!ReadSize(offset, &num_of_units)) {
+      return false;
+    }
+    SizeType units_size = sizeof(UNIT_TYPE) * num_of_units;
+    if (units_size > file_.size() - offset - sizeof(BaseType)) {
+      return false;
+    }
+
+    object->Map(static_cast<const char *>(file_.address()) + offset);
+    return true;
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_DICTIONARY_FILE_H
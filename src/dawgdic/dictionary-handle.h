@@ -0,0 +1,186 @@
+#ifndef DAWGDIC_DICTIONARY_HANDLE_H
+#define DAWGDIC_DICTIONARY_HANDLE_H
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "dictionary-set.h"
+
+namespace dawgdic {
+
+// Handle of a dictionary set which is replaced while other threads read it.
+// Readers take a Snapshot, which pins the current set without locks: it
+// only increments a counter of the current epoch. Reset() publishes a new
+// set, waits for a grace period in which readers of the old set leave, and
+// then deletes the old set. Reset() and Open() are serialized, and shared
+// fields are only accessed by atomic operations, which require GCC builtins.
+class DictionaryHandle {
+ public:
+  enum {
+    // Number of striped reader counters, which keep readers on different
+    // threads from sharing a cache line.
+    NUM_OF_SLOTS = 16
+  };
+
+  // Pinned set, which is valid until the snapshot is destroyed.
+  class Snapshot {
+   public:
+    explicit Snapshot(const DictionaryHandle &handle)
+      : count_(NULL), set_(NULL) {
+      count_ = handle.Enter(&set_);
+    }
+    ~Snapshot() {
+      DictionaryHandle::Leave(count_);
+    }
+
+    const DictionarySet &set() const {
+      return *set_;
+    }
+    const Dictionary &dic() const {
+      return set_->dic();
+    }
+    const Guide &guide() const {
+      return set_->guide();
+    }
+    const RankedGuide &ranked_guide() const {
+      return set_->ranked_guide();
+    }
+
+   private:
+    SizeType *count_;
+    const DictionarySet *set_;
+
+    // Disallows copies.
+    Snapshot(const Snapshot &);
+    Snapshot &operator=(const Snapshot &);
+  };
+
+  DictionaryHandle()
+    : set_(new DictionarySet), epoch_(0), num_of_resets_(0) {
+    for (SizeType i = 0; i < NUM_OF_SLOTS; ++i) {
+      slots_[i].Clear();
+    }
+    ::pthread_mutex_init(&mutex_, NULL);
+  }
+  // Snapshots must be destroyed before a handle.
+  ~DictionaryHandle() {
+    delete set_;
+    ::pthread_mutex_destroy(&mutex_);
+  }
+
+  // Number of sets which have replaced the initial empty set.
+  SizeType num_of_resets() const {
+    return __atomic_load_n(&num_of_resets_, __ATOMIC_RELAXED);
+  }
+
+  // Replaces the current set with a given set, whose ownership is taken.
+  // NULL is replaced with an empty set. This returns after the old set is
+  // deleted.
+  void Reset(DictionarySet *set) {
+    if (set == NULL) {
+      set = new DictionarySet;
+    }
+
+    ::pthread_mutex_lock(&mutex_);
+    // The new set is published before the epoch is flipped, and readers
+    // which count themselves after the flip see it.
+    DictionarySet *old_set = set_;
+    __atomic_store_n(&set_, set, __ATOMIC_SEQ_CST);
+
+    // A reader may have read the epoch before the previous flip and still
+    // hold the old set, so both counters must be drained.
+    WaitForReaders();
+    WaitForReaders();
+    delete old_set;
+    __atomic_store_n(&num_of_resets_, num_of_resets_ + 1, __ATOMIC_RELAXED);
+    ::pthread_mutex_unlock(&mutex_);
+  }
+
+  // Maps a set from a file, and replaces the current set with it. See
+  // DictionarySet::Open() for arguments. The current set is kept on
+  // failure.
+  bool Open(const char *file_name, int flags = 0,
+            bool has_ranked_guide = false) {
+    DictionarySet *set = new DictionarySet;
+    if (!set->Open(file_name, flags, has_ranked_guide)) {
+      delete set;
+      return false;
+    }
+    Reset(set);
+    return true;
+  }
+
+ private:
+  // Reader counters of a slot, which are padded to a cache line.
+  class Slot {
+   public:
+    void Clear() {
+      counts_[0] = counts_[1] = 0;
+    }
+
+    SizeType *count(SizeType epoch) {
+      return &counts_[epoch];
+    }
+
+   private:
+    enum {
+      CACHE_LINE_SIZE = 64
+    };
+
+    SizeType counts_[2];
+    char padding_[CACHE_LINE_SIZE - sizeof(SizeType) * 2];
+
+    // Copyable.
+  };
+
+  DictionarySet *set_;
+  SizeType epoch_;
+  SizeType num_of_resets_;
+  mutable Slot slots_[NUM_OF_SLOTS];
+  pthread_mutex_t mutex_;
+
+  // Disallows copies.
+  DictionaryHandle(const DictionaryHandle &);
+  DictionaryHandle &operator=(const DictionaryHandle &);
+
+  // Counts a reader in the current epoch, and then reads the current set.
+  // A reader which has read an old epoch may read the set after a grace
+  // period has checked its counter, but then it reads the new set.
+  SizeType *Enter(const DictionarySet **set) const {
+    SizeType *count = slots_[FindSlot()].count(
+        __atomic_load_n(&epoch_, __ATOMIC_SEQ_CST));
+    __atomic_fetch_add(count, 1, __ATOMIC_SEQ_CST);
+    *set = __atomic_load_n(&set_, __ATOMIC_SEQ_CST);
+    return count;
+  }
+
+  // Reads of a set happen before a reader leaves.
+  static void Leave(SizeType *count) {
+    __atomic_fetch_sub(count, 1, __ATOMIC_RELEASE);
+  }
+
+  // Flips the epoch, and waits until readers of the previous epoch leave.
+  // Only Reset() changes the epoch, under the mutex.
+  void WaitForReaders() {
+    SizeType epoch = epoch_;
+    __atomic_store_n(&epoch_, epoch ^ 1, __ATOMIC_SEQ_CST);
+    for (SizeType i = 0; i < NUM_OF_SLOTS; ++i) {
+      while (__atomic_load_n(slots_[i].count(epoch), __ATOMIC_ACQUIRE) != 0) {
+        ::sched_yield();
+      }
+    }
+  }
+
+  // Threads have their own stacks, so the address of a local variable
+  // tells threads apart without thread-local storage.
+  static SizeType FindSlot() {
+    char local;
+    SizeType address = reinterpret_cast<SizeType>(&local);
+    return static_cast<SizeType>(
+        ((address >> 12) ^ (address >> 20)) % NUM_OF_SLOTS);
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_DICTIONARY_HANDLE_H
@@ -0,0 +1,96 @@
+#ifndef DAWGDIC_DICTIONARY_SET_H
+#define DAWGDIC_DICTIONARY_SET_H
+
+#include "dictionary.h"
+#include "dictionary-file.h"
+#include "guide.h"
+#include "ranked-guide.h"
+
+namespace dawgdic {
+
+// Bundle of a dictionary and its guides, which are either mapped from a file
+// or owned. A guide which is not given is empty.
+class DictionarySet {
+ public:
+  DictionarySet() : file_(), dic_(), guide_(), ranked_guide_() {}
+
+  const DictionaryFile &file() const {
+    return file_;
+  }
+  const Dictionary &dic() const {
+    return dic_;
+  }
+  const Guide &guide() const {
+    return guide_;
+  }
+  const RankedGuide &ranked_guide() const {
+    return ranked_guide_;
+  }
+
+  bool has_dic() const {
+    return dic_.size() != 0;
+  }
+  bool has_guide() const {
+    return guide_.size() != 0;
+  }
+  bool has_ranked_guide() const {
+    return ranked_guide_.size() != 0;
+  }
+
+  // Maps a dictionary and its guides from a file. Flags are passed to
+  // MappedFile::Open(). A raw file has no type of a guide, so a guide after
+  // a dictionary is mapped as a ranked guide if has_ranked_guide is true.
+  bool Open(const char *file_name, int flags = 0,
+            bool has_ranked_guide = false) {
+    Clear();
+    if (!file_.Open(file_name, flags) || !file_.Map(&dic_)) {
+      Clear();
+      return false;
+    }
+    if (file_.is_container()) {
+      file_.Map(&guide_);
+      file_.Map(&ranked_guide_);
+    } else if (has_ranked_guide) {
+      file_.Map(&ranked_guide_);
+    } else {
+      file_.Map(&guide_);
+    }
+    return true;
+  }
+
+  // Takes a dictionary and guides by swapping. NULL is ignored.
+  void Swap(Dictionary *dic, Guide *guide = NULL,
+            RankedGuide *ranked_guide = NULL) {
+    if (dic != NULL) {
+      dic_.Swap(dic);
+    }
+    if (guide != NULL) {
+      guide_.Swap(guide);
+    }
+    if (ranked_guide != NULL) {
+      ranked_guide_.Swap(ranked_guide);
+    }
+  }
+
+  // Clears objects and unmaps a file.
+  void Clear() {
+    dic_.Clear();
+    guide_.Clear();
+    ranked_guide_.Clear();
+    file_.Close();
+  }
+
+ private:
+  DictionaryFile file_;
+  Dictionary dic_;
+  Guide guide_;
+  RankedGuide ranked_guide_;
+
+  // Disallows copies.
+  DictionarySet(const DictionarySet &);
+  DictionarySet &operator=(const DictionarySet &);
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_DICTIONARY_SET_H
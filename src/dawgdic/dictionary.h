@@ -5,14 +5,17 @@
 #include <vector>
 
 #include "base-types.h"
+#include "batch-kernel.h"
 #include "dictionary-unit.h"
+#include "huge-page-buffer.h"
+#include "prefix-match.h"
 
 namespace dawgdic {
 
 // Dictionary class for retrieval and binary I/O.
 class Dictionary {
  public:
-  Dictionary() : units_(NULL), size_(0), units_buf_() {}
+  Dictionary() : units_(NULL), size_(0), units_buf_(), huge_page_buf_() {}
 
   const DictionaryUnit *units() const {
     return units_;
@@ -26,6 +29,11 @@ class Dictionary {
   SizeType file_size() const {
     return sizeof(BaseType) + total_size();
   }
+  // Number of bytes in huge pages around units, which may be read from
+  // a file or mapped. See HugePageBuffer::CountHugePageBytes().
+  SizeType huge_page_bytes() const {
+    return HugePageBuffer::CountHugePageBytes(units_, total_size());
+  }
 
   // Root index.
   BaseType root() const {
@@ -58,6 +66,20 @@ class Dictionary {
     SwapUnitsBuf(&units_buf);
     return true;
   }
+  // Reads a dictionary from an input stream into huge pages. See
+  // HugePageBuffer for flags.
+  bool Read(std::istream *input, int huge_page_flags) {
+    HugePageBuffer huge_page_buf;
+    if (!huge_page_buf.Read(input, sizeof(DictionaryUnit), huge_page_flags)) {
+      return false;
+    }
+
+    Clear();
+    units_ = static_cast<const DictionaryUnit *>(huge_page_buf.address());
+    size_ = huge_page_buf.size() / sizeof(DictionaryUnit);
+    huge_page_buf_.Swap(&huge_page_buf);
+    return true;
+  }
 
   // Writes a dictionry to an output stream.
   bool Write(std::ostream *output) const {
@@ -123,6 +145,89 @@ class Dictionary {
     return true;
   }
 
+  // Finds keys which are prefixes of a given string. At most max_matches
+  // matches are written in ascending order of length, and the number of
+  // all the matches is returned.
+  SizeType CommonPrefixSearch(const CharType *s, PrefixMatch *matches,
+                              SizeType max_matches) const {
+    SizeType num_of_matches = 0;
+    BaseType index = root();
+    for (SizeType i = 0; s[i] != '\0'; ++i) {
+      if (!Follow(s[i], &index)) {
+        break;
+      }
+      if (has_value(index)) {
+        AddPrefixMatch(index, i + 1, matches, max_matches, &num_of_matches);
+      }
+    }
+    return num_of_matches;
+  }
+  SizeType CommonPrefixSearch(const CharType *s, SizeType length,
+                              PrefixMatch *matches,
+                              SizeType max_matches) const {
+    SizeType num_of_matches = 0;
+    BaseType index = root();
+    for (SizeType i = 0; i < length; ++i) {
+      if (!Follow(s[i], &index)) {
+        break;
+      }
+      if (has_value(index)) {
+        AddPrefixMatch(index, i + 1, matches, max_matches, &num_of_matches);
+      }
+    }
+    return num_of_matches;
+  }
+
+  // Finds the longest key which is a prefix of a given string.
+  bool LongestPrefixMatch(const CharType *s, PrefixMatch *match) const {
+    SizeType num_of_matches = 0;
+    BaseType index = root();
+    for (SizeType i = 0; s[i] != '\0'; ++i) {
+      if (!Follow(s[i], &index)) {
+        break;
+      }
+      if (has_value(index)) {
+        num_of_matches = 0;
+        AddPrefixMatch(index, i + 1, match, 1, &num_of_matches);
+      }
+    }
+    return num_of_matches != 0;
+  }
+  bool LongestPrefixMatch(const CharType *s, SizeType length,
+                          PrefixMatch *match) const {
+    SizeType num_of_matches = 0;
+    BaseType index = root();
+    for (SizeType i = 0; i < length; ++i) {
+      if (!Follow(s[i], &index)) {
+        break;
+      }
+      if (has_value(index)) {
+        num_of_matches = 0;
+        AddPrefixMatch(index, i + 1, match, 1, &num_of_matches);
+      }
+    }
+    return num_of_matches != 0;
+  }
+
+  // Exact matching of multiple keys. Keys are advanced in lockstep so that
+  // the memory latency of a transition overlaps with the others. If lengths
+  // is NULL, keys must be terminated by '\0'. Values of missing keys are -1.
+  // A SIMD kernel is used if BatchKernel::type() detects one, or another
+  // kernel is given. A kernel which does not run on the CPU falls back to
+  // the scalar batch lookup.
+  void FindBatch(const CharType * const *keys, const SizeType *lengths,
+                 SizeType num_keys, ValueType *values,
+                 BatchKernel::KernelType kernel_type =
+                     BatchKernel::type()) const {
+    LookupBatch(kernel_type, keys, lengths, num_keys, values, NULL);
+  }
+  void ContainsBatch(const CharType * const *keys, const SizeType *lengths,
+                     SizeType num_keys, bool *results,
+                     BatchKernel::KernelType kernel_type =
+                         BatchKernel::type()) const {
+    LookupBatch(kernel_type, keys, lengths, num_keys, NULL, results);
+  }
+
   // Follows a transition.
   bool Follow(CharType label, BaseType *index) const {
     BaseType next_index =
@@ -185,6 +290,7 @@ class Dictionary {
     units_ = NULL;
     size_ = 0;
     std::vector<DictionaryUnit>(0).swap(units_buf_);
+    huge_page_buf_.Clear();
   }
 
   // Swaps dictionaries.
@@ -192,6 +298,7 @@ class Dictionary {
     std::swap(units_, dic->units_);
     std::swap(size_, dic->size_);
     units_buf_.swap(dic->units_buf_);
+    huge_page_buf_.Swap(&dic->huge_page_buf_);
   }
 
   // Shrinks a vector.
@@ -212,16 +319,254 @@ public:
     units_ = &(*units_buf)[0];
     size_ = static_cast<BaseType>(units_buf->size());
     units_buf_.swap(*units_buf);
+    huge_page_buf_.Clear();
   }
 
  private:
+  enum {
+    // Number of keys in flight during a batch lookup.
+    BATCH_SIZE = 16
+  };
+
   const DictionaryUnit *units_;
   SizeType size_;
   std::vector<DictionaryUnit> units_buf_;
+  HugePageBuffer huge_page_buf_;
 
   // Disallows copies.
   Dictionary(const Dictionary &);
   Dictionary &operator=(const Dictionary &);
+
+  // Writes a prefix match if there is room for it.
+  void AddPrefixMatch(BaseType index, SizeType length, PrefixMatch *matches,
+                      SizeType max_matches, SizeType *num_of_matches) const {
+    if (*num_of_matches < max_matches) {
+      matches[*num_of_matches].set_length(length);
+      matches[*num_of_matches].set_value(value(index));
+    }
+    ++*num_of_matches;
+  }
+
+  // Looks up keys in lockstep. Each lane prefetches the unit of its next
+  // transition and checks it in the next round, after the other lanes.
+  void LookupBatch(BatchKernel::KernelType kernel_type,
+                   const CharType * const *keys, const SizeType *lengths,
+                   SizeType num_keys, ValueType *values, bool *results) const {
+    if (kernel_type != BatchKernel::SCALAR_KERNEL &&
+        (kernel_type == BatchKernel::type() ||
+         BatchKernel::IsSupported(kernel_type))) {
+      LookupBatchWithKernel(kernel_type, keys, lengths, num_keys,
+                            values, results);
+      return;
+    }
+
+    SizeType lane_keys[BATCH_SIZE];
+    SizeType lane_positions[BATCH_SIZE];
+    BaseType lane_indices[BATCH_SIZE];
+    SizeType num_of_lanes = 0;
+
+    // Keys waiting for their values.
+    SizeType value_keys[BATCH_SIZE];
+    BaseType value_indices[BATCH_SIZE];
+    SizeType num_of_values = 0;
+
+    SizeType key_id = 0;
+    while (num_of_lanes != 0 || key_id < num_keys) {
+      // Fills empty lanes with new keys.
+      while (num_of_lanes < BATCH_SIZE && key_id < num_keys) {
+        if (IsKeyEnd(keys, lengths, key_id, 0)) {
+          FinishBatchKey(key_id, root(), values, results,
+                         value_keys, value_indices, &num_of_values);
+        } else {
+          BaseType index = root();
+          index ^= units_[index].offset() ^
+              static_cast<UCharType>(keys[key_id][0]);
+          Prefetch(&units_[index]);
+
+          lane_keys[num_of_lanes] = key_id;
+          lane_positions[num_of_lanes] = 0;
+          lane_indices[num_of_lanes] = index;
+          ++num_of_lanes;
+        }
+        ++key_id;
+      }
+
+      for (SizeType i = 0; i < num_of_lanes; ) {
+        SizeType lane_key = lane_keys[i];
+        SizeType position = lane_positions[i];
+        BaseType index = lane_indices[i];
+
+        UCharType label = static_cast<UCharType>(keys[lane_key][position]);
+        if (units_[index].label() == label &&
+            !IsKeyEnd(keys, lengths, lane_key, ++position)) {
+          label = static_cast<UCharType>(keys[lane_key][position]);
+          index ^= units_[index].offset() ^ label;
+          Prefetch(&units_[index]);
+
+          lane_positions[i] = position;
+          lane_indices[i] = index;
+          ++i;
+          continue;
+        }
+
+        // Finishes a key and moves the last lane to this lane.
+        if (units_[index].label() == label) {
+          FinishBatchKey(lane_key, index, values, results,
+                         value_keys, value_indices, &num_of_values);
+        } else if (values != NULL) {
+          values[lane_key] = -1;
+        } else {
+          results[lane_key] = false;
+        }
+
+        --num_of_lanes;
+        lane_keys[i] = lane_keys[num_of_lanes];
+        lane_positions[i] = lane_positions[num_of_lanes];
+        lane_indices[i] = lane_indices[num_of_lanes];
+      }
+    }
+    FlushBatchValues(value_keys, value_indices, &num_of_values, values);
+  }
+
+  // Looks up keys with a SIMD kernel, which follows transitions of all the
+  // lanes at once. A lane takes a new key as soon as its key is finished.
+  void LookupBatchWithKernel(BatchKernel::KernelType kernel_type,
+                             const CharType * const *keys,
+                             const SizeType *lengths, SizeType num_keys,
+                             ValueType *values, bool *results) const {
+    SizeType num_of_lanes = BatchKernel::num_of_lanes(kernel_type);
+    SizeType lane_keys[BatchKernel::MAX_NUM_OF_LANES];
+    SizeType lane_positions[BatchKernel::MAX_NUM_OF_LANES];
+    BaseType lane_indices[BatchKernel::MAX_NUM_OF_LANES];
+    DictionaryUnit lane_units[BatchKernel::MAX_NUM_OF_LANES];
+    BaseType lane_labels[BatchKernel::MAX_NUM_OF_LANES];
+    SizeType num_of_active_lanes = 0;
+
+    // Keys waiting for their values.
+    SizeType value_keys[BATCH_SIZE];
+    BaseType value_indices[BATCH_SIZE];
+    SizeType num_of_values = 0;
+
+    // Idle lanes stay at the root with label 0.
+    for (SizeType i = 0; i < num_of_lanes; ++i) {
+      lane_keys[i] = num_keys;
+      lane_indices[i] = root();
+      lane_units[i] = units_[root()];
+      lane_labels[i] = 0;
+    }
+
+    SizeType key_id = 0;
+    for ( ; ; ) {
+      // Fills idle lanes with new keys. Empty keys are finished at the root.
+      for (SizeType i = 0; i < num_of_lanes; ++i) {
+        while (lane_keys[i] == num_keys && key_id < num_keys) {
+          if (!IsKeyEnd(keys, lengths, key_id, 0)) {
+            lane_keys[i] = key_id;
+            lane_positions[i] = 0;
+            lane_indices[i] = root();
+            lane_units[i] = units_[root()];
+            lane_labels[i] = static_cast<UCharType>(keys[key_id][0]);
+            ++num_of_active_lanes;
+          } else {
+            FinishBatchKey(key_id, root(), values, results,
+                           value_keys, value_indices, &num_of_values);
+          }
+          ++key_id;
+        }
+      }
+      if (num_of_active_lanes == 0) {
+        break;
+      }
+
+      unsigned match_mask = BatchKernel::Step(
+          kernel_type, units_, lane_indices, lane_units, lane_labels);
+
+      for (SizeType i = 0; i < num_of_lanes; ++i) {
+        SizeType lane_key = lane_keys[i];
+        if (lane_key == num_keys) {
+          lane_indices[i] = root();
+          lane_units[i] = units_[root()];
+          continue;
+        }
+
+        SizeType position = lane_positions[i] + 1;
+        if ((match_mask & (1U << i)) != 0 &&
+            !IsKeyEnd(keys, lengths, lane_key, position)) {
+          lane_positions[i] = position;
+          lane_labels[i] = static_cast<UCharType>(keys[lane_key][position]);
+          Prefetch(&units_[lane_indices[i] ^ lane_units[i].offset() ^
+                           lane_labels[i]]);
+          continue;
+        }
+
+        // Finishes a key and makes this lane idle.
+        if ((match_mask & (1U << i)) != 0) {
+          FinishBatchKey(lane_key, lane_indices[i], values, results,
+                         value_keys, value_indices, &num_of_values);
+        } else if (values != NULL) {
+          values[lane_key] = -1;
+        } else {
+          results[lane_key] = false;
+        }
+        lane_keys[i] = num_keys;
+        lane_indices[i] = root();
+        lane_units[i] = units_[root()];
+        lane_labels[i] = 0;
+        --num_of_active_lanes;
+      }
+    }
+    FlushBatchValues(value_keys, value_indices, &num_of_values, values);
+  }
+
+  // Writes a result of a key whose transitions are finished. Values are
+  // prefetched and read later by FlushBatchValues(), or when BATCH_SIZE
+  // values are waiting.
+  void FinishBatchKey(SizeType key_id, BaseType index,
+                      ValueType *values, bool *results,
+                      SizeType *value_keys, BaseType *value_indices,
+                      SizeType *num_of_values) const {
+    if (values == NULL) {
+      results[key_id] = has_value(index);
+    } else if (!has_value(index)) {
+      values[key_id] = -1;
+    } else {
+      index ^= units_[index].offset();
+      Prefetch(&units_[index]);
+      value_keys[*num_of_values] = key_id;
+      value_indices[*num_of_values] = index;
+      if (++*num_of_values == BATCH_SIZE) {
+        FlushBatchValues(value_keys, value_indices, num_of_values, values);
+      }
+    }
+  }
+
+  // Reads values of finished keys.
+  void FlushBatchValues(const SizeType *value_keys,
+                        const BaseType *value_indices,
+                        SizeType *num_of_values, ValueType *values) const {
+    for (SizeType i = 0; i < *num_of_values; ++i) {
+      values[value_keys[i]] = units_[value_indices[i]].value();
+    }
+    *num_of_values = 0;
+  }
+
+  // Checks if a position is the end of a key.
+  static bool IsKeyEnd(const CharType * const *keys, const SizeType *lengths,
+                       SizeType key_id, SizeType position) {
+    if (lengths == NULL) {
+      return keys[key_id][position] == '\0';
+    }
+    return position >= lengths[key_id];
+  }
+
+  // Hints that a unit will be read soon.
+  static void Prefetch(const DictionaryUnit *unit) {
+#if defined(__GNUC__)
+    __builtin_prefetch(unit);
+#else
+    static_cast<void>(unit);
+#endif
+  }
 };
 
 }  // namespace dawgdic
@@ -0,0 +1,803 @@
+#ifndef DAWGDIC_EXTERNAL_DAWG_BUILDER_H
+#define DAWGDIC_EXTERNAL_DAWG_BUILDER_H
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+// __GLIBC__ is defined by the headers above.
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif  // defined(__GLIBC__)
+
+#include "dawg-builder.h"
+#include "paged-array.h"
+#include "paged-dawg.h"
+#include "temp-file.h"
+
+namespace dawgdic {
+
+// DAWG builder for lexicons which do not fit in memory. While keys are
+// inserted, fixed transitions of a DawgBuilder are spilled to a temporary
+// file before its memory usage exceeds a budget, so a batch may end between
+// any keys. Equivalent states in different batches are merged by Finish()
+// in passes over the file:
+//
+// 1. Each state gets a 64-bit hash value from its labels, values and hash
+//    values of its children, and it is written to a partition chosen by
+//    its hash value.
+// 2. Partitions are loaded into a hash table one by one, and each state is
+//    recorded as a duplicate of the first state of the same labels, values
+//    and hash values of children. A collision of hash values is detected
+//    there, and then the passes are retried with another seed.
+// 3. Transitions of the first states are written in order, and children
+//    are redirected to the first states.
+//
+// The result is the same dawg as that of DawgBuilder, which is written to
+// a temporary file and read through a PagedDawg. Arrays indexed by spilled
+// transitions are kept in PagedArrays, and partitions are sized for the
+// budget, so every pass runs within the budget. peak_memory_usage() may
+// still exceed a tiny budget because of minimum sizes of buffers.
+class ExternalDawgBuilder {
+ public:
+  enum {
+    // Default memory budget (1 GiB).
+    DEFAULT_MEMORY_BUDGET = 1 << 30
+  };
+
+  explicit ExternalDawgBuilder(SizeType memory_budget = DEFAULT_MEMORY_BUDGET,
+                               const char *temp_dir = NULL)
+    : memory_budget_(memory_budget), temp_dir_(TempFile::Dir(temp_dir)),
+      builder_(), transition_file_name_(), transition_file_(),
+      partition_file_names_(), duplicate_file_names_(),
+      partition_num_of_states_(), partition_num_of_words_(),
+      num_of_spilled_batches_(0),
+      num_of_partitions_(0), num_of_retries_(0), peak_memory_usage_(0) {}
+  ~ExternalDawgBuilder() {
+    Clear();
+  }
+
+  SizeType memory_budget() const {
+    return memory_budget_;
+  }
+  const std::string &temp_dir() const {
+    return temp_dir_;
+  }
+  // Statistics are kept after Finish() until Clear().
+
+  // Number of batches of transitions spilled to a temporary file.
+  SizeType num_of_spilled_batches() const {
+    return num_of_spilled_batches_;
+  }
+  // Number of partitions for merging states.
+  SizeType num_of_partitions() const {
+    return num_of_partitions_;
+  }
+  // Number of times merging states was retried because of a collision.
+  SizeType num_of_retries() const {
+    return num_of_retries_;
+  }
+  // Peak number of bytes used by a builder and passes for merging states,
+  // except for a cache of a result.
+  SizeType peak_memory_usage() const {
+    return peak_memory_usage_;
+  }
+  // Whether a build has kept within the budget.
+  bool is_within_budget() const {
+    return peak_memory_usage_ <= memory_budget_;
+  }
+
+  // Initializes a builder and removes temporary files.
+  void Clear() {
+    ClearFiles();
+    builder_.Clear();
+    num_of_spilled_batches_ = 0;
+    num_of_partitions_ = 0;
+    num_of_retries_ = 0;
+    peak_memory_usage_ = 0;
+  }
+
+  // Inserts a key.
+  bool Insert(const CharType *key, ValueType value = 0) {
+    if (key == NULL || *key == '\0' || value < 0) {
+      return false;
+    }
+    SizeType length = 1;
+    while (key[length]) {
+      ++length;
+    }
+    return InsertKey(key, length, value);
+  }
+
+  // Inserts a key.
+  bool Insert(const CharType *key, SizeType length, ValueType value) {
+    if (key == NULL || length <= 0 || value < 0) {
+      return false;
+    }
+    for (SizeType i = 0; i < length; ++i) {
+      if (key[i] == '\0') {
+        return false;
+      }
+    }
+    return InsertKey(key, length, value);
+  }
+
+  // Finishes building a dawg, which is written to a temporary file and
+  // opened with a cache of a quarter of the budget. The file is removed
+  // when the dawg is closed.
+  bool Finish(PagedDawg *dawg) {
+    std::string dawg_file_name;
+    if (!TempFile::Create(temp_dir_, &dawg_file_name)) {
+      Clear();
+      return false;
+    }
+
+    bool is_written = (num_of_spilled_batches_ == 0) ?
+        WriteDawg(dawg_file_name) : MergeDawg(dawg_file_name);
+    ClearFiles();
+    builder_.Clear();
+    TrimMemory();
+
+    bool is_opened = is_written &&
+        dawg->Open(dawg_file_name.c_str(), memory_budget_ / 4);
+    std::remove(dawg_file_name.c_str());
+    return is_opened;
+  }
+
+ private:
+  enum {
+    // Number of records buffered for each temporary file.
+    RECORD_BUF_SIZE = 1 << 10,
+    // Maximum number of partitions, each of which has buffers.
+    MAX_NUM_OF_PARTITIONS = 1 << 8,
+    // Maximum number of seeds tried for hash values.
+    MAX_NUM_OF_SEEDS = 4,
+    // Label of the root, as DawgBuilder gives.
+    ROOT_LABEL = 0xFF
+  };
+
+  // Buffered writer of records to a file.
+  template <typename RECORD_TYPE>
+  class RecordWriter {
+   public:
+    RecordWriter() : file_(), records_() {}
+
+    static SizeType memory_usage() {
+      return sizeof(RECORD_TYPE) * RECORD_BUF_SIZE;
+    }
+
+    bool Open(const std::string &file_name) {
+      // Records are buffered by a writer instead of a stream.
+      file_.rdbuf()->pubsetbuf(NULL, 0);
+      file_.open(file_name.c_str(), std::ios::binary);
+      records_.reserve(RECORD_BUF_SIZE);
+      return file_.is_open();
+    }
+    void Write(RECORD_TYPE record) {
+      if (records_.size() == RECORD_BUF_SIZE) {
+        Flush();
+      }
+      records_.push_back(record);
+    }
+    bool Close() {
+      Flush();
+      file_.close();
+      return !file_.fail();
+    }
+
+   private:
+    std::ofstream file_;
+    std::vector<RECORD_TYPE> records_;
+
+    // Disallows copies.
+    RecordWriter(const RecordWriter &);
+    RecordWriter &operator=(const RecordWriter &);
+
+    void Flush() {
+      if (!records_.empty()) {
+        file_.write(reinterpret_cast<const char *>(&records_[0]),
+                    sizeof(RECORD_TYPE) * records_.size());
+      }
+      records_.clear();
+    }
+  };
+
+  // Buffered reader of records from a file.
+  template <typename RECORD_TYPE>
+  class RecordReader {
+   public:
+    RecordReader() : file_(), records_(), id_(0) {}
+
+    static SizeType memory_usage() {
+      return sizeof(RECORD_TYPE) * RECORD_BUF_SIZE;
+    }
+
+    bool Open(const std::string &file_name) {
+      file_.rdbuf()->pubsetbuf(NULL, 0);
+      file_.open(file_name.c_str(), std::ios::binary);
+      records_.reserve(RECORD_BUF_SIZE);
+      return file_.is_open();
+    }
+    bool Read(RECORD_TYPE *record) {
+      if (id_ == records_.size()) {
+        records_.resize(RECORD_BUF_SIZE);
+        file_.read(reinterpret_cast<char *>(&records_[0]),
+                   sizeof(RECORD_TYPE) * RECORD_BUF_SIZE);
+        records_.resize(static_cast<SizeType>(file_.gcount()) /
+                        sizeof(RECORD_TYPE));
+        id_ = 0;
+        if (records_.empty()) {
+          return false;
+        }
+      }
+      *record = records_[id_++];
+      return true;
+    }
+
+   private:
+    std::ifstream file_;
+    std::vector<RECORD_TYPE> records_;
+    SizeType id_;
+
+    // Disallows copies.
+    RecordReader(const RecordReader &);
+    RecordReader &operator=(const RecordReader &);
+  };
+
+  // Pair of the index of a duplicate state and its partition, for merging
+  // records of partitions in order.
+  typedef std::pair<BaseType, SizeType> HeadType;
+
+  const SizeType memory_budget_;
+  std::string temp_dir_;
+  DawgBuilder builder_;
+  std::string transition_file_name_;
+  std::ofstream transition_file_;
+  std::vector<std::string> partition_file_names_;
+  std::vector<std::string> duplicate_file_names_;
+  // Numbers of states and words of records in partitions.
+  std::vector<SizeType> partition_num_of_states_;
+  std::vector<SizeType> partition_num_of_words_;
+  SizeType num_of_spilled_batches_;
+  SizeType num_of_partitions_;
+  SizeType num_of_retries_;
+  SizeType peak_memory_usage_;
+
+  // Disallows copies.
+  ExternalDawgBuilder(const ExternalDawgBuilder &);
+  ExternalDawgBuilder &operator=(const ExternalDawgBuilder &);
+
+  // Spills transitions before a key if the builder may exceed the budget by
+  // the key, which may expand its hash table.
+  bool InsertKey(const CharType *key, SizeType length, ValueType value) {
+    if (builder_.memory_usage() + builder_.expansion_memory_usage() >
+        memory_budget_ && !SpillBatch()) {
+      return false;
+    }
+    if (!builder_.Insert(key, length, value)) {
+      return false;
+    }
+    UpdatePeakMemoryUsage(builder_.memory_usage());
+    return true;
+  }
+
+  // Spills fixed transitions of the builder.
+  bool SpillBatch() {
+    if (!transition_file_.is_open()) {
+      if (!TempFile::Create(temp_dir_, &transition_file_name_)) {
+        return false;
+      }
+      transition_file_.open(transition_file_name_.c_str(),
+                            std::ios::binary);
+      if (!transition_file_) {
+        return false;
+      }
+    }
+    if (!builder_.Spill(&transition_file_)) {
+      return false;
+    }
+    ++num_of_spilled_batches_;
+    return true;
+  }
+
+  // Writes a dawg which is built in memory.
+  bool WriteDawg(const std::string &dawg_file_name) {
+    Dawg dawg;
+    if (!builder_.Finish(&dawg)) {
+      return false;
+    }
+    std::ofstream file(dawg_file_name.c_str(), std::ios::binary);
+    return dawg.Write(&file) && file.flush();
+  }
+
+  // Merges spilled transitions into a dawg.
+  bool MergeDawg(const std::string &dawg_file_name) {
+    BaseType root_base;
+    if (!builder_.Finish(&transition_file_, &root_base) ||
+        !transition_file_.flush()) {
+      return false;
+    }
+    transition_file_.close();
+    ++num_of_spilled_batches_;
+
+    SizeType num_of_transitions = builder_.num_of_spilled_transitions();
+    SizeType num_of_states = builder_.num_of_states() - 1;
+    SizeType num_of_merged_transitions = builder_.num_of_merged_transitions();
+    builder_.Clear();
+    TrimMemory();
+
+    // The sizes of partitions are estimated from records of states and
+    // their hash tables, which have 2 words per state and transition and
+    // 4 slots per state at most.
+    SizeType table_size = sizeof(UInt64Type) *
+        (2 * (num_of_states + num_of_transitions)) +
+        sizeof(SizeType) * 4 * num_of_states;
+    // Buffers of partitions are also counted, and if no number of
+    // partitions fits in the budget, the least memory is used.
+    SizeType min_memory_usage = 0;
+    for (SizeType i = 1; i <= MAX_NUM_OF_PARTITIONS; ++i) {
+      SizeType memory_usage = (table_size + i - 1) / i +
+          i * RecordWriter<UInt64Type>::memory_usage();
+      if (i == 1 || memory_usage < min_memory_usage) {
+        min_memory_usage = memory_usage;
+        num_of_partitions_ = i;
+      }
+      if (memory_usage <= memory_budget_) {
+        num_of_partitions_ = i;
+        break;
+      }
+    }
+
+    for (UInt64Type seed = 0; ; ++seed) {
+      bool has_collision = false;
+      if (!HashStates(num_of_transitions, seed)) {
+        return false;
+      }
+      TrimMemory();
+      if (!FindDuplicates(&has_collision)) {
+        return false;
+      }
+      TrimMemory();
+      if (!has_collision) {
+        break;
+      } else if (seed + 1 == MAX_NUM_OF_SEEDS) {
+        return false;
+      }
+      ++num_of_retries_;
+    }
+
+    return WriteMergedDawg(dawg_file_name, num_of_transitions, root_base,
+                           num_of_merged_transitions);
+  }
+
+  // Reads transitions of the next state.
+  static bool ReadState(RecordReader<UInt64Type> *reader,
+                        std::vector<UInt64Type> *records) {
+    records->clear();
+    UInt64Type record;
+    do {
+      if (!reader->Read(&record)) {
+        return false;
+      }
+      records->push_back(record);
+    } while (record & 1);
+    return true;
+  }
+
+  // Calculates hash values of states, and writes each state to a partition.
+  // A record of a state consists of its hash value, its index and number of
+  // transitions, and 2 words per transition, which are a value or a hash
+  // value of a child, and a label with the lower bits of a base value.
+  bool HashStates(SizeType num_of_transitions, UInt64Type seed) {
+    RecordReader<UInt64Type> transition_reader;
+    if (!transition_reader.Open(transition_file_name_)) {
+      return false;
+    }
+
+    std::vector<RecordWriter<UInt64Type> *> writers(num_of_partitions_);
+    bool is_opened = OpenPartitions(&writers);
+    PagedArray<UInt64Type> hash_values;
+    SizeType buffer_size = RecordWriter<UInt64Type>::memory_usage() *
+        (num_of_partitions_ + 1);
+    is_opened = is_opened && hash_values.Create(temp_dir_,
+        CacheSize(buffer_size + PageTableSize(num_of_transitions)));
+    if (is_opened) {
+      hash_values.resize(num_of_transitions);
+      UpdatePeakMemoryUsage(hash_values.memory_usage() + buffer_size);
+    }
+
+    // Skips the root.
+    std::vector<UInt64Type> records;
+    bool is_read = is_opened && ReadState(&transition_reader, &records);
+    SizeType index = 1;
+    while (is_read && ReadState(&transition_reader, &records)) {
+      SizeType num_of_records = records.size();
+      UInt64Type hash_value = Hash(seed + 1);
+      for (SizeType i = 0; i < num_of_records; ++i) {
+        BaseType base = static_cast<BaseType>(records[i]);
+        UCharType label = static_cast<UCharType>(records[i] >> 32);
+        UInt64Type child_key = (label == '\0') ?
+            base : hash_values[base >> 2];
+        records[i] = (label == '\0') ? 0 : ((label << 2) | (base & 3));
+        hash_value = Hash(Hash(hash_value ^ child_key) ^ records[i]);
+        records.push_back(child_key);
+      }
+      hash_values[index] = hash_value;
+
+      SizeType partition_id = static_cast<SizeType>(
+          (hash_value >> 32) % num_of_partitions_);
+      RecordWriter<UInt64Type> *writer = writers[partition_id];
+      writer->Write(hash_value);
+      writer->Write((static_cast<UInt64Type>(index) << 32) | num_of_records);
+      for (SizeType i = 0; i < num_of_records; ++i) {
+        writer->Write(records[num_of_records + i]);
+        writer->Write(records[i]);
+      }
+      ++partition_num_of_states_[partition_id];
+      partition_num_of_words_[partition_id] += 2 * (num_of_records + 1);
+      index += num_of_records;
+    }
+
+    bool is_closed = true;
+    for (SizeType i = 0; i < writers.size(); ++i) {
+      if (writers[i] != NULL) {
+        is_closed = writers[i]->Close() && is_closed;
+        delete writers[i];
+      }
+    }
+    return is_read && is_closed && index == num_of_transitions &&
+        !hash_values.has_error();
+  }
+
+  // Creates files of partitions.
+  bool OpenPartitions(std::vector<RecordWriter<UInt64Type> *> *writers) {
+    RemoveFiles(&partition_file_names_);
+    partition_file_names_.resize(num_of_partitions_);
+    partition_num_of_states_.assign(num_of_partitions_, 0);
+    partition_num_of_words_.assign(num_of_partitions_, 0);
+    for (SizeType i = 0; i < num_of_partitions_; ++i) {
+      if (!TempFile::Create(temp_dir_, &partition_file_names_[i])) {
+        partition_file_names_.resize(i);
+        return false;
+      }
+      (*writers)[i] = new RecordWriter<UInt64Type>;
+      if (!(*writers)[i]->Open(partition_file_names_[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Finds duplicate states in each partition, and writes pairs of their
+  // indices and the indices of their first states in order.
+  bool FindDuplicates(bool *has_collision) {
+    RemoveFiles(&duplicate_file_names_);
+    for (SizeType i = 0; i < num_of_partitions_ && !*has_collision; ++i) {
+      duplicate_file_names_.push_back(std::string());
+      if (!TempFile::Create(temp_dir_, &duplicate_file_names_.back())) {
+        duplicate_file_names_.pop_back();
+        return false;
+      }
+      if (!FindDuplicates(i, has_collision)) {
+        return false;
+      }
+    }
+    RemoveFiles(&partition_file_names_);
+    return true;
+  }
+
+  // Finds duplicate states in a partition. The first states are kept in
+  // a hash table with their records.
+  bool FindDuplicates(SizeType partition_id, bool *has_collision) {
+    RecordReader<UInt64Type> reader;
+    RecordWriter<UInt64Type> writer;
+    if (!reader.Open(partition_file_names_[partition_id]) ||
+        !writer.Open(duplicate_file_names_[partition_id])) {
+      return false;
+    }
+
+    SizeType table_size = 4;
+    while (table_size < partition_num_of_states_[partition_id] * 2) {
+      table_size <<= 1;
+    }
+    std::vector<SizeType> table(table_size, 0);
+    std::vector<UInt64Type> records;
+    records.reserve(partition_num_of_words_[partition_id]);
+
+    UInt64Type hash_value;
+    while (reader.Read(&hash_value)) {
+      // Reads a record of a state after the records of the first states.
+      SizeType begin = records.size();
+      records.push_back(hash_value);
+      UInt64Type record;
+      if (!reader.Read(&record)) {
+        return false;
+      }
+      records.push_back(record);
+      for (SizeType i = 0; i < 2 * (record & 0xFFFFFFFFU); ++i) {
+        UInt64Type word;
+        if (!reader.Read(&word)) {
+          return false;
+        }
+        records.push_back(word);
+      }
+
+      SizeType slot = static_cast<SizeType>(hash_value) & (table_size - 1);
+      for ( ; table[slot] != 0; slot = (slot + 1) & (table_size - 1)) {
+        SizeType first = table[slot] - 1;
+        if (records[first] != hash_value) {
+          continue;
+        }
+        if (!AreEqual(records, first, begin)) {
+          *has_collision = true;
+          return writer.Close();
+        }
+        writer.Write((static_cast<UInt64Type>(record >> 32) << 32) |
+                     (records[first + 1] >> 32));
+        records.resize(begin);
+        break;
+      }
+      if (records.size() != begin) {
+        table[slot] = begin + 1;
+      }
+    }
+    UpdatePeakMemoryUsage(sizeof(SizeType) * table.capacity() +
+        sizeof(UInt64Type) * records.capacity() +
+        RecordReader<UInt64Type>::memory_usage() +
+        RecordWriter<UInt64Type>::memory_usage());
+
+    std::remove(partition_file_names_[partition_id].c_str());
+    return writer.Close();
+  }
+
+  // Compares transitions of records of two states.
+  static bool AreEqual(const std::vector<UInt64Type> &records,
+                       SizeType lhs, SizeType rhs) {
+    SizeType num_of_words = 2 * (records[lhs + 1] & 0xFFFFFFFFU);
+    if ((records[rhs + 1] & 0xFFFFFFFFU) != (records[lhs + 1] & 0xFFFFFFFFU)) {
+      return false;
+    }
+    for (SizeType i = 2; i < num_of_words + 2; ++i) {
+      if (records[lhs + i] != records[rhs + i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Writes transitions of the first states in order, whose children are
+  // redirected to the first states, and then writes a dawg with the root.
+  bool WriteMergedDawg(const std::string &dawg_file_name,
+                       SizeType num_of_transitions, BaseType root_base,
+                       SizeType num_of_merged_transitions) {
+    SizeType buffer_size = RecordReader<UInt64Type>::memory_usage() *
+        (num_of_partitions_ + 1) + RecordWriter<BaseType>::memory_usage() +
+        RecordWriter<UCharType>::memory_usage();
+
+    // Positions of states, or those of the first states of duplicates.
+    // Flags take an eighth of a cache or their minimum, and positions take
+    // the rest.
+    SizeType table_size = buffer_size + PageTableSize(num_of_transitions);
+    PagedArray<UCharType> flags;
+    PagedArray<BaseType> positions;
+    if (!flags.Create(temp_dir_, CacheSize(table_size) / 8) ||
+        !positions.Create(temp_dir_,
+                          CacheSize(table_size + flags.memory_usage()))) {
+      return false;
+    }
+    positions.resize(num_of_transitions);
+    flags.resize((num_of_transitions + 7) / 8);
+    UpdatePeakMemoryUsage(positions.memory_usage() + flags.memory_usage() +
+                          buffer_size);
+
+    RecordReader<UInt64Type> transition_reader;
+    bool is_opened = transition_reader.Open(transition_file_name_);
+    std::vector<RecordReader<UInt64Type> *> duplicate_readers(
+        num_of_partitions_);
+    std::vector<UInt64Type> duplicates(num_of_partitions_);
+    std::priority_queue<HeadType, std::vector<HeadType>,
+                        std::greater<HeadType> > heads;
+    for (SizeType i = 0; i < num_of_partitions_ && is_opened; ++i) {
+      duplicate_readers[i] = new RecordReader<UInt64Type>;
+      is_opened = duplicate_readers[i]->Open(duplicate_file_names_[i]);
+      if (is_opened && duplicate_readers[i]->Read(&duplicates[i])) {
+        heads.push(HeadType(
+            static_cast<BaseType>(duplicates[i] >> 32), i));
+      }
+    }
+
+    std::string base_file_name, label_file_name;
+    RecordWriter<BaseType> base_writer;
+    RecordWriter<UCharType> label_writer;
+    is_opened = is_opened && TempFile::Create(temp_dir_, &base_file_name) &&
+        base_writer.Open(base_file_name);
+    is_opened = is_opened && TempFile::Create(temp_dir_, &label_file_name) &&
+        label_writer.Open(label_file_name);
+
+    // Skips the root.
+    std::vector<UInt64Type> records;
+    bool is_read = is_opened && ReadState(&transition_reader, &records);
+    SizeType index = 1;
+    BaseType position = 1;
+    SizeType num_of_states = 1;
+    while (is_read && ReadState(&transition_reader, &records)) {
+      bool is_merging = ((records[0] >> 40) & 1) ? true : false;
+      if (!heads.empty() && heads.top().first == index) {
+        SizeType partition_id = heads.top().second;
+        heads.pop();
+        BaseType first_position = positions[static_cast<BaseType>(
+            duplicates[partition_id])];
+        positions[index] = first_position;
+        flags[first_position / 8] |= static_cast<UCharType>(
+            1 << (first_position % 8));
+        num_of_merged_transitions += records.size();
+
+        if (duplicate_readers[partition_id]->Read(
+                &duplicates[partition_id])) {
+          heads.push(HeadType(static_cast<BaseType>(
+              duplicates[partition_id] >> 32), partition_id));
+        }
+      } else {
+        positions[index] = position;
+        if (is_merging) {
+          flags[position / 8] |= static_cast<UCharType>(1 << (position % 8));
+        }
+        for (SizeType i = 0; i < records.size(); ++i) {
+          BaseType base = static_cast<BaseType>(records[i]);
+          UCharType label = static_cast<UCharType>(records[i] >> 32);
+          if (label != '\0') {
+            base = (positions[base >> 2] << 2) | (base & 3);
+          }
+          base_writer.Write(base);
+          label_writer.Write(label);
+        }
+        position += static_cast<BaseType>(records.size());
+        ++num_of_states;
+      }
+      index += records.size();
+    }
+    is_read = is_read && index == num_of_transitions && heads.empty();
+    for (SizeType i = 0; i < duplicate_readers.size(); ++i) {
+      delete duplicate_readers[i];
+    }
+
+    bool is_closed = base_writer.Close();
+    is_closed = label_writer.Close() && is_closed;
+    if ((root_base >> 2) != 0) {
+      root_base = (positions[root_base >> 2] << 2) | (root_base & 3);
+    }
+
+    bool is_written = is_read && is_closed && !positions.has_error() &&
+        WriteDawgFile(dawg_file_name, position, root_base, num_of_states,
+                      num_of_merged_transitions, base_file_name,
+                      label_file_name, flags);
+    std::remove(base_file_name.c_str());
+    std::remove(label_file_name.c_str());
+    return is_written;
+  }
+
+  // Writes a dawg file in the format of Dawg::Write().
+  static bool WriteDawgFile(const std::string &dawg_file_name,
+                            SizeType size, BaseType root_base,
+                            SizeType num_of_states,
+                            SizeType num_of_merged_transitions,
+                            const std::string &base_file_name,
+                            const std::string &label_file_name,
+                            const PagedArray<UCharType> &flags) {
+    SizeType num_of_merging_states = 0;
+    for (SizeType i = 0; i < (size + 7) / 8; ++i) {
+      for (UCharType bits = flags[i]; bits != 0; bits &= bits - 1) {
+        ++num_of_merging_states;
+      }
+    }
+
+    BaseType header[Dawg::NUM_OF_HEADER_FIELDS] = {
+      static_cast<BaseType>(size),
+      static_cast<BaseType>(num_of_states),
+      static_cast<BaseType>(num_of_merged_transitions),
+      static_cast<BaseType>((size - 1) + num_of_merged_transitions + 1 -
+                            num_of_states),
+      static_cast<BaseType>(num_of_merging_states)
+    };
+    const UCharType root_label = ROOT_LABEL;
+    std::ofstream file(dawg_file_name.c_str(), std::ios::binary);
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(&root_base), sizeof(BaseType));
+    if (!CopyFile(base_file_name, &file)) {
+      return false;
+    }
+    file.write(reinterpret_cast<const char *>(&root_label), 1);
+    if (!CopyFile(label_file_name, &file)) {
+      return false;
+    }
+    for (SizeType i = size; i < Dawg::LabelsSize(size); ++i) {
+      file.put('\0');
+    }
+    for (SizeType i = 0; i < Dawg::FlagsSize(size); ++i) {
+      file.put((i < (size + 7) / 8) ? static_cast<char>(flags[i]) : '\0');
+    }
+    return file.flush() && !flags.has_error();
+  }
+
+  // Appends a file to an output stream.
+  static bool CopyFile(const std::string &file_name, std::ostream *output) {
+    std::ifstream file(file_name.c_str(), std::ios::binary);
+    if (!file) {
+      return false;
+    }
+    std::vector<char> buf(RecordReader<UInt64Type>::memory_usage());
+    while (file.read(&buf[0], buf.size()) || file.gcount() > 0) {
+      if (!output->write(&buf[0], file.gcount())) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Gives the rest of the budget to a cache.
+  SizeType CacheSize(SizeType memory_usage) const {
+    return (memory_usage < memory_budget_) ?
+        (memory_budget_ - memory_usage) : 0;
+  }
+
+  // Bounds the size of tables of pages of PagedArrays, which have
+  // an entry per page of at least 512 objects.
+  static SizeType PageTableSize(SizeType size) {
+    return sizeof(BaseType) * 2 * (size / 512 + 1);
+  }
+
+  // Returns memory freed by a pass to the system before the next pass,
+  // because malloc() may keep it, such as small blocks of a builder.
+  static void TrimMemory() {
+#if defined(__GLIBC__)
+    ::malloc_trim(0);
+#endif  // defined(__GLIBC__)
+  }
+
+  // Removes temporary files and closes a file of transitions.
+  void ClearFiles() {
+    if (transition_file_.is_open()) {
+      transition_file_.close();
+    }
+    transition_file_.clear();
+    if (!transition_file_name_.empty()) {
+      std::remove(transition_file_name_.c_str());
+      transition_file_name_.clear();
+    }
+    RemoveFiles(&partition_file_names_);
+    RemoveFiles(&duplicate_file_names_);
+    std::vector<SizeType>(0).swap(partition_num_of_states_);
+    std::vector<SizeType>(0).swap(partition_num_of_words_);
+  }
+
+  static void RemoveFiles(std::vector<std::string> *file_names) {
+    for (SizeType i = 0; i < file_names->size(); ++i) {
+      std::remove((*file_names)[i].c_str());
+    }
+    std::vector<std::string>(0).swap(*file_names);
+  }
+
+  void UpdatePeakMemoryUsage(SizeType memory_usage) {
+    if (memory_usage > peak_memory_usage_) {
+      peak_memory_usage_ = memory_usage;
+    }
+  }
+
+  // 64-bit mix function of MurmurHash3.
+  static UInt64Type Hash(UInt64Type key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ULL;
+    key ^= key >> 33;
+    return key;
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_EXTERNAL_DAWG_BUILDER_H
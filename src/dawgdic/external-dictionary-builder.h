@@ -0,0 +1,161 @@
+#ifndef DAWGDIC_EXTERNAL_DICTIONARY_BUILDER_H
+#define DAWGDIC_EXTERNAL_DICTIONARY_BUILDER_H
+
+#include <iostream>
+#include <string>
+
+#include "access-profile.h"
+#include "build-progress.h"
+#include "dictionary-builder.h"
+#include "paged-array.h"
+#include "paged-dawg.h"
+#include "temp-file.h"
+
+namespace dawgdic {
+
+// Builder of a dictionary from a PagedDawg for dictionaries which do not fit
+// in memory. Units are kept in a temporary file through a cache, and they
+// are written to a stream in the format of Dictionary::Write(). Offsets of
+// merging states are kept in another file, indexed by transitions of the
+// dawg instead of hashed. Caches share the budget, and the rest of memory
+// is for unfixed blocks and a profile, which are independent of the size
+// of a dawg.
+class ExternalDictionaryBuilder {
+ public:
+  explicit ExternalDictionaryBuilder(SizeType memory_budget,
+                                     const char *temp_dir = NULL)
+    : memory_budget_(memory_budget), temp_dir_(TempFile::Dir(temp_dir)),
+      num_of_units_(0), num_of_unused_units_(0), peak_memory_usage_(0) {}
+
+  SizeType memory_budget() const {
+    return memory_budget_;
+  }
+  const std::string &temp_dir() const {
+    return temp_dir_;
+  }
+  // Statistics of the last build.
+  SizeType num_of_units() const {
+    return num_of_units_;
+  }
+  BaseType num_of_unused_units() const {
+    return num_of_unused_units_;
+  }
+  // Peak number of bytes used by caches and unfixed blocks.
+  SizeType peak_memory_usage() const {
+    return peak_memory_usage_;
+  }
+
+  // Builds a dictionary and writes it to an output stream.
+  bool Build(const PagedDawg &dawg, std::ostream *output,
+             BuildProgress *progress = NULL) {
+    return Build(dawg, NULL, 0, output, progress);
+  }
+
+  // Builds a dictionary with a hot region. See DictionaryBuilder.
+  bool Build(const PagedDawg &dawg, const AccessProfile &profile,
+             std::ostream *output,
+             SizeType hot_region_size =
+                 DictionaryBuilder::DEFAULT_HOT_REGION_SIZE,
+             BuildProgress *progress = NULL) {
+    return Build(dawg, &profile, hot_region_size, output, progress);
+  }
+
+ private:
+  // Table of offsets indexed by transitions of a dawg.
+  class LinkArray {
+   public:
+    LinkArray() : offsets_() {}
+
+    SizeType memory_usage() const {
+      return offsets_.memory_usage();
+    }
+    bool has_error() const {
+      return offsets_.has_error();
+    }
+
+    bool Create(const std::string &temp_dir, SizeType cache_size,
+                SizeType size) {
+      if (!offsets_.Create(temp_dir, cache_size)) {
+        return false;
+      }
+      offsets_.resize(size);
+      return true;
+    }
+
+    // Finds an offset that corresponds to a given index.
+    BaseType Find(BaseType index) const {
+      return offsets_[index];
+    }
+
+    // Inserts an index with its offset.
+    void Insert(BaseType index, BaseType offset) {
+      offsets_[index] = offset;
+    }
+
+   private:
+    PagedArray<BaseType> offsets_;
+
+    // Disallows copies.
+    LinkArray(const LinkArray &);
+    LinkArray &operator=(const LinkArray &);
+  };
+
+  typedef BasicDictionaryBuilder<PagedDawg, PagedArray<DictionaryUnit>,
+                                 LinkArray> BuilderType;
+
+  const SizeType memory_budget_;
+  std::string temp_dir_;
+  SizeType num_of_units_;
+  BaseType num_of_unused_units_;
+  SizeType peak_memory_usage_;
+
+  // Disallows copies.
+  ExternalDictionaryBuilder(const ExternalDictionaryBuilder &);
+  ExternalDictionaryBuilder &operator=(const ExternalDictionaryBuilder &);
+
+  // Builds units in a file, whose cache gets a half of the budget except
+  // for unfixed blocks, and then writes them.
+  bool Build(const PagedDawg &dawg, const AccessProfile *profile,
+             SizeType hot_region_size, std::ostream *output,
+             BuildProgress *progress) {
+    num_of_units_ = 0;
+    num_of_unused_units_ = 0;
+    peak_memory_usage_ = 0;
+
+    // Tables of pages, which have an entry per page of 1024 units, are
+    // bounded as if a dictionary had as many units as a dawg and its table
+    // had grown twice.
+    SizeType block_size = sizeof(DictionaryExtraBlock) *
+        BuilderType::NUM_OF_UNFIXED_BLOCKS +
+        sizeof(BaseType) * 4 * (dawg.size() / 1024 + 1);
+    SizeType cache_size = (block_size < memory_budget_) ?
+        (memory_budget_ - block_size) : 0;
+
+    PagedArray<DictionaryUnit> units;
+    LinkArray link_table;
+    if (!units.Create(temp_dir_, cache_size / 2) ||
+        !link_table.Create(temp_dir_, cache_size / 2, dawg.size())) {
+      return false;
+    }
+
+    if (!BuilderType::BuildUnits(dawg, profile, hot_region_size, &units,
+                                 &link_table, &num_of_unused_units_,
+                                 progress)) {
+      return false;
+    }
+    num_of_units_ = units.size();
+    peak_memory_usage_ = units.memory_usage() + link_table.memory_usage() +
+        sizeof(DictionaryExtraBlock) * BuilderType::NUM_OF_UNFIXED_BLOCKS;
+
+    BaseType base_size = static_cast<BaseType>(units.size());
+    if (!output->write(reinterpret_cast<const char *>(&base_size),
+                       sizeof(BaseType)) || !units.Write(output)) {
+      return false;
+    }
+    return !dawg.has_error() && !link_table.has_error();
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_EXTERNAL_DICTIONARY_BUILDER_H
@@ -0,0 +1,111 @@
+#ifndef DAWGDIC_FILE_SECTION_H
+#define DAWGDIC_FILE_SECTION_H
+
+#include "base-types.h"
+
+namespace dawgdic {
+
+// Entry of the section table in a container file.
+//
+// A container file starts with a header, which consists of an 8-byte magic
+// string, a version, the number of sections and the alignment of sections,
+// followed by the section table. The header and each section are padded to
+// the alignment, so that sections can be mapped without copying.
+class FileSection {
+ public:
+  // Section types.
+  enum {
+    DICTIONARY = 1,
+    GUIDE = 2,
+    RANKED_GUIDE = 3,
+    ORDINAL_TABLE = 4,
+    VALUE_TABLE = 5,
+    BEST_VALUE_TABLE = 6
+  };
+
+  // Section flags.
+  enum {
+    HAS_CHECKSUM = 1 << 0
+  };
+
+  // Header fields.
+  enum {
+    FORMAT_VERSION = 1,
+    MAGIC_SIZE = 8,
+    HEADER_SIZE = MAGIC_SIZE + sizeof(BaseType) * 4,
+    DEFAULT_ALIGNMENT = 4096
+  };
+
+  FileSection()
+    : type_(0), flags_(0), checksum_(0), reserved_(0), offset_(0), size_(0) {}
+
+  void set_type(BaseType type) {
+    type_ = type;
+  }
+  void set_checksum(BaseType checksum) {
+    flags_ |= HAS_CHECKSUM;
+    checksum_ = checksum;
+  }
+  void set_offset(UInt64Type offset) {
+    offset_ = offset;
+  }
+  void set_size(UInt64Type size) {
+    size_ = size;
+  }
+
+  BaseType type() const {
+    return type_;
+  }
+  bool has_checksum() const {
+    return (flags_ & HAS_CHECKSUM) ? true : false;
+  }
+  BaseType checksum() const {
+    return checksum_;
+  }
+  // Offset from the beginning of a file.
+  UInt64Type offset() const {
+    return offset_;
+  }
+  // Size in bytes.
+  UInt64Type size() const {
+    return size_;
+  }
+
+  // Magic string at the beginning of a container file.
+  static const char *magic() {
+    return "DAWGDIC";
+  }
+
+  // Calculates CRC-32 (polynomial 0xEDB88320) of a byte sequence.
+  static BaseType Checksum(const void *address, SizeType size) {
+    BaseType table[256];
+    for (BaseType i = 0; i < 256; ++i) {
+      BaseType crc = i;
+      for (int j = 0; j < 8; ++j) {
+        crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320U) : (crc >> 1);
+      }
+      table[i] = crc;
+    }
+
+    const UCharType *bytes = static_cast<const UCharType *>(address);
+    BaseType crc = ~static_cast<BaseType>(0);
+    for (SizeType i = 0; i < size; ++i) {
+      crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+  }
+
+ private:
+  BaseType type_;
+  BaseType flags_;
+  BaseType checksum_;
+  BaseType reserved_;
+  UInt64Type offset_;
+  UInt64Type size_;
+
+  // Copyable.
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_FILE_SECTION_H
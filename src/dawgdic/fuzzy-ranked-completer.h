@@ -0,0 +1,303 @@
+#ifndef DAWGDIC_FUZZY_RANKED_COMPLETER_H
+#define DAWGDIC_FUZZY_RANKED_COMPLETER_H
+
+#include "ranked-completer.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace dawgdic {
+
+// Completer which tolerates typos in a prefix. Keys are completed if one of
+// their prefixes is within a given edit distance of a prefix. Transitions
+// of a dictionary are followed together with rows of an edit distance
+// table, and states whose keys are close enough to the prefix become roots
+// of a ranked completer. So, keys under the roots are completed by one
+// traversal in order of values.
+template <typename VALUE_COMPARER_TYPE = std::less<ValueType> >
+class FuzzyRankedCompleterBase {
+ public:
+  typedef VALUE_COMPARER_TYPE ValueComparerType;
+
+  enum {
+    // Upper limit of an edit distance. The number of roots grows rapidly
+    // with a distance.
+    MAX_DISTANCE = 2
+  };
+
+  explicit FuzzyRankedCompleterBase(
+      ValueComparerType value_comparer = ValueComparerType())
+    : completer_(value_comparer), prefix_(), max_distance_(0), rows_(),
+      path_(), frames_(), num_of_roots_(0), distance_(0) {}
+  FuzzyRankedCompleterBase(const Dictionary &dic, const RankedGuide &guide,
+      ValueComparerType value_comparer = ValueComparerType())
+    : completer_(dic, guide, value_comparer), prefix_(), max_distance_(0),
+      rows_(), path_(), frames_(), num_of_roots_(0), distance_(0) {}
+
+  void set_dic(const Dictionary &dic) {
+    completer_.set_dic(dic);
+  }
+  void set_guide(const RankedGuide &guide) {
+    completer_.set_guide(guide);
+  }
+  // See RankedCompleterBase for a table and a threshold.
+  void set_table(const BestValueTable &table) {
+    completer_.set_table(table);
+  }
+  void set_min_value(ValueType min_value) {
+    completer_.set_min_value(min_value);
+  }
+  void clear_min_value() {
+    completer_.clear_min_value();
+  }
+
+  const Dictionary &dic() const {
+    return completer_.dic();
+  }
+  const RankedGuide &guide() const {
+    return completer_.guide();
+  }
+  // Number of states whose keys are within the distance of the prefix.
+  SizeType num_of_roots() const {
+    return num_of_roots_;
+  }
+  // Number of nodes created since the last Start().
+  SizeType num_of_nodes() const {
+    return completer_.num_of_nodes();
+  }
+
+  // These member functions are available only when Next() returns true.
+  const char *key() const {
+    return completer_.key();
+  }
+  SizeType length() const {
+    return completer_.length();
+  }
+  ValueType value() const {
+    return completer_.value();
+  }
+  // Least edit distance between the prefix and prefixes of the key.
+  SizeType distance() const {
+    return distance_;
+  }
+
+  // Starts completing keys from a prefix. This fails if the distance is
+  // greater than MAX_DISTANCE.
+  bool Start(const char *prefix, SizeType max_distance = 1) {
+    SizeType length = 0;
+    for (const char *p = prefix; *p != '\0'; ++p) {
+      ++length;
+    }
+
+    return Start(prefix, length, max_distance);
+  }
+  bool Start(const char *prefix, SizeType length, SizeType max_distance) {
+    completer_.Clear();
+    num_of_roots_ = 0;
+    if (max_distance > MAX_DISTANCE) {
+      return false;
+    }
+
+    prefix_.assign(prefix, prefix + length);
+    max_distance_ = max_distance;
+
+    // A row of depth d keeps edit distances between the first d labels of
+    // a path and prefixes of the prefix. No state deeper than the length
+    // of the prefix plus the distance is followed.
+    rows_.resize((length + max_distance + 2) * (length + 1));
+    for (SizeType i = 0; i <= length; ++i) {
+      rows_[i] = i;
+    }
+
+    if (guide().size() == 0) {
+      return true;
+    }
+
+    path_.clear();
+    frames_.clear();
+    VisitState(dic().root(), 0, 0);
+    while (!frames_.empty()) {
+      UCharType label;
+      BaseType child_index;
+      if (!FindChild(&frames_.back(), &label, &child_index)) {
+        frames_.pop_back();
+        continue;
+      }
+
+      SizeType depth = frames_.size();
+      path_.resize(depth - 1);
+      path_.push_back(static_cast<char>(label));
+      VisitState(child_index, depth, UpdateRow(depth, label));
+    }
+    return true;
+  }
+
+  // Gets the next key.
+  bool Next() {
+    if (!completer_.Next()) {
+      return false;
+    }
+    distance_ = FindDistance();
+    return true;
+  }
+
+  // Completes at most k keys from a prefix into a buffer in order of
+  // values, and returns the number of keys.
+  SizeType TopK(const char *prefix, SizeType length, SizeType max_distance,
+                SizeType k, CompletionBuffer *results) {
+    results->Clear();
+    if (!Start(prefix, length, max_distance)) {
+      return 0;
+    }
+    while (results->size() < k && Next()) {
+      results->Append(key(), this->length(), value());
+    }
+    return results->size();
+  }
+
+ private:
+  // Frame of a stack for visiting states depth-first, which keeps the next
+  // label of a state.
+  class Frame {
+   public:
+    Frame(BaseType dic_index, UCharType label)
+      : dic_index_(dic_index), label_(label), has_terminal_(false) {}
+
+    void set_label(UCharType label) {
+      label_ = label;
+    }
+    void set_has_terminal(bool has_terminal) {
+      has_terminal_ = has_terminal;
+    }
+
+    BaseType dic_index() const {
+      return dic_index_;
+    }
+    UCharType label() const {
+      return label_;
+    }
+    bool has_terminal() const {
+      return has_terminal_;
+    }
+
+   private:
+    BaseType dic_index_;
+    UCharType label_;
+    bool has_terminal_;
+
+    // Copyable.
+  };
+
+  RankedCompleterBase<ValueComparerType> completer_;
+  std::vector<UCharType> prefix_;
+  SizeType max_distance_;
+  std::vector<SizeType> rows_;
+  std::vector<char> path_;
+  std::vector<Frame> frames_;
+  SizeType num_of_roots_;
+  SizeType distance_;
+
+  // Disallows copies.
+  FuzzyRankedCompleterBase(const FuzzyRankedCompleterBase &);
+  FuzzyRankedCompleterBase &operator=(const FuzzyRankedCompleterBase &);
+
+  // Adds a state as a root if its key is within the distance of the prefix.
+  // Otherwise, a frame is pushed if its descendants may be.
+  void VisitState(BaseType dic_index, SizeType depth, SizeType min_distance) {
+    if (rows_[depth * (prefix_.size() + 1) + prefix_.size()] <=
+        max_distance_) {
+      if (completer_.AddRoot(dic_index, path_.empty() ? "" : &path_[0],
+                             path_.size())) {
+        ++num_of_roots_;
+      }
+    } else if (min_distance <= max_distance_) {
+      Frame frame(dic_index, guide().child(dic_index));
+      frame.set_has_terminal(dic().has_value(dic_index));
+      frames_.push_back(frame);
+    }
+  }
+
+  // Finds the next child of a state in the order of a guide. A label '\0'
+  // is either a terminal or the end of siblings, and a terminal is skipped.
+  bool FindChild(Frame *frame, UCharType *label, BaseType *child_index) {
+    while (frame->label() == '\0') {
+      if (!frame->has_terminal()) {
+        return false;
+      }
+      frame->set_has_terminal(false);
+      frame->set_label(guide().sibling(
+          FollowWithoutCheck(frame->dic_index(), '\0')));
+    }
+
+    *label = frame->label();
+    *child_index = FollowWithoutCheck(frame->dic_index(), *label);
+    frame->set_label(guide().sibling(*child_index));
+    return true;
+  }
+
+  // Calculates a row from its previous row, and returns the least distance
+  // in the row.
+  SizeType UpdateRow(SizeType depth, UCharType label) {
+    SizeType num_of_columns = prefix_.size() + 1;
+    const SizeType *prev_row = &rows_[(depth - 1) * num_of_columns];
+    SizeType *row = &rows_[depth * num_of_columns];
+    return UpdateRow(prev_row, label, row);
+  }
+  SizeType UpdateRow(const SizeType *prev_row, UCharType label,
+                     SizeType *row) const {
+    row[0] = prev_row[0] + 1;
+    SizeType min_distance = row[0];
+    for (SizeType i = 1; i <= prefix_.size(); ++i) {
+      SizeType distance = prev_row[i - 1] + (prefix_[i - 1] != label);
+      if (prev_row[i] + 1 < distance) {
+        distance = prev_row[i] + 1;
+      }
+      if (row[i - 1] + 1 < distance) {
+        distance = row[i - 1] + 1;
+      }
+      row[i] = distance;
+      if (distance < min_distance) {
+        min_distance = distance;
+      }
+    }
+    return min_distance;
+  }
+
+  // Finds the least edit distance between the prefix and prefixes of the
+  // current key. The first two rows are reused, and the least distance in
+  // a row never decreases with depth.
+  SizeType FindDistance() {
+    SizeType num_of_columns = prefix_.size() + 1;
+    SizeType *row = &rows_[0];
+    SizeType *next_row = &rows_[num_of_columns];
+    for (SizeType i = 0; i < num_of_columns; ++i) {
+      row[i] = i;
+    }
+
+    SizeType distance = row[prefix_.size()];
+    const char *key = completer_.key();
+    for (SizeType i = 0; i < completer_.length(); ++i) {
+      SizeType min_distance =
+          UpdateRow(row, static_cast<UCharType>(key[i]), next_row);
+      if (next_row[prefix_.size()] < distance) {
+        distance = next_row[prefix_.size()];
+      }
+      if (min_distance >= distance) {
+        break;
+      }
+      std::swap(row, next_row);
+    }
+    return distance;
+  }
+
+  // Follows a transition without any check.
+  BaseType FollowWithoutCheck(BaseType index, UCharType label) const {
+    return index ^ dic().units()[index].offset() ^ label;
+  }
+};
+
+typedef FuzzyRankedCompleterBase<> FuzzyRankedCompleter;
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_FUZZY_RANKED_COMPLETER_H
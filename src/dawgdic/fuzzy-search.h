@@ -0,0 +1,275 @@
+#ifndef DAWGDIC_FUZZY_SEARCH_H
+#define DAWGDIC_FUZZY_SEARCH_H
+
+#include "completion-buffer.h"
+#include "dictionary.h"
+#include "guide.h"
+
+#include <vector>
+
+namespace dawgdic {
+
+// Finds keys within an edit distance of a word. States of a dictionary are
+// visited depth-first, and each state keeps a column of an edit distance
+// table as bit vectors of vertical deltas, which are updated by Myers'
+// bit-parallel algorithm. A branch is cut when no cell near the diagonal
+// of its column is within the distance.
+class FuzzySearch {
+ public:
+  enum {
+    // Upper limit of the length of a word, which fits in a bit vector.
+    MAX_LENGTH = 64
+  };
+
+  FuzzySearch()
+    : dic_(NULL), guide_(NULL), length_(0), mask_(0), max_distance_(0),
+      key_(), frames_(), distances_(), num_of_states_(0) {
+    Init();
+  }
+  FuzzySearch(const Dictionary &dic, const Guide &guide)
+    : dic_(&dic), guide_(&guide), length_(0), mask_(0), max_distance_(0),
+      key_(), frames_(), distances_(), num_of_states_(0) {
+    Init();
+  }
+
+  void set_dic(const Dictionary &dic) {
+    dic_ = &dic;
+  }
+  void set_guide(const Guide &guide) {
+    guide_ = &guide;
+  }
+
+  const Dictionary &dic() const {
+    return *dic_;
+  }
+  const Guide &guide() const {
+    return *guide_;
+  }
+  // Number of states visited by the last Find().
+  SizeType num_of_states() const {
+    return num_of_states_;
+  }
+  // Edit distance between the word and the i-th key of the last Find().
+  SizeType distance(SizeType i) const {
+    return distances_[i];
+  }
+
+  // Finds keys within a distance of a word into a buffer in order of a
+  // guide. This fails if the word is longer than MAX_LENGTH.
+  bool Find(const char *word, SizeType max_distance,
+            CompletionBuffer *results) {
+    SizeType length = 0;
+    for (const char *p = word; *p != '\0'; ++p) {
+      ++length;
+    }
+
+    return Find(word, length, max_distance, results);
+  }
+  bool Find(const char *word, SizeType length, SizeType max_distance,
+            CompletionBuffer *results) {
+    results->Clear();
+    distances_.clear();
+    num_of_states_ = 0;
+    if (length > MAX_LENGTH) {
+      return false;
+    }
+
+    // Bit i of a vector of a label is set if the i-th label of the word is
+    // the label.
+    for (SizeType i = 0; i < length; ++i) {
+      match_vectors_[static_cast<UCharType>(word[i])] |=
+          static_cast<UInt64Type>(1) << i;
+    }
+    length_ = length;
+    mask_ = (length == MAX_LENGTH) ? ~static_cast<UInt64Type>(0) :
+        (static_cast<UInt64Type>(1) << length) - 1;
+    max_distance_ = max_distance;
+
+    if (guide_->size() != 0) {
+      Search(results);
+    }
+
+    for (SizeType i = 0; i < length; ++i) {
+      match_vectors_[static_cast<UCharType>(word[i])] = 0;
+    }
+    return true;
+  }
+
+ private:
+  // Frame of a stack for visiting states depth-first, which keeps the next
+  // label of a state and vertical deltas of its column. A set bit i of
+  // positive or negative deltas means that the (i + 1)-th cell is greater
+  // or less than the i-th cell by 1.
+  class Frame {
+   public:
+    Frame(BaseType dic_index, UCharType label, UInt64Type positive_deltas,
+          UInt64Type negative_deltas)
+      : dic_index_(dic_index), label_(label),
+        positive_deltas_(positive_deltas),
+        negative_deltas_(negative_deltas) {}
+
+    void set_label(UCharType label) {
+      label_ = label;
+    }
+
+    BaseType dic_index() const {
+      return dic_index_;
+    }
+    UCharType label() const {
+      return label_;
+    }
+    UInt64Type positive_deltas() const {
+      return positive_deltas_;
+    }
+    UInt64Type negative_deltas() const {
+      return negative_deltas_;
+    }
+
+   private:
+    BaseType dic_index_;
+    UCharType label_;
+    UInt64Type positive_deltas_;
+    UInt64Type negative_deltas_;
+
+    // Copyable.
+  };
+
+  const Dictionary *dic_;
+  const Guide *guide_;
+  UInt64Type match_vectors_[256];
+  SizeType length_;
+  UInt64Type mask_;
+  SizeType max_distance_;
+  std::vector<char> key_;
+  std::vector<Frame> frames_;
+  std::vector<SizeType> distances_;
+  SizeType num_of_states_;
+
+  // Disallows copies.
+  FuzzySearch(const FuzzySearch &);
+  FuzzySearch &operator=(const FuzzySearch &);
+
+  void Init() {
+    for (SizeType i = 0; i < 256; ++i) {
+      match_vectors_[i] = 0;
+    }
+  }
+
+  void Search(CompletionBuffer *results) {
+    key_.clear();
+    frames_.clear();
+
+    // The first column is 0, 1, ..., length.
+    VisitState(dic_->root(), 0, mask_, 0, results);
+    while (!frames_.empty()) {
+      Frame &frame = frames_.back();
+      UCharType label = frame.label();
+      if (label == '\0') {
+        frames_.pop_back();
+        continue;
+      }
+
+      BaseType dic_index = frame.dic_index();
+      dic_index ^= dic_->units()[dic_index].offset() ^ label;
+      frame.set_label(guide_->sibling(dic_index));
+
+      // Updates vertical deltas by Myers' algorithm. The first cell of a
+      // column is its depth, so a positive delta is shifted in.
+      UInt64Type positive_deltas = frame.positive_deltas();
+      UInt64Type negative_deltas = frame.negative_deltas();
+      UInt64Type matches = match_vectors_[label];
+      UInt64Type vertical = matches | negative_deltas;
+      UInt64Type horizontal = (((matches & positive_deltas) +
+          positive_deltas) ^ positive_deltas) | matches;
+      UInt64Type positive_horizontal =
+          negative_deltas | ~(horizontal | positive_deltas);
+      UInt64Type negative_horizontal = positive_deltas & horizontal;
+      positive_horizontal = (positive_horizontal << 1) | 1;
+      negative_horizontal <<= 1;
+      positive_deltas = (negative_horizontal |
+          ~(vertical | positive_horizontal)) & mask_;
+      negative_deltas = positive_horizontal & vertical & mask_;
+
+      SizeType depth = frames_.size();
+      key_.resize(depth - 1);
+      key_.push_back(static_cast<char>(label));
+      VisitState(dic_index, depth, positive_deltas, negative_deltas, results);
+    }
+  }
+
+  // Appends the key of a state if it is within the distance, and pushes a
+  // frame if its descendants may be.
+  void VisitState(BaseType dic_index, SizeType depth,
+                  UInt64Type positive_deltas, UInt64Type negative_deltas,
+                  CompletionBuffer *results) {
+    ++num_of_states_;
+    if (dic_->has_value(dic_index)) {
+      SizeType distance =
+          FindCell(depth, positive_deltas, negative_deltas, length_);
+      if (distance <= max_distance_) {
+        results->Append(key_.empty() ? "" : &key_[0], key_.size(),
+                        dic_->value(dic_index));
+        distances_.push_back(distance);
+      }
+    }
+
+    UCharType child_label = guide_->child(dic_index);
+    if (child_label != '\0' &&
+        FindMinCell(depth, positive_deltas, negative_deltas) <=
+        max_distance_) {
+      frames_.push_back(Frame(dic_index, child_label,
+                              positive_deltas, negative_deltas));
+    }
+  }
+
+  // Finds the i-th cell of a column by summing its deltas.
+  static SizeType FindCell(SizeType depth, UInt64Type positive_deltas,
+                           UInt64Type negative_deltas, SizeType i) {
+    UInt64Type mask = (i == MAX_LENGTH) ? ~static_cast<UInt64Type>(0) :
+        (static_cast<UInt64Type>(1) << i) - 1;
+    return depth + CountBits(positive_deltas & mask) -
+        CountBits(negative_deltas & mask);
+  }
+
+  // Finds the least cell of a column. A cell far from the diagonal is
+  // greater than the distance, so only cells near the diagonal are read.
+  SizeType FindMinCell(SizeType depth, UInt64Type positive_deltas,
+                       UInt64Type negative_deltas) const {
+    SizeType begin = (depth > max_distance_) ? depth - max_distance_ : 0;
+    if (begin > length_) {
+      return max_distance_ + 1;
+    }
+    SizeType end = depth + max_distance_;
+    if (end > length_) {
+      end = length_;
+    }
+
+    SizeType cell = FindCell(depth, positive_deltas, negative_deltas, begin);
+    SizeType min_cell = cell;
+    for (SizeType i = begin; i < end; ++i) {
+      cell = cell + ((positive_deltas >> i) & 1) -
+          ((negative_deltas >> i) & 1);
+      if (cell < min_cell) {
+        min_cell = cell;
+      }
+    }
+    return min_cell;
+  }
+
+  // Counts set bits.
+  static SizeType CountBits(UInt64Type bits) {
+#if defined(__GNUC__)
+    return static_cast<SizeType>(__builtin_popcountll(bits));
+#else  // defined(__GNUC__)
+    SizeType count = 0;
+    for ( ; bits != 0; bits &= bits - 1) {
+      ++count;
+    }
+    return count;
+#endif  // defined(__GNUC__)
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_FUZZY_SEARCH_H
@@ -1,6 +1,7 @@
 #ifndef DAWGDIC_GUIDE_BUILDER_H
 #define DAWGDIC_GUIDE_BUILDER_H
 
+#include "build-progress.h"
 #include "guide.h"
 #include "dawg.h"
 #include "dictionary.h"
@@ -11,31 +12,70 @@ namespace dawgdic {
 
 class GuideBuilder {
  public:
-  // Builds a dictionary for completing keys.
-  static bool Build(const Dawg &dawg, const Dictionary &dic, Guide *guide) {
-    GuideBuilder builder(dawg, dic, guide);
+  // Builds a dictionary for completing keys. If a progress is given, it is
+  // updated while building.
+  static bool Build(const Dawg &dawg, const Dictionary &dic, Guide *guide,
+                    BuildProgress *progress = NULL) {
+    GuideBuilder builder(dawg, dic, guide, progress);
     return builder.BuildGuide();
   }
 
  private:
+  enum {
+    // Number of frames allocated to a stack in advance.
+    INITIAL_STACK_SIZE = 1 << 10
+  };
+
+  // Frame of a stack for building a guide depth-first, which keeps the
+  // next child of a state.
+  class Frame {
+   public:
+    Frame(BaseType dawg_child_index, BaseType dic_index)
+      : dawg_child_index_(dawg_child_index), dic_index_(dic_index) {}
+
+    void set_dawg_child_index(BaseType dawg_child_index) {
+      dawg_child_index_ = dawg_child_index;
+    }
+
+    BaseType dawg_child_index() const {
+      return dawg_child_index_;
+    }
+    BaseType dic_index() const {
+      return dic_index_;
+    }
+
+   private:
+    BaseType dawg_child_index_;
+    BaseType dic_index_;
+
+    // Copyable.
+  };
+
   const Dawg &dawg_;
   const Dictionary &dic_;
   Guide *guide_;
+  BuildProgress *progress_;
 
   std::vector<GuideUnit> units_;
   std::vector<UCharType> is_fixed_table_;
+  std::vector<Frame> frames_;
 
   // Disallows copies.
   GuideBuilder(const GuideBuilder &);
   GuideBuilder &operator=(const GuideBuilder &);
 
-  GuideBuilder(const Dawg &dawg, const Dictionary &dic, Guide *guide)
-    : dawg_(dawg), dic_(dic), guide_(guide), units_(), is_fixed_table_() {}
+  GuideBuilder(const Dawg &dawg, const Dictionary &dic, Guide *guide,
+               BuildProgress *progress)
+    : dawg_(dawg), dic_(dic), guide_(guide), progress_(progress),
+      units_(), is_fixed_table_(), frames_() {}
 
   bool BuildGuide() {
     // Initializes units and flags.
     units_.resize(dic_.size());
     is_fixed_table_.resize(dic_.size() / 8, '\0');
+    if (progress_ != NULL) {
+      progress_->Start(dawg_.num_of_states());
+    }
 
     if (dawg_.size() <= 1) {
       return true;
@@ -49,46 +89,61 @@ class GuideBuilder {
     return true;
   }
 
-  // Builds a guide recursively.
+  // Builds a guide depth-first. A stack of frames is used instead of
+  // recursion, so the depth is not limited by the stack size of a thread.
   bool BuildGuide(BaseType dawg_index, BaseType dic_index) {
-    if (is_fixed(dic_index)) {
-      return true;
-    }
-    set_is_fixed(dic_index);
+    frames_.reserve(INITIAL_STACK_SIZE);
+    frames_.clear();
+    VisitState(dawg_index, dic_index);
 
-    // Finds the first non-terminal child.
-    BaseType dawg_child_index = dawg_.child(dawg_index);
-    if (dawg_.label(dawg_child_index) == '\0') {
-      dawg_child_index = dawg_.sibling(dawg_child_index);
+    while (!frames_.empty()) {
+      BaseType dawg_child_index = frames_.back().dawg_child_index();
       if (dawg_child_index == 0) {
-        return true;
+        frames_.pop_back();
+        continue;
       }
-    }
-    units_[dic_index].set_child(dawg_.label(dawg_child_index));
 
-    do {
       UCharType child_label = dawg_.label(dawg_child_index);
-      BaseType dic_child_index = dic_index;
+      BaseType dic_child_index = frames_.back().dic_index();
       if (!dic_.Follow(child_label, &dic_child_index)) {
         return false;
       }
 
-      if (!BuildGuide(dawg_child_index, dic_child_index)) {
-        return false;
-      }
-
       BaseType dawg_sibling_index = dawg_.sibling(dawg_child_index);
       UCharType sibling_label = dawg_.label(dawg_sibling_index);
       if (dawg_sibling_index != 0) {
         units_[dic_child_index].set_sibling(sibling_label);
       }
+      frames_.back().set_dawg_child_index(dawg_sibling_index);
 
-      dawg_child_index = dawg_sibling_index;
-    } while (dawg_child_index != 0);
-
+      VisitState(dawg_child_index, dic_child_index);
+    }
     return true;
   }
 
+  // Visits a state, and pushes a frame if it has non-terminal children.
+  void VisitState(BaseType dawg_index, BaseType dic_index) {
+    if (is_fixed(dic_index)) {
+      return;
+    }
+    set_is_fixed(dic_index);
+    if (progress_ != NULL) {
+      progress_->Visit(frames_.size());
+    }
+
+    // Finds the first non-terminal child.
+    BaseType dawg_child_index = dawg_.child(dawg_index);
+    if (dawg_.label(dawg_child_index) == '\0') {
+      dawg_child_index = dawg_.sibling(dawg_child_index);
+      if (dawg_child_index == 0) {
+        return;
+      }
+    }
+    units_[dic_index].set_child(dawg_.label(dawg_child_index));
+
+    frames_.push_back(Frame(dawg_child_index, dic_index));
+  }
+
   void set_is_fixed(BaseType index) {
     is_fixed_table_[index / 8] |= 1 << (index % 8);
   }
@@ -2,6 +2,7 @@
 #define DAWGDIC_GUIDE_H
 
 #include "dictionary.h"
+#include "huge-page-buffer.h"
 #include "guide-unit.h"
 
 #include <iostream>
@@ -11,7 +12,7 @@ namespace dawgdic {
 
 class Guide {
  public:
-  Guide() : units_(NULL), size_(0), units_buf_() {}
+  Guide() : units_(NULL), size_(0), units_buf_(), huge_page_buf_() {}
 
   const GuideUnit *units() const {
     return units_;
@@ -25,6 +26,11 @@ class Guide {
   SizeType file_size() const {
     return sizeof(BaseType) + total_size();
   }
+  // Number of bytes in huge pages around units, which may be read from
+  // a file or mapped. See HugePageBuffer::CountHugePageBytes().
+  SizeType huge_page_bytes() const {
+    return HugePageBuffer::CountHugePageBytes(units_, total_size());
+  }
 
   // The root index.
   BaseType root() const {
@@ -55,6 +61,20 @@ class Guide {
     SwapUnitsBuf(&units_buf);
     return true;
   }
+  // Reads a guide from an input stream into huge pages. See HugePageBuffer
+  // for flags.
+  bool Read(std::istream *input, int huge_page_flags) {
+    HugePageBuffer huge_page_buf;
+    if (!huge_page_buf.Read(input, sizeof(GuideUnit), huge_page_flags)) {
+      return false;
+    }
+
+    Clear();
+    units_ = static_cast<const GuideUnit *>(huge_page_buf.address());
+    size_ = huge_page_buf.size() / sizeof(GuideUnit);
+    huge_page_buf_.Swap(&huge_page_buf);
+    return true;
+  }
 
   // Writes a dictionry to an output stream.
   bool Write(std::ostream *output) const {
@@ -90,6 +110,7 @@ class Guide {
     std::swap(units_, guide->units_);
     std::swap(size_, guide->size_);
     units_buf_.swap(guide->units_buf_);
+    huge_page_buf_.Swap(&guide->huge_page_buf_);
   }
 
   // Initializes a Guide.
@@ -97,6 +118,7 @@ class Guide {
     units_ = NULL;
     size_ = 0;
     std::vector<GuideUnit>(0).swap(units_buf_);
+    huge_page_buf_.Clear();
   }
 
  public:
@@ -107,12 +129,14 @@ class Guide {
     units_ = &(*units_buf)[0];
     size_ = static_cast<BaseType>(units_buf->size());
     units_buf_.swap(*units_buf);
+    huge_page_buf_.Clear();
   }
 
  private:
   const GuideUnit *units_;
   SizeType size_;
   std::vector<GuideUnit> units_buf_;
+  HugePageBuffer huge_page_buf_;
 
   // Disables copies.
   Guide(const Guide &);
@@ -0,0 +1,236 @@
+#ifndef DAWGDIC_HUGE_PAGE_BUFFER_H
+#define DAWGDIC_HUGE_PAGE_BUFFER_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif  // __linux__
+
+#include "base-types.h"
+
+namespace dawgdic {
+
+// Buffer for large arrays, which is allocated in huge pages if possible,
+// so that random accesses cause fewer TLB misses. Without huge pages, or
+// on other systems than Linux, a buffer is allocated in normal pages.
+class HugePageBuffer {
+ public:
+  // Flags for Allocate().
+  enum {
+    // Advises transparent huge pages (MADV_HUGEPAGE).
+    TRANSPARENT_HUGE_PAGES = 1 << 0,
+    // Allocates pages from the hugetlbfs pool (MAP_HUGETLB). If the pool
+    // is not available, transparent huge pages are used instead.
+    HUGETLB_PAGES = 1 << 1
+  };
+
+  enum {
+    // Size of a huge page on x86-64, to which a buffer is aligned.
+    HUGE_PAGE_SIZE = 2 << 20
+  };
+
+  HugePageBuffer()
+    : address_(NULL), size_(0), mapped_size_(0), is_hugetlb_(false) {}
+  ~HugePageBuffer() {
+    Clear();
+  }
+
+  void *address() const {
+    return address_;
+  }
+  SizeType size() const {
+    return size_;
+  }
+  // Checks if a buffer is allocated from the hugetlbfs pool.
+  bool is_hugetlb() const {
+    return is_hugetlb_;
+  }
+
+  // Number of bytes in huge pages, which are given by the kernel.
+  SizeType huge_page_bytes() const {
+    return CountHugePageBytes(address_, size_);
+  }
+
+  // Allocates a buffer. Its contents are undefined.
+  bool Allocate(SizeType size, int flags = TRANSPARENT_HUGE_PAGES) {
+    Clear();
+    if (size == 0) {
+      return true;
+    }
+
+#ifdef __linux__
+    SizeType mapped_size = (size + HUGE_PAGE_SIZE - 1) &
+        ~static_cast<SizeType>(HUGE_PAGE_SIZE - 1);
+
+#ifdef MAP_HUGETLB
+    if (flags & HUGETLB_PAGES) {
+      void *address = ::mmap(NULL, mapped_size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (address != MAP_FAILED) {
+        address_ = address;
+        size_ = size;
+        mapped_size_ = mapped_size;
+        is_hugetlb_ = true;
+        return true;
+      }
+    }
+#endif  // MAP_HUGETLB
+
+    // Maps an extra huge page to align the buffer to a huge page boundary,
+    // and then unmaps the unused head and tail.
+    char *address = static_cast<char *>(::mmap(
+        NULL, mapped_size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (address == MAP_FAILED) {
+      return false;
+    }
+    SizeType head_size = (HUGE_PAGE_SIZE - (reinterpret_cast<SizeType>(
+        address) & (HUGE_PAGE_SIZE - 1))) & (HUGE_PAGE_SIZE - 1);
+    if (head_size != 0) {
+      ::munmap(address, head_size);
+    }
+    ::munmap(address + head_size + mapped_size, HUGE_PAGE_SIZE - head_size);
+    address_ = address + head_size;
+    size_ = size;
+    mapped_size_ = mapped_size;
+
+#ifdef MADV_HUGEPAGE
+    // Advices are only hints, so their errors are ignored.
+    if (flags & (TRANSPARENT_HUGE_PAGES | HUGETLB_PAGES)) {
+      ::madvise(address_, mapped_size_, MADV_HUGEPAGE);
+    }
+#endif  // MADV_HUGEPAGE
+#else  // __linux__
+    static_cast<void>(flags);
+    address_ = std::malloc(size);
+    if (address_ == NULL) {
+      return false;
+    }
+    size_ = size;
+    mapped_size_ = size;
+#endif  // __linux__
+    return true;
+  }
+
+  // Reads an array of units, which is preceded by its number of units, into
+  // a buffer. The number of units is size() / unit_size.
+  bool Read(std::istream *input, SizeType unit_size,
+            int flags = TRANSPARENT_HUGE_PAGES) {
+    BaseType base_size;
+    if (!input->read(reinterpret_cast<char *>(&base_size),
+                     sizeof(BaseType))) {
+      return false;
+    }
+
+    SizeType size = unit_size * static_cast<SizeType>(base_size);
+    HugePageBuffer buf;
+    if (!buf.Allocate(size, flags) ||
+        !input->read(static_cast<char *>(buf.address()), size)) {
+      return false;
+    }
+    Swap(&buf);
+    return true;
+  }
+
+  // Frees a buffer.
+  void Clear() {
+    if (address_ != NULL) {
+#ifdef __linux__
+      ::munmap(address_, mapped_size_);
+#else  // __linux__
+      std::free(address_);
+#endif  // __linux__
+    }
+    address_ = NULL;
+    size_ = 0;
+    mapped_size_ = 0;
+    is_hugetlb_ = false;
+  }
+
+  // Swaps buffers.
+  void Swap(HugePageBuffer *buf) {
+    std::swap(address_, buf->address_);
+    std::swap(size_, buf->size_);
+    std::swap(mapped_size_, buf->mapped_size_);
+    std::swap(is_hugetlb_, buf->is_hugetlb_);
+  }
+
+  // Counts bytes in huge pages of memory mappings which overlap a range,
+  // such as units of a dictionary, by reading /proc/self/smaps. Returns 0
+  // on other systems than Linux.
+  static SizeType CountHugePageBytes(const void *address, SizeType size) {
+    if (address == NULL || size == 0) {
+      return 0;
+    }
+
+    std::FILE *smaps = std::fopen("/proc/self/smaps", "r");
+    if (smaps == NULL) {
+      return 0;
+    }
+
+    SizeType begin = reinterpret_cast<SizeType>(address);
+    SizeType end = begin + size;
+    bool overlaps = false;
+    SizeType num_of_kbytes = 0;
+    char line[256];
+    bool is_line_head = true;
+    while (std::fgets(line, sizeof(line), smaps) != NULL) {
+      // The rest of a long line is skipped.
+      bool is_head = is_line_head;
+      is_line_head = (std::strchr(line, '\n') != NULL);
+      if (!is_head) {
+        continue;
+      }
+
+      SizeType name_length = std::strcspn(line, " \t\n");
+      if (std::memchr(line, '-', name_length) != NULL) {
+        // A header line starts with the address range of a mapping.
+        char *name_rest = NULL;
+        SizeType map_begin = static_cast<SizeType>(
+            std::strtoul(line, &name_rest, 16));
+        SizeType map_end = static_cast<SizeType>(
+            std::strtoul(name_rest + 1, NULL, 16));
+        overlaps = map_begin < end && begin < map_end;
+      } else if (overlaps && IsHugePageField(line, name_length)) {
+        num_of_kbytes += static_cast<SizeType>(
+            std::strtoul(line + name_length, NULL, 10));
+      }
+    }
+    std::fclose(smaps);
+    return num_of_kbytes << 10;
+  }
+
+ private:
+  void *address_;
+  SizeType size_;
+  SizeType mapped_size_;
+  bool is_hugetlb_;
+
+  // Disallows copies.
+  HugePageBuffer(const HugePageBuffer &);
+  HugePageBuffer &operator=(const HugePageBuffer &);
+
+  // Fields of /proc/self/smaps which count huge pages.
+  static bool IsHugePageField(const char *name, SizeType length) {
+    static const char * const FIELDS[] = {
+      "AnonHugePages:", "ShmemPmdMapped:", "FilePmdMapped:",
+      "Shared_Hugetlb:", "Private_Hugetlb:"
+    };
+    for (SizeType i = 0; i < sizeof(FIELDS) / sizeof(FIELDS[0]); ++i) {
+      if (std::strlen(FIELDS[i]) == length &&
+          std::strncmp(name, FIELDS[i], length) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_HUGE_PAGE_BUFFER_H
@@ -0,0 +1,600 @@
+#ifndef DAWGDIC_LIVE_DICTIONARY_H
+#define DAWGDIC_LIVE_DICTIONARY_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "completer.h"
+#include "dawg-builder.h"
+#include "dictionary-builder.h"
+#include "guide-builder.h"
+#include "ranked-completer.h"
+#include "ranked-guide-builder.h"
+
+namespace dawgdic {
+
+// Updatable dictionary which consists of an immutable base dictionary and
+// a small delta of updates. Insertions and removals are written to the
+// delta, and lookups and completions consult the delta before the base.
+// Compact() merges the delta into a freshly built base, which is swapped
+// in at once, so that readers never see a partial update. Compaction runs
+// on the calling thread or periodically on a background thread.
+// All the member functions are thread-safe.
+class LiveDictionary {
+ public:
+  // Pair of a completed key and its value.
+  typedef std::pair<std::string, ValueType> ResultType;
+
+  // If has_ranked_guide is true, a base has a ranked guide, which is
+  // required by CompleteRanked().
+  explicit LiveDictionary(bool has_ranked_guide = false)
+    : has_ranked_guide_(has_ranked_guide), base_dic_(), base_guide_(),
+      base_ranked_guide_(), delta_(), frozen_delta_(),
+      num_of_compactions_(0), interval_in_msec_(0), has_thread_(false),
+      is_stopped_(false) {
+    ::pthread_rwlock_init(&rwlock_, NULL);
+    ::pthread_mutex_init(&compaction_mutex_, NULL);
+    ::pthread_mutex_init(&thread_mutex_, NULL);
+    ::pthread_cond_init(&thread_cond_, NULL);
+  }
+  ~LiveDictionary() {
+    StopCompaction();
+    ::pthread_cond_destroy(&thread_cond_);
+    ::pthread_mutex_destroy(&thread_mutex_);
+    ::pthread_mutex_destroy(&compaction_mutex_);
+    ::pthread_rwlock_destroy(&rwlock_);
+  }
+
+  bool has_ranked_guide() const {
+    return has_ranked_guide_;
+  }
+  // Number of updates which are not yet merged into a base.
+  SizeType num_of_updates() const {
+    ReadLock lock(&rwlock_);
+    return delta_.size() + frozen_delta_.size();
+  }
+  // Number of compactions which have replaced a base.
+  SizeType num_of_compactions() const {
+    ReadLock lock(&rwlock_);
+    return num_of_compactions_;
+  }
+
+  // Replaces a base with a dictionary built from a dawg, and discards
+  // updates.
+  bool Build(const Dawg &dawg) {
+    MutexLock compaction_lock(&compaction_mutex_);
+    Dictionary dic;
+    Guide guide;
+    RankedGuide ranked_guide;
+    if (!BuildBase(dawg, &dic, &guide, &ranked_guide)) {
+      return false;
+    }
+
+    WriteLock lock(&rwlock_);
+    SwapBase(&dic, &guide, &ranked_guide);
+    delta_.clear();
+    frozen_delta_.clear();
+    return true;
+  }
+
+  // Inserts a key or updates its value.
+  bool Insert(const CharType *key, ValueType value = 0) {
+    if (key == NULL) {
+      return false;
+    }
+    return Insert(key, std::strlen(key), value);
+  }
+  bool Insert(const CharType *key, SizeType length, ValueType value) {
+    if (!IsValidKey(key, length) || value < 0) {
+      return false;
+    }
+    WriteLock lock(&rwlock_);
+    delta_[std::string(key, length)] = value;
+    return true;
+  }
+
+  // Removes a key. Fails if there is no such key.
+  bool Remove(const CharType *key) {
+    if (key == NULL) {
+      return false;
+    }
+    return Remove(key, std::strlen(key));
+  }
+  bool Remove(const CharType *key, SizeType length) {
+    if (!IsValidKey(key, length)) {
+      return false;
+    }
+    std::string key_str(key, length);
+    WriteLock lock(&rwlock_);
+    ValueType value;
+    if (!FindKey(key_str, &value)) {
+      return false;
+    }
+    delta_[key_str] = DELETED_VALUE;
+    return true;
+  }
+
+  // Exact matching.
+  bool Contains(const CharType *key) const {
+    ValueType value;
+    return Find(key, &value);
+  }
+  bool Contains(const CharType *key, SizeType length) const {
+    ValueType value;
+    return Find(key, length, &value);
+  }
+
+  // Exact matching.
+  bool Find(const CharType *key, ValueType *value) const {
+    if (key == NULL) {
+      return false;
+    }
+    return Find(key, std::strlen(key), value);
+  }
+  bool Find(const CharType *key, SizeType length, ValueType *value) const {
+    if (!IsValidKey(key, length)) {
+      return false;
+    }
+    std::string key_str(key, length);
+    ReadLock lock(&rwlock_);
+    return FindKey(key_str, value);
+  }
+
+  // Completes keys in lexicographic order. At most max_num_of_results
+  // keys are written, and their number is returned.
+  SizeType Complete(const CharType *prefix, SizeType max_num_of_results,
+                    std::vector<ResultType> *results) const {
+    results->clear();
+    std::string prefix_str(prefix);
+    ReadLock lock(&rwlock_);
+
+    std::vector<ResultType> updates;
+    CollectUpdates(prefix_str, &updates);
+
+    Completer completer(base_dic_, base_guide_);
+    bool has_base = StartBase(prefix_str, &completer) && completer.Next();
+    SizeType update_id = 0;
+    while (results->size() < max_num_of_results) {
+      bool has_update = update_id < updates.size();
+      if (!has_base && !has_update) {
+        break;
+      }
+
+      if (has_update) {
+        const std::string &update_key = updates[update_id].first;
+        std::string base_key;
+        if (has_base) {
+          base_key.assign(completer.key(), completer.length());
+        }
+        if (!has_base || !KeyComparer()(base_key, update_key)) {
+          if (has_base && base_key == update_key) {
+            has_base = completer.Next();
+          }
+          if (updates[update_id].second != DELETED_VALUE) {
+            results->push_back(updates[update_id]);
+          }
+          ++update_id;
+          continue;
+        }
+      }
+      results->push_back(ResultType(
+          std::string(completer.key(), completer.length()),
+          completer.value()));
+      has_base = completer.Next();
+    }
+    return results->size();
+  }
+
+  // Completes keys in descending order of values. At most
+  // max_num_of_results keys are written. Fails if a base has no ranked
+  // guide.
+  bool CompleteRanked(const CharType *prefix, SizeType max_num_of_results,
+                      std::vector<ResultType> *results) const {
+    results->clear();
+    if (!has_ranked_guide_) {
+      return false;
+    }
+    std::string prefix_str(prefix);
+    ReadLock lock(&rwlock_);
+
+    std::vector<ResultType> all_updates;
+    CollectUpdates(prefix_str, &all_updates);
+    std::vector<ResultType> updates;
+    for (SizeType i = 0; i < all_updates.size(); ++i) {
+      if (all_updates[i].second != DELETED_VALUE) {
+        updates.push_back(all_updates[i]);
+      }
+    }
+    std::stable_sort(updates.begin(), updates.end(), ValueComparer());
+
+    RankedCompleter completer(base_dic_, base_ranked_guide_);
+    bool has_base = StartBase(prefix_str, &completer) &&
+        NextBase(&completer);
+    SizeType update_id = 0;
+    while (results->size() < max_num_of_results) {
+      bool has_update = update_id < updates.size();
+      if (!has_base && !has_update) {
+        break;
+      }
+
+      if (has_update &&
+          (!has_base || completer.value() < updates[update_id].second)) {
+        results->push_back(updates[update_id++]);
+      } else {
+        results->push_back(ResultType(
+            std::string(completer.key(), completer.length()),
+            completer.value()));
+        has_base = NextBase(&completer);
+      }
+    }
+    return true;
+  }
+
+  // Merges updates into a new base, and swaps it in. Updates which are
+  // made while merging are kept for the next compaction.
+  bool Compact() {
+    MutexLock compaction_lock(&compaction_mutex_);
+    {
+      WriteLock lock(&rwlock_);
+      if (delta_.empty()) {
+        return true;
+      }
+      frozen_delta_.swap(delta_);
+    }
+
+    // The base and the frozen delta are not modified by other threads.
+    Dictionary dic;
+    Guide guide;
+    RankedGuide ranked_guide;
+    bool is_built = BuildBase(&dic, &guide, &ranked_guide);
+
+    WriteLock lock(&rwlock_);
+    if (!is_built) {
+      // Gives back updates which are not overwritten.
+      for (DeltaType::const_iterator it = frozen_delta_.begin();
+           it != frozen_delta_.end(); ++it) {
+        delta_.insert(*it);
+      }
+      frozen_delta_.clear();
+      return false;
+    }
+    SwapBase(&dic, &guide, &ranked_guide);
+    frozen_delta_.clear();
+    ++num_of_compactions_;
+    return true;
+  }
+
+  // Starts a background thread which compacts a dictionary at intervals.
+  // Fails if the thread is already running.
+  bool StartCompaction(SizeType interval_in_msec) {
+    MutexLock lock(&thread_mutex_);
+    if (has_thread_) {
+      return false;
+    }
+    interval_in_msec_ = interval_in_msec;
+    is_stopped_ = false;
+    if (::pthread_create(&thread_, NULL, &LiveDictionary::Run, this) != 0) {
+      return false;
+    }
+    has_thread_ = true;
+    return true;
+  }
+
+  // Stops a background thread, and waits for its current compaction.
+  void StopCompaction() {
+    {
+      MutexLock lock(&thread_mutex_);
+      if (!has_thread_) {
+        return;
+      }
+      is_stopped_ = true;
+      ::pthread_cond_signal(&thread_cond_);
+    }
+    ::pthread_join(thread_, NULL);
+
+    MutexLock lock(&thread_mutex_);
+    has_thread_ = false;
+  }
+
+ private:
+  // Compares keys as strings of unsigned labels, which is the order of
+  // keys in a dawg.
+  class KeyComparer {
+   public:
+    bool operator()(const std::string &lhs, const std::string &rhs) const {
+      SizeType length = std::min(lhs.length(), rhs.length());
+      int result = std::memcmp(lhs.data(), rhs.data(), length);
+      if (result != 0) {
+        return result < 0;
+      }
+      return lhs.length() < rhs.length();
+    }
+  };
+
+  // For sorting results in descending order of values.
+  class ValueComparer {
+   public:
+    bool operator()(const ResultType &lhs, const ResultType &rhs) const {
+      return lhs.second > rhs.second;
+    }
+  };
+
+  // Locks a mutex in a scope.
+  class MutexLock {
+   public:
+    explicit MutexLock(pthread_mutex_t *mutex) : mutex_(mutex) {
+      ::pthread_mutex_lock(mutex_);
+    }
+    ~MutexLock() {
+      ::pthread_mutex_unlock(mutex_);
+    }
+
+   private:
+    pthread_mutex_t *mutex_;
+
+    // Disallows copies.
+    MutexLock(const MutexLock &);
+    MutexLock &operator=(const MutexLock &);
+  };
+
+  // Locks a rwlock for reading in a scope.
+  class ReadLock {
+   public:
+    explicit ReadLock(pthread_rwlock_t *rwlock) : rwlock_(rwlock) {
+      ::pthread_rwlock_rdlock(rwlock_);
+    }
+    ~ReadLock() {
+      ::pthread_rwlock_unlock(rwlock_);
+    }
+
+   private:
+    pthread_rwlock_t *rwlock_;
+
+    // Disallows copies.
+    ReadLock(const ReadLock &);
+    ReadLock &operator=(const ReadLock &);
+  };
+
+  // Locks a rwlock for writing in a scope.
+  class WriteLock {
+   public:
+    explicit WriteLock(pthread_rwlock_t *rwlock) : rwlock_(rwlock) {
+      ::pthread_rwlock_wrlock(rwlock_);
+    }
+    ~WriteLock() {
+      ::pthread_rwlock_unlock(rwlock_);
+    }
+
+   private:
+    pthread_rwlock_t *rwlock_;
+
+    // Disallows copies.
+    WriteLock(const WriteLock &);
+    WriteLock &operator=(const WriteLock &);
+  };
+
+  // Delta of updates, in which a removed key has DELETED_VALUE.
+  typedef std::map<std::string, ValueType, KeyComparer> DeltaType;
+
+  enum {
+    DELETED_VALUE = -1
+  };
+
+  const bool has_ranked_guide_;
+  Dictionary base_dic_;
+  Guide base_guide_;
+  RankedGuide base_ranked_guide_;
+  // Updates are written to delta_. While compacting, updates to be merged
+  // are moved to frozen_delta_, and delta_ takes priority over it.
+  DeltaType delta_;
+  DeltaType frozen_delta_;
+  SizeType num_of_compactions_;
+
+  SizeType interval_in_msec_;
+  bool has_thread_;
+  bool is_stopped_;
+  pthread_t thread_;
+
+  // rwlock_ guards a base and deltas. compaction_mutex_ serializes
+  // compactions, and thread_mutex_ guards a background thread.
+  mutable pthread_rwlock_t rwlock_;
+  pthread_mutex_t compaction_mutex_;
+  pthread_mutex_t thread_mutex_;
+  pthread_cond_t thread_cond_;
+
+  // Disallows copies.
+  LiveDictionary(const LiveDictionary &);
+  LiveDictionary &operator=(const LiveDictionary &);
+
+  // Checks if a key is not empty and has no null character.
+  static bool IsValidKey(const CharType *key, SizeType length) {
+    if (key == NULL || length == 0) {
+      return false;
+    }
+    for (SizeType i = 0; i < length; ++i) {
+      if (key[i] == '\0') {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Finds a key in deltas and then in a base. rwlock_ must be locked.
+  bool FindKey(const std::string &key, ValueType *value) const {
+    DeltaType::const_iterator it = delta_.find(key);
+    if (it == delta_.end()) {
+      it = frozen_delta_.find(key);
+      if (it == frozen_delta_.end()) {
+        return base_dic_.size() != 0 &&
+            base_dic_.Find(key.data(), key.length(), value);
+      }
+    }
+    if (it->second == DELETED_VALUE) {
+      return false;
+    }
+    *value = it->second;
+    return true;
+  }
+
+  // Checks if a key is updated. rwlock_ must be locked.
+  bool IsUpdated(const std::string &key) const {
+    return delta_.find(key) != delta_.end() ||
+        frozen_delta_.find(key) != frozen_delta_.end();
+  }
+
+  // Collects updates of keys which start with a prefix in lexicographic
+  // order. rwlock_ must be locked.
+  void CollectUpdates(const std::string &prefix,
+                      std::vector<ResultType> *updates) const {
+    DeltaType::const_iterator it = delta_.lower_bound(prefix);
+    DeltaType::const_iterator frozen_it = frozen_delta_.lower_bound(prefix);
+    for ( ; ; ) {
+      bool has_update = it != delta_.end() &&
+          it->first.compare(0, prefix.length(), prefix) == 0;
+      bool has_frozen_update = frozen_it != frozen_delta_.end() &&
+          frozen_it->first.compare(0, prefix.length(), prefix) == 0;
+      if (!has_update && !has_frozen_update) {
+        break;
+      }
+
+      if (has_update && (!has_frozen_update ||
+          !KeyComparer()(frozen_it->first, it->first))) {
+        if (has_frozen_update && frozen_it->first == it->first) {
+          ++frozen_it;
+        }
+        updates->push_back(*it++);
+      } else {
+        updates->push_back(*frozen_it++);
+      }
+    }
+  }
+
+  // Starts a completer of a base from a prefix. rwlock_ must be locked.
+  template <typename COMPLETER_TYPE>
+  bool StartBase(const std::string &prefix, COMPLETER_TYPE *completer) const {
+    if (base_dic_.size() == 0) {
+      return false;
+    }
+    BaseType index = base_dic_.root();
+    if (!base_dic_.Follow(prefix.data(), prefix.length(), &index)) {
+      return false;
+    }
+    completer->Start(index, prefix.data(), prefix.length());
+    return true;
+  }
+
+  // Gets the next key of a base which is not updated. rwlock_ must be
+  // locked.
+  bool NextBase(RankedCompleter *completer) const {
+    while (completer->Next()) {
+      if (!IsUpdated(std::string(completer->key(), completer->length()))) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Builds a base from the current base and the frozen delta.
+  bool BuildBase(Dictionary *dic, Guide *guide, RankedGuide *ranked_guide) {
+    DawgBuilder dawg_builder;
+    Completer completer(base_dic_, base_guide_);
+    bool has_base = StartBase(std::string(), &completer) && completer.Next();
+    DeltaType::const_iterator it = frozen_delta_.begin();
+    for ( ; ; ) {
+      bool has_update = it != frozen_delta_.end();
+      if (!has_base && !has_update) {
+        break;
+      }
+
+      if (has_update) {
+        std::string base_key;
+        if (has_base) {
+          base_key.assign(completer.key(), completer.length());
+        }
+        if (!has_base || !KeyComparer()(base_key, it->first)) {
+          if (has_base && base_key == it->first) {
+            has_base = completer.Next();
+          }
+          if (it->second != DELETED_VALUE &&
+              !dawg_builder.Insert(it->first.data(), it->first.length(),
+                                   it->second)) {
+            return false;
+          }
+          ++it;
+          continue;
+        }
+      }
+      if (!dawg_builder.Insert(completer.key(), completer.length(),
+                               completer.value())) {
+        return false;
+      }
+      has_base = completer.Next();
+    }
+
+    Dawg dawg;
+    if (!dawg_builder.Finish(&dawg)) {
+      return false;
+    }
+    return BuildBase(dawg, dic, guide, ranked_guide);
+  }
+
+  // Builds a base from a dawg.
+  bool BuildBase(const Dawg &dawg, Dictionary *dic, Guide *guide,
+                 RankedGuide *ranked_guide) const {
+    if (!DictionaryBuilder::Build(dawg, dic) ||
+        !GuideBuilder::Build(dawg, *dic, guide)) {
+      return false;
+    }
+    return !has_ranked_guide_ ||
+        RankedGuideBuilder::Build(dawg, *dic, ranked_guide);
+  }
+
+  // Swaps a base. rwlock_ must be locked for writing.
+  void SwapBase(Dictionary *dic, Guide *guide, RankedGuide *ranked_guide) {
+    base_dic_.Swap(dic);
+    base_guide_.Swap(guide);
+    base_ranked_guide_.Swap(ranked_guide);
+  }
+
+  static void *Run(void *dic) {
+    static_cast<LiveDictionary *>(dic)->Work();
+    return NULL;
+  }
+
+  // Compacts a dictionary at intervals until stopped.
+  void Work() {
+    MutexLock lock(&thread_mutex_);
+    while (!is_stopped_) {
+      struct timeval now;
+      ::gettimeofday(&now, NULL);
+      UInt64Type usec = static_cast<UInt64Type>(now.tv_usec) +
+          static_cast<UInt64Type>(interval_in_msec_) * 1000;
+      struct timespec deadline;
+      deadline.tv_sec = now.tv_sec + static_cast<time_t>(usec / 1000000);
+      deadline.tv_nsec = static_cast<long>(usec % 1000000) * 1000;
+      while (!is_stopped_ && ::pthread_cond_timedwait(
+          &thread_cond_, &thread_mutex_, &deadline) != ETIMEDOUT) {
+        continue;
+      }
+      if (is_stopped_) {
+        break;
+      }
+
+      ::pthread_mutex_unlock(&thread_mutex_);
+      Compact();
+      ::pthread_mutex_lock(&thread_mutex_);
+    }
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_LIVE_DICTIONARY_H
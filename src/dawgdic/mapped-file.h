@@ -0,0 +1,139 @@
+#ifndef DAWGDIC_MAPPED_FILE_H
+#define DAWGDIC_MAPPED_FILE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base-types.h"
+#include "huge-page-buffer.h"
+
+namespace dawgdic {
+
+// Read-only memory mapping of a whole file (POSIX only).
+class MappedFile {
+ public:
+  // Flags for Open().
+  enum {
+    // Reads all pages in advance (MAP_POPULATE).
+    POPULATE = 1 << 0,
+    // Starts reading pages in the background (MADV_WILLNEED).
+    WILL_NEED = 1 << 1,
+    // Disables read-ahead for random lookups (MADV_RANDOM).
+    RANDOM_ACCESS = 1 << 2,
+    // Locks pages in memory (mlock).
+    LOCK = 1 << 3,
+    // Asks for transparent huge pages (MADV_HUGEPAGE). The kernel may give
+    // huge pages to a read-only file mapping if it supports them.
+    HUGE_PAGES = 1 << 4
+  };
+
+  MappedFile() : address_(NULL), size_(0), is_locked_(false) {}
+  ~MappedFile() {
+    Close();
+  }
+
+  const void *address() const {
+    return address_;
+  }
+  SizeType size() const {
+    return size_;
+  }
+  bool is_open() const {
+    return address_ != NULL;
+  }
+  // Checks if pages are locked. mlock() may fail because of RLIMIT_MEMLOCK,
+  // and Open() does not fail in that case.
+  bool is_locked() const {
+    return is_locked_;
+  }
+  // Number of bytes in huge pages, which are given by the kernel.
+  SizeType huge_page_bytes() const {
+    return HugePageBuffer::CountHugePageBytes(address_, size_);
+  }
+
+  // Maps a file into memory.
+  bool Open(const char *file_name, int flags = 0) {
+    Close();
+
+    int fd = ::open(file_name, O_RDONLY);
+    if (fd == -1) {
+      return false;
+    }
+
+    struct stat file_stat;
+    if (::fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+      ::close(fd);
+      return false;
+    }
+    SizeType size = static_cast<SizeType>(file_stat.st_size);
+
+    int map_flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    if (flags & POPULATE) {
+      map_flags |= MAP_POPULATE;
+    }
+#endif  // MAP_POPULATE
+
+    void *address = ::mmap(NULL, size, PROT_READ, map_flags, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+      return false;
+    }
+    address_ = address;
+    size_ = size;
+
+    // Advices are only hints, so their errors are ignored.
+    if (flags & WILL_NEED) {
+      ::madvise(address_, size_, MADV_WILLNEED);
+    }
+    if (flags & RANDOM_ACCESS) {
+      ::madvise(address_, size_, MADV_RANDOM);
+    }
+#ifdef MADV_HUGEPAGE
+    if (flags & HUGE_PAGES) {
+      ::madvise(address_, size_, MADV_HUGEPAGE);
+    }
+#endif  // MADV_HUGEPAGE
+    if (flags & LOCK) {
+      is_locked_ = (::mlock(address_, size_) == 0);
+    }
+    return true;
+  }
+
+  // Unmaps a file.
+  void Close() {
+    if (address_ != NULL) {
+      if (is_locked_) {
+        ::munlock(address_, size_);
+      }
+      ::munmap(address_, size_);
+    }
+    address_ = NULL;
+    size_ = 0;
+    is_locked_ = false;
+  }
+
+  // Swaps mapped files.
+  void Swap(MappedFile *file) {
+    std::swap(address_, file->address_);
+    std::swap(size_, file->size_);
+    std::swap(is_locked_, file->is_locked_);
+  }
+
+ private:
+  void *address_;
+  SizeType size_;
+  bool is_locked_;
+
+  // Disallows copies.
+  MappedFile(const MappedFile &);
+  MappedFile &operator=(const MappedFile &);
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_MAPPED_FILE_H
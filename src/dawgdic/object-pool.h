@@ -1,67 +1,141 @@
 #ifndef DAWGDIC_OBJECT_POOL_H
 #define DAWGDIC_OBJECT_POOL_H
 
+#include <algorithm>
+#include <new>
 #include <vector>
 
 #include "base-types.h"
+#include "block-allocator.h"
 
 namespace dawgdic {
 
 // This class works like an array of objects with compact memory management.
+// Blocks of objects are taken from an allocator, and BLOCK_SIZE is the
+// default number of objects per block, which is rounded up to a power of 2.
 template <typename OBJECT_TYPE, SizeType BLOCK_SIZE = 1 << 10>
 class ObjectPool {
  public:
   typedef OBJECT_TYPE ObjectType;
 
-  ObjectPool() : blocks_(), size_(0) {}
+  explicit ObjectPool(BlockAllocator *allocator = NULL,
+                      SizeType block_size = BLOCK_SIZE)
+    : allocator_((allocator != NULL) ? allocator : BlockAllocator::Default()),
+      block_shift_(0), blocks_(), size_(0), is_mapped_(false) {
+    while ((static_cast<SizeType>(1) << block_shift_) < block_size) {
+      ++block_shift_;
+    }
+  }
   ~ObjectPool() {
     Clear();
   }
 
   // Accessors.
   ObjectType &operator[](SizeType index) {
-    return blocks_[index / BLOCK_SIZE][index % BLOCK_SIZE];
+    return blocks_[index >> block_shift_][index & block_mask()];
   }
   const ObjectType &operator[](SizeType index) const {
-    return blocks_[index / BLOCK_SIZE][index % BLOCK_SIZE];
+    return blocks_[index >> block_shift_][index & block_mask()];
   }
 
+  BlockAllocator *allocator() const {
+    return allocator_;
+  }
+  // Number of objects per block.
+  SizeType block_size() const {
+    return static_cast<SizeType>(1) << block_shift_;
+  }
   // Number of allocated objects.
   SizeType size() const {
     return size_;
   }
+  // Number of objects which are allocated without a new block.
+  SizeType capacity() const {
+    return is_mapped_ ? size_ : block_size() * blocks_.size();
+  }
+  // Number of bytes allocated for objects. A mapped pool uses no memory.
+  SizeType memory_usage() const {
+    if (is_mapped_) {
+      return sizeof(ObjectType *) * blocks_.capacity();
+    }
+    return sizeof(ObjectType) * capacity() +
+        sizeof(ObjectType *) * blocks_.capacity();
+  }
 
-  // Deletes all objects and frees memory.
+  // Deletes all objects and returns blocks to an allocator.
   void Clear() {
-    for (SizeType i = 0; i < blocks_.size(); ++i) {
-      delete [] blocks_[i];
+    Reset();
+    if (!is_mapped_) {
+      for (SizeType i = 0; i < blocks_.size(); ++i) {
+        allocator_->Free(blocks_[i], block_bytes());
+      }
     }
 
     std::vector<ObjectType *>(0).swap(blocks_);
+    is_mapped_ = false;
+  }
+
+  // Deletes all objects, but keeps blocks for new objects. A mapped pool
+  // is cleared.
+  void Reset() {
+    if (is_mapped_) {
+      std::vector<ObjectType *>(0).swap(blocks_);
+      is_mapped_ = false;
+    } else {
+      for (SizeType i = 0; i < size_; ++i) {
+        (*this)[i].~ObjectType();
+      }
+    }
     size_ = 0;
   }
 
   // Swaps object pools.
   void Swap(ObjectPool *pool) {
+    std::swap(allocator_, pool->allocator_);
+    std::swap(block_shift_, pool->block_shift_);
     blocks_.swap(pool->blocks_);
     std::swap(size_, pool->size_);
+    std::swap(is_mapped_, pool->is_mapped_);
+  }
+
+  // Maps an array of objects as a read-only pool. The array must be alive
+  // while the pool is used, and no object can be allocated.
+  void Map(const ObjectType *objects, SizeType size) {
+    Clear();
+    for (SizeType i = 0; i < size; i += block_size()) {
+      blocks_.push_back(const_cast<ObjectType *>(objects + i));
+    }
+    size_ = size;
+    is_mapped_ = true;
   }
 
   // Allocates memory for a new object and returns its ID.
   SizeType Allocate() {
-    if (size_ == BLOCK_SIZE * blocks_.size()) {
-      blocks_.push_back(new ObjectType[BLOCK_SIZE]);
+    if (size_ == capacity()) {
+      blocks_.push_back(static_cast<ObjectType *>(
+          allocator_->Allocate(block_bytes())));
     }
+    new (&(*this)[size_]) ObjectType();
     return size_++;
   }
 
  private:
+  BlockAllocator *allocator_;
+  SizeType block_shift_;
   std::vector<ObjectType *> blocks_;
   SizeType size_;
+  bool is_mapped_;
 
   // Disallows copies.
   ObjectPool(const ObjectPool &);
   ObjectPool &operator=(const ObjectPool &);
+
+  SizeType block_mask() const {
+    return block_size() - 1;
+  }
+  SizeType block_bytes() const {
+    return sizeof(ObjectType) * block_size();
+  }
 };
 
 }  // namespace dawgdic
@@ -0,0 +1,126 @@
+#ifndef DAWGDIC_ORDINAL_MAPPER_H
+#define DAWGDIC_ORDINAL_MAPPER_H
+
+#include "dictionary.h"
+#include "ordinal-table.h"
+
+#include <vector>
+
+namespace dawgdic {
+
+// Maps keys to their ordinals and back, so that payloads of keys can be
+// kept in arrays outside a dictionary. Both directions take time linear
+// in the length of a key.
+class OrdinalMapper {
+ public:
+  OrdinalMapper() : dic_(NULL), table_(NULL), key_(1, '\0') {}
+  OrdinalMapper(const Dictionary &dic, const OrdinalTable &table)
+    : dic_(&dic), table_(&table), key_(1, '\0') {}
+
+  void set_dic(const Dictionary &dic) {
+    dic_ = &dic;
+  }
+  void set_table(const OrdinalTable &table) {
+    table_ = &table;
+  }
+
+  const Dictionary &dic() const {
+    return *dic_;
+  }
+  const OrdinalTable &table() const {
+    return *table_;
+  }
+
+  // These member functions are available only when Select() returns true.
+  const char *key() const {
+    return &key_[0];
+  }
+  SizeType length() const {
+    return key_.size() - 1;
+  }
+
+  // Gets the ordinal of a key.
+  bool Rank(const CharType *key, BaseType *id) const {
+    BaseType index = dic_->root();
+    BaseType ordinal = 0;
+    for ( ; *key != '\0'; ++key) {
+      if (!dic_->Follow(*key, &index)) {
+        return false;
+      }
+      ordinal += table_->count(index);
+    }
+    if (!dic_->has_value(index)) {
+      return false;
+    }
+    *id = ordinal;
+    return true;
+  }
+  bool Rank(const CharType *key, SizeType length, BaseType *id) const {
+    BaseType index = dic_->root();
+    BaseType ordinal = 0;
+    for (SizeType i = 0; i < length; ++i) {
+      if (!dic_->Follow(key[i], &index)) {
+        return false;
+      }
+      ordinal += table_->count(index);
+    }
+    if (!dic_->has_value(index)) {
+      return false;
+    }
+    *id = ordinal;
+    return true;
+  }
+
+  // Restores a key from its ordinal. In each state, labels are probed in
+  // ascending order to find the last transition whose count is not
+  // greater than the rest of the ordinal.
+  bool Select(BaseType id) {
+    key_.resize(1);
+    key_[0] = '\0';
+    if (id >= table_->num_of_keys()) {
+      return false;
+    }
+
+    BaseType index = dic_->root();
+    for ( ; ; ) {
+      if (id == 0 && dic_->has_value(index)) {
+        break;
+      }
+
+      BaseType next_index = 0;
+      UCharType next_label = '\0';
+      for (BaseType label = 1; label <= 0xFF; ++label) {
+        BaseType child_index = index;
+        if (!dic_->Follow(static_cast<CharType>(label), &child_index)) {
+          continue;
+        } else if (table_->count(child_index) > id) {
+          break;
+        }
+        next_index = child_index;
+        next_label = static_cast<UCharType>(label);
+      }
+      if (next_label == '\0') {
+        return false;
+      }
+
+      id -= table_->count(next_index);
+      key_.back() = static_cast<char>(next_label);
+      key_.push_back('\0');
+      index = next_index;
+    }
+    return true;
+  }
+
+ private:
+  const Dictionary *dic_;
+  const OrdinalTable *table_;
+  std::vector<char> key_;
+
+  // Disallows copies.
+  OrdinalMapper(const OrdinalMapper &);
+  OrdinalMapper &operator=(const OrdinalMapper &);
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_ORDINAL_MAPPER_H
@@ -0,0 +1,176 @@
+#ifndef DAWGDIC_ORDINAL_TABLE_BUILDER_H
+#define DAWGDIC_ORDINAL_TABLE_BUILDER_H
+
+#include "build-progress.h"
+#include "dawg.h"
+#include "dictionary.h"
+#include "ordinal-table.h"
+
+#include <vector>
+
+namespace dawgdic {
+
+class OrdinalTableBuilder {
+ public:
+  // Builds a table for mapping keys to their ordinals. Values of a dawg
+  // are not used, so a dawg with the same value for all the keys merges
+  // more states and gives a smaller dictionary.
+  // If a progress is given, it is updated while building.
+  static bool Build(const Dawg &dawg, const Dictionary &dic,
+                    OrdinalTable *table, BuildProgress *progress = NULL) {
+    OrdinalTableBuilder builder(dawg, dic, table, progress);
+    return builder.BuildTable();
+  }
+
+ private:
+  enum {
+    // Number of frames allocated to a stack in advance.
+    INITIAL_STACK_SIZE = 1 << 10
+  };
+
+  // Frame of a stack for building a table depth-first, which keeps the
+  // current child of a state and the number of keys before the child.
+  class Frame {
+   public:
+    Frame(BaseType dawg_child_index, BaseType dic_index)
+      : dawg_child_index_(dawg_child_index), dic_index_(dic_index),
+        count_(0) {}
+
+    void set_dawg_child_index(BaseType dawg_child_index) {
+      dawg_child_index_ = dawg_child_index;
+    }
+    void set_count(BaseType count) {
+      count_ = count;
+    }
+
+    BaseType dawg_child_index() const {
+      return dawg_child_index_;
+    }
+    BaseType dic_index() const {
+      return dic_index_;
+    }
+    BaseType count() const {
+      return count_;
+    }
+
+   private:
+    BaseType dawg_child_index_;
+    BaseType dic_index_;
+    BaseType count_;
+
+    // Copyable.
+  };
+
+  const Dawg &dawg_;
+  const Dictionary &dic_;
+  OrdinalTable *table_;
+  BuildProgress *progress_;
+
+  std::vector<BaseType> units_;
+  // Numbers of keys under states, which are 0 until states are visited.
+  std::vector<BaseType> num_of_keys_table_;
+  std::vector<Frame> frames_;
+
+  // Disallows copies.
+  OrdinalTableBuilder(const OrdinalTableBuilder &);
+  OrdinalTableBuilder &operator=(const OrdinalTableBuilder &);
+
+  OrdinalTableBuilder(const Dawg &dawg, const Dictionary &dic,
+                      OrdinalTable *table, BuildProgress *progress)
+    : dawg_(dawg), dic_(dic), table_(table), progress_(progress),
+      units_(), num_of_keys_table_(), frames_() {}
+
+  bool BuildTable() {
+    // Initializes units and counts.
+    units_.resize(dic_.size());
+    num_of_keys_table_.resize(dic_.size());
+    if (progress_ != NULL) {
+      progress_->Start(dawg_.num_of_states());
+    }
+
+    if (dawg_.size() <= 1) {
+      return true;
+    }
+
+    BaseType num_of_keys = 0;
+    if (!BuildTable(dawg_.root(), dic_.root(), &num_of_keys)) {
+      return false;
+    }
+    units_[dic_.root()] = num_of_keys;
+
+    std::vector<BaseType>(0).swap(num_of_keys_table_);
+    table_->SwapUnitsBuf(&units_);
+    return true;
+  }
+
+  // Builds a table depth-first, and returns the number of keys under a
+  // state. States are visited once because a merged state has only one
+  // set of transitions in a dictionary. A stack of frames is used instead
+  // of recursion, so the depth is not limited by the stack size of a
+  // thread.
+  bool BuildTable(BaseType dawg_index, BaseType dic_index,
+                  BaseType *num_of_keys) {
+    if (num_of_keys_table_[dic_index] != 0) {
+      *num_of_keys = num_of_keys_table_[dic_index];
+      return true;
+    }
+    frames_.reserve(INITIAL_STACK_SIZE);
+    frames_.clear();
+    VisitState(dawg_index, dic_index);
+
+    // Transitions are sorted in ascending order of labels, and a key which
+    // ends at a state is less than the others.
+    for ( ; ; ) {
+      BaseType dawg_child_index = frames_.back().dawg_child_index();
+      if (dawg_child_index == 0) {
+        BaseType count = frames_.back().count();
+        num_of_keys_table_[frames_.back().dic_index()] = count;
+        frames_.pop_back();
+        if (frames_.empty()) {
+          *num_of_keys = count;
+          return true;
+        }
+        AddKeys(count);
+        continue;
+      }
+
+      UCharType child_label = dawg_.label(dawg_child_index);
+      if (child_label == '\0') {
+        AddKeys(1);
+        continue;
+      }
+
+      BaseType dic_child_index = frames_.back().dic_index();
+      if (!dic_.Follow(child_label, &dic_child_index)) {
+        return false;
+      }
+      units_[dic_child_index] = frames_.back().count();
+
+      if (num_of_keys_table_[dic_child_index] != 0) {
+        AddKeys(num_of_keys_table_[dic_child_index]);
+      } else {
+        VisitState(dawg_child_index, dic_child_index);
+      }
+    }
+  }
+
+  // Visits a state, and pushes a frame for counting its keys.
+  void VisitState(BaseType dawg_index, BaseType dic_index) {
+    if (progress_ != NULL) {
+      progress_->Visit(frames_.size());
+    }
+    frames_.push_back(Frame(dawg_.child(dawg_index), dic_index));
+  }
+
+  // Adds keys under the current child of the top state, and moves to the
+  // next child.
+  void AddKeys(BaseType num_of_keys) {
+    BaseType dawg_child_index = frames_.back().dawg_child_index();
+    frames_.back().set_count(frames_.back().count() + num_of_keys);
+    frames_.back().set_dawg_child_index(dawg_.sibling(dawg_child_index));
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_ORDINAL_TABLE_BUILDER_H
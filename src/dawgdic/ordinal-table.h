@@ -0,0 +1,124 @@
+#ifndef DAWGDIC_ORDINAL_TABLE_H
+#define DAWGDIC_ORDINAL_TABLE_H
+
+#include "base-types.h"
+
+#include <iostream>
+#include <vector>
+
+namespace dawgdic {
+
+// Side array of a dictionary for mapping keys to their ordinals, which are
+// dense ids in [0, num_of_keys()) in lexicographic order. A unit at the
+// index of a transition has the number of keys which are reached from the
+// source state and are less than keys through the transition. The root
+// unit has the number of keys.
+class OrdinalTable {
+ public:
+  OrdinalTable() : units_(NULL), size_(0), units_buf_() {}
+
+  const BaseType *units() const {
+    return units_;
+  }
+  SizeType size() const {
+    return size_;
+  }
+  SizeType total_size() const {
+    return sizeof(BaseType) * size_;
+  }
+  SizeType file_size() const {
+    return sizeof(BaseType) + total_size();
+  }
+
+  // Number of keys in a dictionary.
+  BaseType num_of_keys() const {
+    return (size_ != 0) ? units_[0] : 0;
+  }
+  // Number of smaller keys under the source state of a transition.
+  BaseType count(BaseType index) const {
+    return units_[index];
+  }
+
+  // Reads a table from an input stream.
+  bool Read(std::istream *input) {
+    BaseType base_size;
+    if (!input->read(reinterpret_cast<char *>(&base_size), sizeof(BaseType))) {
+      return false;
+    }
+
+    SizeType size = static_cast<SizeType>(base_size);
+    std::vector<BaseType> units_buf(size);
+    if (!input->read(reinterpret_cast<char *>(&units_buf[0]),
+                     sizeof(BaseType) * size)) {
+      return false;
+    }
+
+    SwapUnitsBuf(&units_buf);
+    return true;
+  }
+
+  // Writes a table to an output stream.
+  bool Write(std::ostream *output) const {
+    BaseType base_size = static_cast<BaseType>(size_);
+    if (!output->write(reinterpret_cast<const char *>(&base_size),
+                       sizeof(BaseType))) {
+      return false;
+    }
+
+    if (!output->write(reinterpret_cast<const char *>(units_),
+                       sizeof(BaseType) * size_)) {
+      return false;
+    }
+
+    return true;
+  }
+
+  // Maps memory with its size.
+  void Map(const void *address) {
+    Clear();
+    units_ = static_cast<const BaseType *>(address) + 1;
+    size_ = *static_cast<const BaseType *>(address);
+  }
+  void Map(const void *address, SizeType size) {
+    Clear();
+    units_ = static_cast<const BaseType *>(address);
+    size_ = size;
+  }
+
+  // Swaps tables.
+  void Swap(OrdinalTable *table) {
+    std::swap(units_, table->units_);
+    std::swap(size_, table->size_);
+    units_buf_.swap(table->units_buf_);
+  }
+
+  // Initializes a table.
+  void Clear() {
+    units_ = NULL;
+    size_ = 0;
+    std::vector<BaseType>(0).swap(units_buf_);
+  }
+
+ public:
+  // Following member function is called from OrdinalTableBuilder.
+
+  // Swaps buffers for units.
+  void SwapUnitsBuf(std::vector<BaseType> *units_buf) {
+    units_ = &(*units_buf)[0];
+    size_ = static_cast<BaseType>(units_buf->size());
+    units_buf_.swap(*units_buf);
+  }
+
+ private:
+  const BaseType *units_;
+  SizeType size_;
+  std::vector<BaseType> units_buf_;
+
+  // Disallows copies.
+  OrdinalTable(const OrdinalTable &);
+  OrdinalTable &operator=(const OrdinalTable &);
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_ORDINAL_TABLE_H
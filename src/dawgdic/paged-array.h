@@ -0,0 +1,280 @@
+#ifndef DAWGDIC_PAGED_ARRAY_H
+#define DAWGDIC_PAGED_ARRAY_H
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "base-types.h"
+#include "temp-file.h"
+
+namespace dawgdic {
+
+// Array of objects in a file, which is read and written through a cache of
+// pages (POSIX only). Only cached pages use memory, so builders keep arrays
+// larger than memory in temporary files. Pages are replaced by the CLOCK
+// algorithm, and dirty pages are written back when they are replaced.
+//
+// A reference given by operator[] is valid until the next access to another
+// page of the same array. Objects must be copyable as bytes, and objects
+// which are not yet written read as zero bytes. Errors of reads and writes
+// are kept until Close(), and has_error() should be checked after a build.
+template <typename OBJECT_TYPE>
+class PagedArray {
+ public:
+  enum {
+    // Default number of bytes cached.
+    DEFAULT_CACHE_SIZE = 1 << 20,
+    // Number of bytes per page.
+    PAGE_BYTES = 1 << 12,
+    // Minimum number of cached pages.
+    MIN_NUM_OF_FRAMES = 4
+  };
+
+  PagedArray()
+    : fd_(-1), offset_(0), size_(0), page_shift_(0), objects_(),
+      page_frames_(), frame_pages_(), frame_flags_(), clock_hand_(0),
+      num_of_reads_(0), has_error_(false) {}
+  ~PagedArray() {
+    Close();
+  }
+
+  // Number of objects.
+  SizeType size() const {
+    return size_;
+  }
+  // Number of bytes allocated for a cache and a table of pages.
+  SizeType memory_usage() const {
+    return sizeof(OBJECT_TYPE) * objects_.capacity() +
+        sizeof(BaseType) * page_frames_.capacity() +
+        (sizeof(SizeType) + 1) * frame_pages_.capacity();
+  }
+  // Number of pages read from a file.
+  SizeType num_of_reads() const {
+    return num_of_reads_;
+  }
+  bool is_open() const {
+    return fd_ != -1;
+  }
+  // Checks if a read or a write has failed.
+  bool has_error() const {
+    return has_error_;
+  }
+
+  // Creates an empty array in a temporary file, which is removed at once,
+  // so that its space is freed when the array is closed.
+  bool Create(const std::string &temp_dir,
+              SizeType cache_size = DEFAULT_CACHE_SIZE) {
+    Close();
+
+    std::string file_name;
+    if (!TempFile::Create(temp_dir, &file_name)) {
+      return false;
+    }
+    int fd = ::open(file_name.c_str(), O_RDWR);
+    std::remove(file_name.c_str());
+    if (fd == -1) {
+      return false;
+    }
+    Init(fd, 0, 0, cache_size);
+    return true;
+  }
+
+  // Opens an array of objects which starts at an offset of a file. An
+  // opened array is read-only.
+  bool Open(const char *file_name, SizeType offset, SizeType size,
+            SizeType cache_size = DEFAULT_CACHE_SIZE) {
+    Close();
+
+    int fd = ::open(file_name, O_RDONLY);
+    if (fd == -1) {
+      return false;
+    }
+    Init(fd, offset, size, cache_size);
+    return true;
+  }
+
+  // Closes a file and frees a cache. Dirty pages are not written back.
+  void Close() {
+    if (fd_ != -1) {
+      ::close(fd_);
+    }
+    fd_ = -1;
+    offset_ = 0;
+    size_ = 0;
+    page_shift_ = 0;
+    std::vector<OBJECT_TYPE>(0).swap(objects_);
+    std::vector<BaseType>(0).swap(page_frames_);
+    std::vector<SizeType>(0).swap(frame_pages_);
+    std::vector<UCharType>(0).swap(frame_flags_);
+    clock_hand_ = 0;
+    num_of_reads_ = 0;
+    has_error_ = false;
+  }
+
+  // Accesses objects. A mutable access marks its page as dirty.
+  OBJECT_TYPE &operator[](SizeType index) {
+    SizeType frame_id = FindFrame(index >> page_shift_, DIRTY_FLAG);
+    return objects_[(frame_id << page_shift_) | (index & page_mask())];
+  }
+  const OBJECT_TYPE &operator[](SizeType index) const {
+    SizeType frame_id = FindFrame(index >> page_shift_, 0);
+    return objects_[(frame_id << page_shift_) | (index & page_mask())];
+  }
+
+  // Adds objects to the end. Like std::vector, new objects are filled
+  // with zero bytes, but an array never shrinks.
+  void resize(SizeType size) {
+    if (size > size_) {
+      page_frames_.resize((size + page_mask()) >> page_shift_, 0);
+      size_ = size;
+    }
+  }
+
+  // Writes back dirty pages.
+  bool Flush() {
+    for (SizeType i = 0; i < frame_pages_.size(); ++i) {
+      if (frame_flags_[i] & DIRTY_FLAG) {
+        WritePage(i);
+        frame_flags_[i] &= ~DIRTY_FLAG;
+      }
+    }
+    return !has_error_;
+  }
+
+  // Writes objects to an output stream in order, through the cache.
+  bool Write(std::ostream *output) const {
+    for (SizeType begin = 0; begin < size_; begin += page_size()) {
+      SizeType end = begin + page_size();
+      if (end > size_) {
+        end = size_;
+      }
+      const OBJECT_TYPE *objects = &(*this)[begin];
+      if (!output->write(reinterpret_cast<const char *>(objects),
+                         sizeof(OBJECT_TYPE) * (end - begin))) {
+        return false;
+      }
+    }
+    return !has_error_;
+  }
+
+ private:
+  enum {
+    // Flags of frames.
+    REFERENCED_FLAG = 1 << 0,
+    DIRTY_FLAG = 1 << 1
+  };
+
+  int fd_;
+  SizeType offset_;
+  SizeType size_;
+  SizeType page_shift_;
+  // Cached pages, which are mutable for const accesses.
+  mutable std::vector<OBJECT_TYPE> objects_;
+  // Frame ids plus 1 of pages, or 0 for pages which are not cached.
+  mutable std::vector<BaseType> page_frames_;
+  // Page ids plus 1 of frames, or 0 for frames which are not used.
+  mutable std::vector<SizeType> frame_pages_;
+  mutable std::vector<UCharType> frame_flags_;
+  mutable SizeType clock_hand_;
+  mutable SizeType num_of_reads_;
+  mutable bool has_error_;
+
+  // Disallows copies.
+  PagedArray(const PagedArray &);
+  PagedArray &operator=(const PagedArray &);
+
+  // Number of objects per page.
+  SizeType page_size() const {
+    return static_cast<SizeType>(1) << page_shift_;
+  }
+  SizeType page_mask() const {
+    return page_size() - 1;
+  }
+
+  void Init(int fd, SizeType offset, SizeType size, SizeType cache_size) {
+    fd_ = fd;
+    offset_ = offset;
+    page_shift_ = 0;
+    while ((sizeof(OBJECT_TYPE) << (page_shift_ + 1)) <= PAGE_BYTES) {
+      ++page_shift_;
+    }
+
+    // A frame also has its page id and flags.
+    SizeType num_of_frames = cache_size /
+        ((sizeof(OBJECT_TYPE) << page_shift_) + sizeof(SizeType) + 1);
+    if (num_of_frames < MIN_NUM_OF_FRAMES) {
+      num_of_frames = MIN_NUM_OF_FRAMES;
+    }
+    objects_.resize(num_of_frames << page_shift_);
+    frame_pages_.resize(num_of_frames, 0);
+    frame_flags_.resize(num_of_frames, 0);
+    resize(size);
+  }
+
+  // Finds a frame of a page, which is read into a replaced frame if it is
+  // not cached.
+  SizeType FindFrame(SizeType page_id, UCharType flags) const {
+    BaseType frame_id = page_frames_[page_id];
+    if (frame_id == 0) {
+      frame_id = LoadPage(page_id);
+    }
+    frame_flags_[frame_id - 1] |= REFERENCED_FLAG | flags;
+    return frame_id - 1;
+  }
+
+  // Replaces a frame by the CLOCK algorithm, and reads a page into it.
+  BaseType LoadPage(SizeType page_id) const {
+    while (frame_flags_[clock_hand_] & REFERENCED_FLAG) {
+      frame_flags_[clock_hand_] &= ~REFERENCED_FLAG;
+      clock_hand_ = (clock_hand_ + 1) % frame_pages_.size();
+    }
+    SizeType frame_id = clock_hand_;
+    clock_hand_ = (clock_hand_ + 1) % frame_pages_.size();
+
+    if (frame_pages_[frame_id] != 0) {
+      if (frame_flags_[frame_id] & DIRTY_FLAG) {
+        WritePage(frame_id);
+      }
+      page_frames_[frame_pages_[frame_id] - 1] = 0;
+    }
+    frame_pages_[frame_id] = page_id + 1;
+    frame_flags_[frame_id] = 0;
+    page_frames_[page_id] = static_cast<BaseType>(frame_id + 1);
+
+    // A short read leaves zero bytes after the end of a file.
+    char *bytes = reinterpret_cast<char *>(&objects_[frame_id << page_shift_]);
+    SizeType page_bytes = sizeof(OBJECT_TYPE) << page_shift_;
+    ssize_t num_of_bytes = ::pread(fd_, bytes, page_bytes,
+        static_cast<off_t>(offset_ + page_bytes * page_id));
+    if (num_of_bytes < 0) {
+      has_error_ = true;
+      num_of_bytes = 0;
+    }
+    std::memset(bytes + num_of_bytes, 0,
+                page_bytes - static_cast<SizeType>(num_of_bytes));
+    ++num_of_reads_;
+    return static_cast<BaseType>(frame_id + 1);
+  }
+
+  // Writes a cached page back to a file.
+  void WritePage(SizeType frame_id) const {
+    SizeType page_bytes = sizeof(OBJECT_TYPE) << page_shift_;
+    const char *bytes =
+        reinterpret_cast<const char *>(&objects_[frame_id << page_shift_]);
+    if (::pwrite(fd_, bytes, page_bytes, static_cast<off_t>(
+            offset_ + page_bytes * (frame_pages_[frame_id] - 1))) !=
+        static_cast<ssize_t>(page_bytes)) {
+      has_error_ = true;
+    }
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_PAGED_ARRAY_H
@@ -0,0 +1,149 @@
+#ifndef DAWGDIC_PAGED_DAWG_H
+#define DAWGDIC_PAGED_DAWG_H
+
+#include <fstream>
+
+#include "base-unit.h"
+#include "dawg.h"
+#include "paged-array.h"
+
+namespace dawgdic {
+
+// Dawg in a file written by Dawg::Write(), which is read through caches of
+// pages instead of being mapped, so that its memory usage is bounded. This
+// class has the same accessors as Dawg for builders, such as
+// ExternalDictionaryBuilder.
+class PagedDawg {
+ public:
+  PagedDawg()
+    : base_array_(), label_array_(), flag_array_(), size_(0),
+      num_of_states_(0), num_of_merged_transitions_(0),
+      num_of_merged_states_(0), num_of_merging_states_(0) {}
+
+  // The root index.
+  BaseType root() const {
+    return 0;
+  }
+
+  // Number of units.
+  SizeType size() const {
+    return size_;
+  }
+  // Number of transitions.
+  SizeType num_of_transitions() const {
+    return size_ - 1;
+  }
+  // Number of states.
+  SizeType num_of_states() const {
+    return num_of_states_;
+  }
+  // Number of merged transitions.
+  SizeType num_of_merged_transitions() const {
+    return num_of_merged_transitions_;
+  }
+  // Number of merged states.
+  SizeType num_of_merged_states() const {
+    return num_of_merged_states_;
+  }
+  // Number of merging states.
+  SizeType num_of_merging_states() const {
+    return num_of_merging_states_;
+  }
+  // Number of bytes allocated for caches.
+  SizeType memory_usage() const {
+    return base_array_.memory_usage() + label_array_.memory_usage() +
+        flag_array_.memory_usage();
+  }
+  // Checks if a read has failed.
+  bool has_error() const {
+    return base_array_.has_error() || label_array_.has_error() ||
+        flag_array_.has_error();
+  }
+
+  // Reads values.
+  BaseType child(BaseType index) const {
+    return base_array_[index].child();
+  }
+  BaseType sibling(BaseType index) const {
+    return base_array_[index].has_sibling() ? (index + 1) : 0;
+  }
+  ValueType value(BaseType index) const {
+    return base_array_[index].value();
+  }
+  bool is_leaf(BaseType index) const {
+    return label(index) == '\0';
+  }
+  UCharType label(BaseType index) const {
+    return label_array_[index];
+  }
+  bool is_merging(BaseType index) const {
+    return ((flag_array_[index / 8] >> (index % 8)) & 1) ? true : false;
+  }
+
+  // Opens a dawg file. Most of the cache is given to base values, which
+  // are read the most.
+  bool Open(const char *file_name,
+            SizeType cache_size = PagedArray<BaseUnit>::DEFAULT_CACHE_SIZE) {
+    Close();
+
+    BaseType header[Dawg::NUM_OF_HEADER_FIELDS];
+    std::ifstream file(file_name, std::ios::binary);
+    if (!file.read(reinterpret_cast<char *>(header), sizeof(header))) {
+      return false;
+    }
+    SizeType size = header[0];
+
+    SizeType offset = sizeof(header);
+    if (!base_array_.Open(file_name, offset, size, cache_size / 8 * 5)) {
+      return false;
+    }
+    offset += sizeof(BaseType) * size;
+    if (!label_array_.Open(file_name, offset, size, cache_size / 4)) {
+      Close();
+      return false;
+    }
+    offset += Dawg::LabelsSize(size);
+    if (!flag_array_.Open(file_name, offset, Dawg::FlagsSize(size),
+                          cache_size / 8)) {
+      Close();
+      return false;
+    }
+
+    size_ = size;
+    num_of_states_ = header[1];
+    num_of_merged_transitions_ = header[2];
+    num_of_merged_states_ = header[3];
+    num_of_merging_states_ = header[4];
+    return true;
+  }
+
+  // Closes a dawg file.
+  void Close() {
+    base_array_.Close();
+    label_array_.Close();
+    flag_array_.Close();
+    size_ = 0;
+    num_of_states_ = 0;
+    num_of_merged_transitions_ = 0;
+    num_of_merged_states_ = 0;
+    num_of_merging_states_ = 0;
+  }
+
+ private:
+  PagedArray<BaseUnit> base_array_;
+  PagedArray<UCharType> label_array_;
+  PagedArray<UCharType> flag_array_;
+  SizeType size_;
+  SizeType num_of_states_;
+  SizeType num_of_merged_transitions_;
+  SizeType num_of_merged_states_;
+  SizeType num_of_merging_states_;
+
+  // Disallows copies.
+  PagedDawg(const PagedDawg &);
+  PagedDawg &operator=(const PagedDawg &);
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_PAGED_DAWG_H
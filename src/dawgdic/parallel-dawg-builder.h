@@ -0,0 +1,294 @@
+#ifndef DAWGDIC_PARALLEL_DAWG_BUILDER_H
+#define DAWGDIC_PARALLEL_DAWG_BUILDER_H
+
+#include <pthread.h>
+
+#include <vector>
+
+#include "dawg-builder.h"
+#include "dawg-merger.h"
+
+namespace dawgdic {
+
+// DAWG builder which splits a sorted lexicon into ranges of keys by their
+// first labels. Worker threads build dawgs of ranges, and the calling
+// thread merges them in order with DawgMerger, so the result is the same
+// as that of DawgBuilder. Keys are kept in memory until Finish().
+class ParallelDawgBuilder {
+ public:
+  enum {
+    // Number of ranges per thread, which balances loads of threads.
+    NUM_OF_RANGES_PER_THREAD = 4
+  };
+
+  explicit ParallelDawgBuilder(SizeType num_threads = 1)
+    : num_threads_((num_threads != 0) ? num_threads : 1),
+      key_buf_(), key_ends_(), values_() {}
+
+  SizeType num_threads() const {
+    return num_threads_;
+  }
+  // Number of inserted keys.
+  SizeType num_of_keys() const {
+    return key_ends_.size();
+  }
+
+  // Initializes a builder.
+  void Clear() {
+    std::vector<CharType>(0).swap(key_buf_);
+    std::vector<SizeType>(0).swap(key_ends_);
+    std::vector<ValueType>(0).swap(values_);
+  }
+
+  // Inserts a key.
+  bool Insert(const CharType *key, ValueType value = 0) {
+    if (key == NULL || *key == '\0' || value < 0) {
+      return false;
+    }
+    SizeType length = 1;
+    while (key[length]) {
+      ++length;
+    }
+    return InsertKey(key, length, value);
+  }
+
+  // Inserts a key.
+  bool Insert(const CharType *key, SizeType length, ValueType value) {
+    if (key == NULL || length <= 0 || value < 0) {
+      return false;
+    }
+    for (SizeType i = 0; i < length; ++i) {
+      if (key[i] == '\0') {
+        return false;
+      }
+    }
+    return InsertKey(key, length, value);
+  }
+
+  // Finishes building a dawg. If no thread can be created, the calling
+  // thread builds a dawg by itself.
+  bool Finish(Dawg *dawg) {
+    std::vector<SizeType> ends;
+    SplitKeys(&ends);
+
+    BuildJob job(*this, ends, num_threads_);
+    if (ends.size() <= 1 || job.Start() == 0) {
+      DawgBuilder builder;
+      if (!BuildRange(0, num_of_keys(), &builder, dawg)) {
+        return false;
+      }
+      Clear();
+      return true;
+    }
+
+    DawgMerger merger;
+    Dawg range_dawg;
+    bool is_merged = true;
+    for (SizeType range_id = 0; range_id < ends.size(); ++range_id) {
+      if (!job.Take(range_id, &range_dawg) ||
+          (is_merged && !merger.Add(range_dawg))) {
+        is_merged = false;
+      }
+      range_dawg.Clear();
+    }
+    job.Join();
+
+    if (!is_merged) {
+      return false;
+    }
+    merger.Finish(dawg);
+    Clear();
+    return true;
+  }
+
+ private:
+  const SizeType num_threads_;
+  std::vector<CharType> key_buf_;
+  std::vector<SizeType> key_ends_;
+  std::vector<ValueType> values_;
+
+  // Disallows copies.
+  ParallelDawgBuilder(const ParallelDawgBuilder &);
+  ParallelDawgBuilder &operator=(const ParallelDawgBuilder &);
+
+  // Ranges of keys shared by worker threads. Each worker takes the next
+  // range, and the calling thread takes the dawgs in order of ranges.
+  class BuildJob {
+   public:
+    BuildJob(const ParallelDawgBuilder &builder,
+             const std::vector<SizeType> &ends, SizeType num_threads)
+      : builder_(builder), ends_(ends), num_threads_(num_threads),
+        threads_(), dawgs_(ends.size(), NULL), is_done_(ends.size(), false),
+        next_range_id_(0) {
+      ::pthread_mutex_init(&mutex_, NULL);
+      ::pthread_cond_init(&cond_, NULL);
+    }
+    ~BuildJob() {
+      Join();
+      for (SizeType i = 0; i < dawgs_.size(); ++i) {
+        delete dawgs_[i];
+      }
+      ::pthread_cond_destroy(&cond_);
+      ::pthread_mutex_destroy(&mutex_);
+    }
+
+    // Starts worker threads and returns the number of started threads.
+    SizeType Start() {
+      for (SizeType i = 0; i < num_threads_; ++i) {
+        pthread_t thread;
+        if (::pthread_create(&thread, NULL, &BuildJob::Run, this) != 0) {
+          break;
+        }
+        threads_.push_back(thread);
+      }
+      return threads_.size();
+    }
+
+    // Waits for a range and takes its dawg. Fails if building the dawg
+    // has failed.
+    bool Take(SizeType range_id, Dawg *dawg) {
+      ::pthread_mutex_lock(&mutex_);
+      while (!is_done_[range_id]) {
+        ::pthread_cond_wait(&cond_, &mutex_);
+      }
+      Dawg *range_dawg = dawgs_[range_id];
+      dawgs_[range_id] = NULL;
+      ::pthread_mutex_unlock(&mutex_);
+
+      if (range_dawg == NULL) {
+        return false;
+      }
+      dawg->Swap(range_dawg);
+      delete range_dawg;
+      return true;
+    }
+
+    // Waits for worker threads.
+    void Join() {
+      for (SizeType i = 0; i < threads_.size(); ++i) {
+        ::pthread_join(threads_[i], NULL);
+      }
+      threads_.clear();
+    }
+
+   private:
+    const ParallelDawgBuilder &builder_;
+    const std::vector<SizeType> &ends_;
+    SizeType num_threads_;
+    std::vector<pthread_t> threads_;
+    std::vector<Dawg *> dawgs_;
+    std::vector<bool> is_done_;
+    SizeType next_range_id_;
+    pthread_mutex_t mutex_;
+    pthread_cond_t cond_;
+
+    // Disallows copies.
+    BuildJob(const BuildJob &);
+    BuildJob &operator=(const BuildJob &);
+
+    static void *Run(void *job) {
+      static_cast<BuildJob *>(job)->Work();
+      return NULL;
+    }
+
+    // Builds dawgs until all the ranges are taken.
+    void Work() {
+      DawgBuilder dawg_builder;
+      ::pthread_mutex_lock(&mutex_);
+      while (next_range_id_ < ends_.size()) {
+        SizeType range_id = next_range_id_++;
+        ::pthread_mutex_unlock(&mutex_);
+
+        SizeType begin = (range_id != 0) ? ends_[range_id - 1] : 0;
+        Dawg *dawg = new Dawg;
+        if (!builder_.BuildRange(begin, ends_[range_id],
+                                 &dawg_builder, dawg)) {
+          delete dawg;
+          dawg = NULL;
+        }
+
+        ::pthread_mutex_lock(&mutex_);
+        dawgs_[range_id] = dawg;
+        is_done_[range_id] = true;
+        ::pthread_cond_broadcast(&cond_);
+      }
+      ::pthread_mutex_unlock(&mutex_);
+    }
+  };
+
+  // Checks the order of keys and appends a key to a buffer.
+  bool InsertKey(const CharType *key, SizeType length, ValueType value) {
+    if (!key_ends_.empty()) {
+      SizeType prev_begin = (key_ends_.size() > 1) ?
+          key_ends_[key_ends_.size() - 2] : 0;
+      SizeType prev_length = key_ends_.back() - prev_begin;
+      for (SizeType i = 0; ; ++i) {
+        if (i == length || i == prev_length) {
+          if (i == length && i < prev_length) {
+            return false;
+          }
+          break;
+        }
+        UCharType key_label = static_cast<UCharType>(key[i]);
+        UCharType prev_label =
+            static_cast<UCharType>(key_buf_[prev_begin + i]);
+        if (key_label != prev_label) {
+          if (key_label < prev_label) {
+            return false;
+          }
+          break;
+        }
+      }
+    }
+
+    key_buf_.insert(key_buf_.end(), key, key + length);
+    key_ends_.push_back(key_buf_.size());
+    values_.push_back(value);
+    return true;
+  }
+
+  // Splits keys into ranges, whose ends are given as ids of keys. Ranges
+  // have almost the same number of keys, and a range boundary is put
+  // where the first label changes.
+  void SplitKeys(std::vector<SizeType> *ends) const {
+    SizeType num_of_ranges = num_threads_ * NUM_OF_RANGES_PER_THREAD;
+    for (SizeType i = 1; i < num_of_ranges; ++i) {
+      SizeType key_id = num_of_keys() * i / num_of_ranges;
+      if (key_id == 0 || (!ends->empty() && key_id <= ends->back())) {
+        continue;
+      }
+      while (key_id < num_of_keys() &&
+             FirstLabel(key_id) == FirstLabel(key_id - 1)) {
+        ++key_id;
+      }
+      if (key_id >= num_of_keys()) {
+        break;
+      }
+      ends->push_back(key_id);
+    }
+    ends->push_back(num_of_keys());
+  }
+
+  // Gets the first label of a key.
+  CharType FirstLabel(SizeType key_id) const {
+    return key_buf_[(key_id != 0) ? key_ends_[key_id - 1] : 0];
+  }
+
+  // Builds a dawg from keys in [begin, end).
+  bool BuildRange(SizeType begin, SizeType end, DawgBuilder *builder,
+                  Dawg *dawg) const {
+    for (SizeType key_id = begin; key_id < end; ++key_id) {
+      SizeType key_begin = (key_id != 0) ? key_ends_[key_id - 1] : 0;
+      if (!builder->Insert(&key_buf_[key_begin],
+                           key_ends_[key_id] - key_begin, values_[key_id])) {
+        builder->Clear();
+        return false;
+      }
+    }
+    return builder->Finish(dawg);
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_PARALLEL_DAWG_BUILDER_H
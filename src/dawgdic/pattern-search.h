@@ -0,0 +1,380 @@
+#ifndef DAWGDIC_PATTERN_SEARCH_H
+#define DAWGDIC_PATTERN_SEARCH_H
+
+#include "completion-buffer.h"
+#include "dictionary.h"
+#include "guide.h"
+
+#include <vector>
+
+namespace dawgdic {
+
+// Finds keys which match a pattern. A pattern consists of the following
+// elements, and '\' escapes a special character.
+//
+//   c       a label c
+//   ?       any label
+//   *       any sequence of labels
+//   [...]   a label in a class, such as [abc], [a-z] or [^0-9]
+//
+// A pattern is compiled into a bit-parallel automaton, whose bit i is set
+// if the first i elements have matched. States of a dictionary are visited
+// depth-first only while the automaton has an active bit. A state of a
+// single label class follows its labels directly, and the other states
+// follow children in order of a guide.
+class PatternSearch {
+ public:
+  enum {
+    // Upper limit of the number of elements, which leaves a bit for the
+    // final state.
+    MAX_NUM_OF_ELEMENTS = 63,
+    // Upper limit of the number of labels in a class which are followed
+    // directly instead of enumerating children.
+    MAX_NUM_OF_DIRECT_LABELS = 8
+  };
+
+  PatternSearch()
+    : dic_(NULL), guide_(NULL), star_bits_(0), direct_bits_(0),
+      final_bit_(0), labels_(), label_ends_(), key_(), frames_(),
+      num_of_states_(0) {
+    Init();
+  }
+  PatternSearch(const Dictionary &dic, const Guide &guide)
+    : dic_(&dic), guide_(&guide), star_bits_(0), direct_bits_(0),
+      final_bit_(0), labels_(), label_ends_(), key_(), frames_(),
+      num_of_states_(0) {
+    Init();
+  }
+
+  void set_dic(const Dictionary &dic) {
+    dic_ = &dic;
+  }
+  void set_guide(const Guide &guide) {
+    guide_ = &guide;
+  }
+
+  const Dictionary &dic() const {
+    return *dic_;
+  }
+  const Guide &guide() const {
+    return *guide_;
+  }
+  // Number of states visited by the last Find().
+  SizeType num_of_states() const {
+    return num_of_states_;
+  }
+
+  // Finds keys which match a pattern into a buffer. This fails if the
+  // pattern is invalid or has too many elements.
+  bool Find(const char *pattern, CompletionBuffer *results) {
+    SizeType length = 0;
+    for (const char *p = pattern; *p != '\0'; ++p) {
+      ++length;
+    }
+
+    return Find(pattern, length, results);
+  }
+  bool Find(const char *pattern, SizeType length,
+            CompletionBuffer *results) {
+    results->Clear();
+    num_of_states_ = 0;
+    if (!Compile(pattern, length)) {
+      return false;
+    }
+
+    if (guide_->size() != 0) {
+      Search(results);
+    }
+    return true;
+  }
+
+ private:
+  // Frame of a stack for visiting states depth-first, which keeps active
+  // bits of an automaton and the next label of a state. The next label is
+  // either a label of a guide or a position in labels of a class.
+  class Frame {
+   public:
+    Frame(BaseType dic_index, UInt64Type bits, UCharType label)
+      : dic_index_(dic_index), bits_(bits), label_(label),
+        label_id_(0), label_end_(0) {}
+    Frame(BaseType dic_index, UInt64Type bits, SizeType label_id,
+          SizeType label_end)
+      : dic_index_(dic_index), bits_(bits), label_('\0'),
+        label_id_(label_id), label_end_(label_end) {}
+
+    void set_label(UCharType label) {
+      label_ = label;
+    }
+    void set_label_id(SizeType label_id) {
+      label_id_ = label_id;
+    }
+
+    BaseType dic_index() const {
+      return dic_index_;
+    }
+    UInt64Type bits() const {
+      return bits_;
+    }
+    UCharType label() const {
+      return label_;
+    }
+    SizeType label_id() const {
+      return label_id_;
+    }
+    SizeType label_end() const {
+      return label_end_;
+    }
+
+   private:
+    BaseType dic_index_;
+    UInt64Type bits_;
+    UCharType label_;
+    SizeType label_id_;
+    SizeType label_end_;
+
+    // Copyable.
+  };
+
+  const Dictionary *dic_;
+  const Guide *guide_;
+  // Bit i of a mask of a label is set if the label matches the i-th
+  // element.
+  UInt64Type label_masks_[256];
+  UInt64Type star_bits_;
+  UInt64Type direct_bits_;
+  UInt64Type final_bit_;
+  std::vector<UCharType> labels_;
+  std::vector<SizeType> label_ends_;
+  std::vector<char> key_;
+  std::vector<Frame> frames_;
+  SizeType num_of_states_;
+
+  // Disallows copies.
+  PatternSearch(const PatternSearch &);
+  PatternSearch &operator=(const PatternSearch &);
+
+  void Init() {
+    for (SizeType i = 0; i < 256; ++i) {
+      label_masks_[i] = 0;
+    }
+  }
+
+  // Compiles a pattern into masks of labels. Consecutive stars are merged,
+  // so a star is never followed by another star.
+  bool Compile(const char *pattern, SizeType length) {
+    Init();
+    star_bits_ = 0;
+    direct_bits_ = 0;
+    labels_.clear();
+    label_ends_.clear();
+
+    UCharType is_matched[256];
+    SizeType num_of_elements = 0;
+    for (SizeType i = 0; i < length; ) {
+      if (num_of_elements >= MAX_NUM_OF_ELEMENTS) {
+        return false;
+      }
+      UInt64Type bit = static_cast<UInt64Type>(1) << num_of_elements;
+
+      if (pattern[i] == '*') {
+        ++i;
+        if ((star_bits_ & (bit >> 1)) == 0) {
+          star_bits_ |= bit;
+          label_ends_.push_back(labels_.size());
+          ++num_of_elements;
+        }
+        continue;
+      }
+
+      if (!ParseClass(pattern, length, &i, is_matched)) {
+        return false;
+      }
+      SizeType num_of_labels = 0;
+      for (SizeType label = 1; label < 256; ++label) {
+        if (is_matched[label]) {
+          label_masks_[label] |= bit;
+          ++num_of_labels;
+        }
+      }
+      if (num_of_labels <= MAX_NUM_OF_DIRECT_LABELS) {
+        for (SizeType label = 1; label < 256; ++label) {
+          if (is_matched[label]) {
+            labels_.push_back(static_cast<UCharType>(label));
+          }
+        }
+        direct_bits_ |= bit;
+      }
+      label_ends_.push_back(labels_.size());
+      ++num_of_elements;
+    }
+
+    final_bit_ = static_cast<UInt64Type>(1) << num_of_elements;
+    return true;
+  }
+
+  // Parses an element other than a star into flags of labels.
+  static bool ParseClass(const char *pattern, SizeType length, SizeType *i,
+                         UCharType *is_matched) {
+    if (pattern[*i] != '[') {
+      bool is_any = (pattern[*i] == '?');
+      for (SizeType label = 0; label < 256; ++label) {
+        is_matched[label] = is_any;
+      }
+      if (is_any) {
+        ++*i;
+        return true;
+      }
+
+      UCharType label;
+      if (!ParseLabel(pattern, length, i, &label)) {
+        return false;
+      }
+      is_matched[label] = 1;
+      return true;
+    }
+
+    // Parses a class. A ']' just after '[' or '[^' is a label.
+    bool is_negative = (++*i < length && pattern[*i] == '^');
+    if (is_negative) {
+      ++*i;
+    }
+    for (SizeType label = 0; label < 256; ++label) {
+      is_matched[label] = is_negative;
+    }
+    SizeType begin = *i;
+    for ( ; ; ) {
+      if (*i >= length) {
+        return false;
+      } else if (pattern[*i] == ']' && *i != begin) {
+        ++*i;
+        return true;
+      }
+
+      UCharType first;
+      if (!ParseLabel(pattern, length, i, &first)) {
+        return false;
+      }
+      UCharType last = first;
+      if (*i + 1 < length && pattern[*i] == '-' && pattern[*i + 1] != ']') {
+        ++*i;
+        if (!ParseLabel(pattern, length, i, &last)) {
+          return false;
+        }
+      }
+      for (SizeType label = first; label <= last; ++label) {
+        is_matched[label] = !is_negative;
+      }
+    }
+  }
+
+  // Parses a label in a class, which may be escaped.
+  static bool ParseLabel(const char *pattern, SizeType length, SizeType *i,
+                         UCharType *label) {
+    if (pattern[*i] == '\\' && ++*i >= length) {
+      return false;
+    }
+    *label = static_cast<UCharType>(pattern[*i]);
+    ++*i;
+    return true;
+  }
+
+  void Search(CompletionBuffer *results) {
+    key_.clear();
+    frames_.clear();
+
+    VisitState(dic_->root(), Close(1), results);
+    while (!frames_.empty()) {
+      UCharType label;
+      BaseType child_index;
+      if (!FindChild(&frames_.back(), &label, &child_index)) {
+        frames_.pop_back();
+        continue;
+      }
+
+      // Elements other than stars move their bits, and stars keep theirs.
+      UInt64Type bits = frames_.back().bits();
+      bits = ((bits & label_masks_[label]) << 1) | (bits & star_bits_);
+      if (bits == 0) {
+        continue;
+      }
+
+      SizeType depth = frames_.size();
+      key_.resize(depth - 1);
+      key_.push_back(static_cast<char>(label));
+      VisitState(child_index, Close(bits), results);
+    }
+  }
+
+  // A star also matches an empty sequence.
+  UInt64Type Close(UInt64Type bits) const {
+    return bits | ((bits & star_bits_) << 1);
+  }
+
+  // Appends the key of a state if the pattern has matched, and pushes a
+  // frame if the pattern may match its descendants.
+  void VisitState(BaseType dic_index, UInt64Type bits,
+                  CompletionBuffer *results) {
+    ++num_of_states_;
+    if ((bits & final_bit_) != 0 && dic_->has_value(dic_index)) {
+      results->Append(key_.empty() ? "" : &key_[0], key_.size(),
+                      dic_->value(dic_index));
+    }
+
+    bits &= final_bit_ - 1;
+    if (bits == 0) {
+      return;
+    }
+
+    // A single class follows its labels directly.
+    if ((bits & (bits - 1)) == 0 && (bits & direct_bits_) != 0) {
+      SizeType element = FindLowestBit(bits);
+      SizeType label_begin = (element == 0) ? 0 : label_ends_[element - 1];
+      frames_.push_back(Frame(dic_index, bits, label_begin,
+                              label_ends_[element]));
+      return;
+    }
+
+    UCharType child_label = guide_->child(dic_index);
+    if (child_label != '\0') {
+      frames_.push_back(Frame(dic_index, bits, child_label));
+    }
+  }
+
+  // Finds the next child of a state.
+  bool FindChild(Frame *frame, UCharType *label, BaseType *child_index) {
+    while (frame->label_id() < frame->label_end()) {
+      *label = labels_[frame->label_id()];
+      frame->set_label_id(frame->label_id() + 1);
+      *child_index = frame->dic_index();
+      if (dic_->Follow(*label, child_index)) {
+        return true;
+      }
+    }
+
+    *label = frame->label();
+    if (*label == '\0') {
+      return false;
+    }
+    *child_index = frame->dic_index() ^
+        dic_->units()[frame->dic_index()].offset() ^ *label;
+    frame->set_label(guide_->sibling(*child_index));
+    return true;
+  }
+
+  // Finds the lowest bit of a non-zero word.
+  static SizeType FindLowestBit(UInt64Type bits) {
+#if defined(__GNUC__)
+    return static_cast<SizeType>(__builtin_ctzll(bits));
+#else  // defined(__GNUC__)
+    SizeType bit = 0;
+    while (((bits >> bit) & 1) == 0) {
+      ++bit;
+    }
+    return bit;
+#endif  // defined(__GNUC__)
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_PATTERN_SEARCH_H
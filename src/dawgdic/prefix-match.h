@@ -0,0 +1,36 @@
+#ifndef DAWGDIC_PREFIX_MATCH_H
+#define DAWGDIC_PREFIX_MATCH_H
+
+#include "base-types.h"
+
+namespace dawgdic {
+
+// Key found as a prefix of a string.
+class PrefixMatch {
+ public:
+  PrefixMatch() : length_(0), value_(-1) {}
+
+  void set_length(SizeType length) {
+    length_ = length;
+  }
+  void set_value(ValueType value) {
+    value_ = value;
+  }
+
+  SizeType length() const {
+    return length_;
+  }
+  ValueType value() const {
+    return value_;
+  }
+
+ private:
+  SizeType length_;
+  ValueType value_;
+
+  // Copyable.
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_PREFIX_MATCH_H
@@ -1,6 +1,8 @@
 #ifndef DAWGDIC_RANKED_COMPLETER_H
 #define DAWGDIC_RANKED_COMPLETER_H
 
+#include "best-value-table.h"
+#include "completion-buffer.h"
 #include "dictionary.h"
 #include "ranked-completer-candidate.h"
 #include "ranked-completer-node.h"
@@ -8,7 +10,6 @@
 
 #include <algorithm>
 #include <functional>
-#include <queue>
 #include <vector>
 
 namespace dawgdic {
@@ -20,14 +21,18 @@ class RankedCompleterBase {
 
   explicit RankedCompleterBase(
       ValueComparerType value_comparer = ValueComparerType())
-    : dic_(NULL), guide_(NULL), key_(), prefix_length_(0), value_(-1),
-      nodes_(), node_queue_(), candidate_queue_(
-          RankedCompleterCandidate::MakeComparer(value_comparer)) {}
+    : dic_(NULL), guide_(NULL), table_(NULL), key_(), root_keys_(),
+      root_key_ends_(), root_index_(0), value_(-1),
+      value_comparer_(value_comparer), has_min_value_(false), min_value_(-1),
+      nodes_(), node_queue_(), candidates_(),
+      candidate_comparer_(value_comparer) {}
   RankedCompleterBase(const Dictionary &dic, const RankedGuide &guide,
       ValueComparerType value_comparer = ValueComparerType())
-    : dic_(&dic), guide_(&guide), key_(), prefix_length_(0), value_(-1),
-      nodes_(), node_queue_(), candidate_queue_(
-          RankedCompleterCandidate::MakeComparer(value_comparer)) {}
+    : dic_(&dic), guide_(&guide), table_(NULL), key_(), root_keys_(),
+      root_key_ends_(), root_index_(0), value_(-1),
+      value_comparer_(value_comparer), has_min_value_(false), min_value_(-1),
+      nodes_(), node_queue_(), candidates_(),
+      candidate_comparer_(value_comparer) {}
 
   void set_dic(const Dictionary &dic) {
     dic_ = &dic;
@@ -35,6 +40,20 @@ class RankedCompleterBase {
   void set_guide(const RankedGuide &guide) {
     guide_ = &guide;
   }
+  // Sets a table of best values, which must be built with the guide. The
+  // table lets a threshold prune subtrees before following them.
+  void set_table(const BestValueTable &table) {
+    table_ = &table;
+  }
+  // Sets a threshold of values. Keys whose values are worse than it are
+  // not completed. The threshold is kept until it is cleared.
+  void set_min_value(ValueType min_value) {
+    has_min_value_ = true;
+    min_value_ = min_value;
+  }
+  void clear_min_value() {
+    has_min_value_ = false;
+  }
 
   const Dictionary &dic() const {
     return *dic_;
@@ -42,6 +61,10 @@ class RankedCompleterBase {
   const RankedGuide &guide() const {
     return *guide_;
   }
+  // Number of nodes created since the last Start() or Clear().
+  SizeType num_of_nodes() const {
+    return nodes_.size();
+  }
 
   // These member functions are available only when Next() returns true.
   const char *key() const {
@@ -53,6 +76,11 @@ class RankedCompleterBase {
   ValueType value() const {
     return value_;
   }
+  // Index of a root under which the key is found, which counts roots added
+  // by AddRoot() in order.
+  SizeType root_index() const {
+    return root_index_;
+  }
 
   // Starts completing keys from given index and prefix.
   void Start(BaseType index, const char *prefix = "") {
@@ -64,23 +92,37 @@ class RankedCompleterBase {
     Start(index, prefix, length);
   }
   void Start(BaseType index, const char *prefix, SizeType length) {
-    key_.resize(length);
-    for (SizeType i = 0; i < length; ++i) {
-      key_[i] = prefix[i];
-    }
-    prefix_length_ = length;
+    Clear();
+    AddRoot(index, prefix, length);
+  }
+
+  // Clears roots, and then roots are given by AddRoot().
+  void Clear() {
+    key_.clear();
+    root_keys_.clear();
+    root_key_ends_.clear();
+    root_index_ = 0;
     value_ = -1;
 
     nodes_.clear();
     node_queue_.clear();
-    while (!candidate_queue_.empty()) {
-      candidate_queue_.pop();
-    }
+    candidates_.clear();
+  }
 
-    if (guide_->size() != 0) {
-      CreateNode(index, 0, 'X');
-      EnqueueNode(0);
+  // Adds a state and its key as a root. Keys under roots are merged in order
+  // of values, so roots must not be on the path to other roots. Roots must
+  // be added before Next() is called. A pruned root is not added.
+  bool AddRoot(BaseType index, const char *prefix, SizeType length) {
+    if (guide_->size() == 0 || IsPruned(index)) {
+      return false;
     }
+
+    root_keys_.insert(root_keys_.end(), prefix, prefix + length);
+    root_key_ends_.push_back(root_keys_.size());
+    BaseType node_index = CreateNode(index, 0, 'X');
+    nodes_[node_index].set_prev_node_index(node_index);
+    EnqueueNode(node_index);
+    return true;
   }
 
   // Gets the next key.
@@ -96,44 +138,87 @@ class RankedCompleterBase {
     node_queue_.clear();
 
     // Returns false if there is no candidate.
-    if (candidate_queue_.empty()) {
+    if (candidates_.empty()) {
       return false;
     }
 
-    const RankedCompleterCandidate &candidate = candidate_queue_.top();
+    std::pop_heap(candidates_.begin(), candidates_.end(),
+                  candidate_comparer_);
+    const RankedCompleterCandidate &candidate = candidates_.back();
 
     BaseType node_index = candidate.node_index();
     EnqueueNode(node_index);
     node_index = nodes_[node_index].prev_node_index();
 
-    key_.resize(prefix_length_);
-    while (node_index != 0) {
+    // Nodes of roots come first, and a root points to itself.
+    key_.clear();
+    while (node_index >= root_key_ends_.size()) {
       key_.push_back(nodes_[node_index].label());
       EnqueueNode(node_index);
       node_index = nodes_[node_index].prev_node_index();
     }
-    std::reverse(key_.begin() + prefix_length_, key_.end());
+    std::reverse(key_.begin(), key_.end());
+    root_index_ = node_index;
+    SizeType root_key_begin =
+        (node_index == 0) ? 0 : root_key_ends_[node_index - 1];
+    key_.insert(key_.begin(), root_keys_.begin() + root_key_begin,
+                root_keys_.begin() + root_key_ends_[node_index]);
     key_.push_back('\0');
 
     value_ = candidate.value();
-    candidate_queue_.pop();
+    candidates_.pop_back();
 
     return true;
   }
 
+  // Allocates memory for nodes in advance. Memory is kept across queries,
+  // so completion allocates no memory once it is large enough.
+  void Reserve(SizeType num_of_nodes) {
+    nodes_.reserve(num_of_nodes);
+    node_queue_.reserve(num_of_nodes);
+    candidates_.reserve(num_of_nodes);
+  }
+
+  // Completes at most k keys from given index and prefix into a buffer in
+  // order of values, and returns the number of keys. If max_num_of_nodes
+  // is not 0, completion stops when the number of nodes reaches it, so the
+  // work of a query is bounded. A step may exceed the limit by nodes of
+  // one key.
+  SizeType TopK(BaseType index, const char *prefix, SizeType length,
+                SizeType k, CompletionBuffer *results,
+                SizeType max_num_of_nodes = 0) {
+    results->Clear();
+    Start(index, prefix, length);
+    while (results->size() < k) {
+      if (max_num_of_nodes != 0 && nodes_.size() >= max_num_of_nodes) {
+        break;
+      }
+      if (!Next()) {
+        break;
+      }
+      results->Append(key(), this->length(), value_);
+    }
+    return results->size();
+  }
+
  private:
   const Dictionary *dic_;
   const RankedGuide *guide_;
+  const BestValueTable *table_;
   std::vector<UCharType> key_;
-  SizeType prefix_length_;
+  std::vector<UCharType> root_keys_;
+  std::vector<SizeType> root_key_ends_;
+  SizeType root_index_;
   ValueType value_;
+  ValueComparerType value_comparer_;
+  bool has_min_value_;
+  ValueType min_value_;
 
   std::vector<RankedCompleterNode> nodes_;
   std::vector<BaseType> node_queue_;
-  std::priority_queue<RankedCompleterCandidate,
-                      std::vector<RankedCompleterCandidate>,
-                      RankedCompleterCandidate::Comparer<ValueComparerType> >
-      candidate_queue_;
+  // Binary heap of candidates, whose memory is kept across queries.
+  std::vector<RankedCompleterCandidate> candidates_;
+  RankedCompleterCandidate::Comparer<ValueComparerType> candidate_comparer_;
 
   // Disallows copies.
   RankedCompleterBase(const RankedCompleterBase &);
@@ -149,13 +234,21 @@ class RankedCompleterBase {
     nodes_[node_index].set_is_queued();
   }
 
-  // Pushes a candidate to priority queue.
+  // Pushes a candidate to priority queue. A candidate worse than the
+  // threshold is dropped, and so are the following candidates of its
+  // branch, which are not better.
   void EnqueueCandidate(BaseType node_index) {
+    ValueType value = dic_->units()[nodes_[node_index].dic_index()].value();
+    if (is_worse(value)) {
+      return;
+    }
+
     RankedCompleterCandidate candidate;
     candidate.set_node_index(node_index);
-    candidate.set_value(
-        dic_->units()[nodes_[node_index].dic_index()].value());
-    candidate_queue_.push(candidate);
+    candidate.set_value(value);
+    candidates_.push_back(candidate);
+    std::push_heap(candidates_.begin(), candidates_.end(),
+                   candidate_comparer_);
   }
 
   // Finds a sibling of a given node.
@@ -172,8 +265,13 @@ class RankedCompleterBase {
     }
 
     // Follows a transition to sibling and creates a node for the sibling.
+    // Siblings are sorted by their best values, so a pruned sibling ends
+    // the search of its branch.
     BaseType dic_prev_index = nodes_[prev_node_index].dic_index();
     dic_index = FollowWithoutCheck(dic_prev_index, sibling_label);
+    if (sibling_label != '\0' && IsPruned(dic_index)) {
+      return false;
+    }
     *node_index = CreateNode(dic_index, prev_node_index, sibling_label);
 
     return true;
@@ -200,6 +298,17 @@ class RankedCompleterBase {
     return index ^ dic_->units()[index].offset() ^ label;
   }
 
+  // Checks if a value is worse than the threshold.
+  bool is_worse(ValueType value) const {
+    return has_min_value_ && value_comparer_(value, min_value_);
+  }
+
+  // Checks if the best value under a state is worse than the threshold.
+  bool IsPruned(BaseType dic_index) const {
+    return table_ != NULL && table_->size() != 0 &&
+        is_worse(table_->value(dic_index));
+  }
+
   // Creates a node.
   BaseType CreateNode(BaseType dic_index, BaseType prev_node_index,
                       UCharType label) {
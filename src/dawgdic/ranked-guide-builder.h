@@ -1,6 +1,8 @@
 #ifndef DAWGDIC_RANKED_GUIDE_BUILDER_H
 #define DAWGDIC_RANKED_GUIDE_BUILDER_H
 
+#include "best-value-table.h"
+#include "build-progress.h"
 #include "dawg.h"
 #include "dictionary.h"
 #include "ranked-guide.h"
@@ -20,37 +22,109 @@ class RankedGuideBuilder {
     return Build(dawg, dic, guide, std::less<ValueType>());
   }
 
+  // Builds a dictionary for completing keys, and updates a progress while
+  // building.
+  static bool Build(const Dawg &dawg, const Dictionary &dic,
+                    RankedGuide *guide, BuildProgress *progress) {
+    return Build(dawg, dic, guide, std::less<ValueType>(), progress);
+  }
+
   // Builds a dictionary for completing keys.
   template <typename VALUE_COMPARER_TYPE>
   static bool Build(const Dawg &dawg, const Dictionary &dic,
-                    RankedGuide *guide, VALUE_COMPARER_TYPE value_comparer) {
-    RankedGuideBuilder builder(dawg, dic, guide);
+                    RankedGuide *guide, VALUE_COMPARER_TYPE value_comparer,
+                    BuildProgress *progress = NULL) {
+    RankedGuideBuilder builder(dawg, dic, guide, NULL, progress);
+    return builder.BuildRankedGuide(value_comparer);
+  }
+
+  // Builds a dictionary for completing keys and a table of the best value
+  // under each state.
+  static bool Build(const Dawg &dawg, const Dictionary &dic,
+                    RankedGuide *guide, BestValueTable *table,
+                    BuildProgress *progress = NULL) {
+    return Build(dawg, dic, guide, table, std::less<ValueType>(), progress);
+  }
+  template <typename VALUE_COMPARER_TYPE>
+  static bool Build(const Dawg &dawg, const Dictionary &dic,
+                    RankedGuide *guide, BestValueTable *table,
+                    VALUE_COMPARER_TYPE value_comparer,
+                    BuildProgress *progress = NULL) {
+    RankedGuideBuilder builder(dawg, dic, guide, table, progress);
     return builder.BuildRankedGuide(value_comparer);
   }
 
  private:
+  enum {
+    // Number of frames allocated to a stack in advance.
+    INITIAL_STACK_SIZE = 1 << 10
+  };
+
+  // Frame of a stack for building a guide depth-first, which keeps the
+  // current child of a state and the beginning of its links.
+  class Frame {
+   public:
+    Frame(BaseType dawg_child_index, BaseType dic_index,
+          SizeType links_begin)
+      : dawg_child_index_(dawg_child_index), dic_index_(dic_index),
+        links_begin_(links_begin) {}
+
+    void set_dawg_child_index(BaseType dawg_child_index) {
+      dawg_child_index_ = dawg_child_index;
+    }
+
+    BaseType dawg_child_index() const {
+      return dawg_child_index_;
+    }
+    BaseType dic_index() const {
+      return dic_index_;
+    }
+    SizeType links_begin() const {
+      return links_begin_;
+    }
+
+   private:
+    BaseType dawg_child_index_;
+    BaseType dic_index_;
+    SizeType links_begin_;
+
+    // Copyable.
+  };
+
   const Dawg &dawg_;
   const Dictionary &dic_;
   RankedGuide *guide_;
+  BestValueTable *table_;
+  BuildProgress *progress_;
 
   std::vector<RankedGuideUnit> units_;
+  std::vector<ValueType> best_values_;
   std::vector<RankedGuideLink> links_;
   std::vector<UCharType> is_fixed_table_;
+  std::vector<Frame> frames_;
 
   // Disallows copies.
   RankedGuideBuilder(const RankedGuideBuilder &);
   RankedGuideBuilder &operator=(const RankedGuideBuilder &);
 
   RankedGuideBuilder(const Dawg &dawg, const Dictionary &dic,
-                     RankedGuide *guide)
-    : dawg_(dawg), dic_(dic), guide_(guide),
-      units_(), links_(), is_fixed_table_() {}
+                     RankedGuide *guide, BestValueTable *table,
+                     BuildProgress *progress)
+    : dawg_(dawg), dic_(dic), guide_(guide), table_(table),
+      progress_(progress), units_(), best_values_(), links_(),
+      is_fixed_table_(), frames_() {}
 
   template <typename VALUE_COMPARER_TYPE>
   bool BuildRankedGuide(VALUE_COMPARER_TYPE value_comparer) {
     // Initializes units and flags.
     units_.resize(dic_.size());
+    if (table_ != NULL) {
+      best_values_.resize(dic_.size(), -1);
+    }
     is_fixed_table_.resize(dic_.size() / 8, '\0');
+    if (progress_ != NULL) {
+      progress_->Start(dawg_.num_of_states());
+    }
 
     if (dawg_.size() <= 1) {
       return true;
@@ -63,10 +137,15 @@ class RankedGuideBuilder {
     }
 
     guide_->SwapUnitsBuf(&units_);
+    if (table_ != NULL) {
+      table_->SwapUnitsBuf(&best_values_);
+    }
     return true;
   }
 
-  // Builds a guide recursively.
+  // Builds a guide depth-first, and gets the maximum value under a state.
+  // A stack of frames is used instead of recursion, so the depth is not
+  // limited by the stack size of a thread.
   template <typename VALUE_COMPARER_TYPE>
   bool BuildRankedGuide(BaseType dawg_index, BaseType dic_index,
                         ValueType *max_value,
@@ -74,25 +153,90 @@ class RankedGuideBuilder {
     if (is_fixed(dic_index)) {
       return FindMaxValue(dic_index, max_value);
     }
-    set_is_fixed(dic_index);
+    frames_.reserve(INITIAL_STACK_SIZE);
+    frames_.clear();
+    VisitState(dawg_index, dic_index);
+
+    for ( ; ; ) {
+      BaseType dawg_child_index = frames_.back().dawg_child_index();
+      if (dawg_child_index == 0) {
+        // Links of a state are complete.
+        ValueType value = -1;
+        if (!FixState(frames_.back().dic_index(),
+                      frames_.back().links_begin(), &value,
+                      value_comparer)) {
+          return false;
+        }
+        frames_.pop_back();
+        if (frames_.empty()) {
+          *max_value = value;
+          return true;
+        }
+        AddLink(value);
+        continue;
+      }
 
-    SizeType initial_num_links = links_.size();
+      // Enumerates links to the next states.
+      ValueType value = -1;
+      UCharType child_label = dawg_.label(dawg_child_index);
+      BaseType dic_child_index = frames_.back().dic_index();
+      if (child_label == '\0') {
+        if (!dic_.has_value(dic_child_index)) {
+          return false;
+        }
+        value = dic_.value(dic_child_index);
+      } else {
+        if (!dic_.Follow(child_label, &dic_child_index)) {
+          return false;
+        }
 
-    // Enumerates links to the next states.
-    if (!EnumerateLinks(dawg_index, dic_index, value_comparer)) {
-      return false;
+        if (!is_fixed(dic_child_index)) {
+          VisitState(dawg_child_index, dic_child_index);
+          continue;
+        } else if (!FindMaxValue(dic_child_index, &value)) {
+          return false;
+        }
+      }
+      AddLink(value);
     }
+  }
 
-    std::stable_sort(links_.begin() + initial_num_links, links_.end(),
+  // Visits a state, and pushes a frame for enumerating its links.
+  void VisitState(BaseType dawg_index, BaseType dic_index) {
+    set_is_fixed(dic_index);
+    if (progress_ != NULL) {
+      progress_->Visit(frames_.size());
+    }
+    frames_.push_back(Frame(dawg_.child(dawg_index), dic_index,
+                            links_.size()));
+  }
+
+  // Adds a link to the current child of the top state, and moves to the
+  // next child.
+  void AddLink(ValueType value) {
+    BaseType dawg_child_index = frames_.back().dawg_child_index();
+    links_.push_back(RankedGuideLink(dawg_.label(dawg_child_index), value));
+    frames_.back().set_dawg_child_index(dawg_.sibling(dawg_child_index));
+  }
+
+  // Sorts links of a state, reflects them into units, and gets the
+  // maximum value under the state.
+  template <typename VALUE_COMPARER_TYPE>
+  bool FixState(BaseType dic_index, SizeType links_begin,
+                ValueType *max_value, VALUE_COMPARER_TYPE value_comparer) {
+    std::stable_sort(links_.begin() + links_begin, links_.end(),
       RankedGuideLink::MakeComparer(value_comparer));
 
     // Reflects links into units.
-    if (!TurnLinksToUnits(dic_index, initial_num_links)) {
+    if (!TurnLinksToUnits(dic_index, links_begin)) {
       return false;
     }
 
-    *max_value = links_[initial_num_links].value();
-    links_.resize(initial_num_links);
+    *max_value = links_[links_begin].value();
+    links_.resize(links_begin);
+    if (table_ != NULL) {
+      best_values_[dic_index] = *max_value;
+    }
 
     return true;
   }
@@ -112,37 +256,6 @@ class RankedGuideBuilder {
     return true;
   }
 
-  // Enumerates links to the next states.
-  template <typename VALUE_COMPARER_TYPE>
-  bool EnumerateLinks(BaseType dawg_index, BaseType dic_index,
-                      VALUE_COMPARER_TYPE value_comparer) {
-    for (BaseType dawg_child_index = dawg_.child(dawg_index);
-        dawg_child_index != 0;
-        dawg_child_index = dawg_.sibling(dawg_child_index)) {
-      ValueType value = -1;
-      UCharType child_label = dawg_.label(dawg_child_index);
-      if (child_label == '\0') {
-        if (!dic_.has_value(dic_index)) {
-          return false;
-        }
-        value = dic_.value(dic_index);
-      } else {
-        BaseType dic_child_index = dic_index;
-        if (!dic_.Follow(child_label, &dic_child_index)) {
-          return false;
-        }
-
-        if (!BuildRankedGuide(dawg_child_index, dic_child_index,
-                              &value, value_comparer)) {
-          return false;
-        }
-      }
-      links_.push_back(RankedGuideLink(child_label, value));
-    }
-
-    return true;
-  }
-
   // Modifies units.
   bool TurnLinksToUnits(BaseType dic_index, SizeType links_begin) {
     // The first child.
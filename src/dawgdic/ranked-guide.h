@@ -2,6 +2,7 @@
 #define DAWGDIC_RANKED_GUIDE_H
 
 #include "dictionary.h"
+#include "huge-page-buffer.h"
 #include "ranked-guide-unit.h"
 
 #include <iostream>
@@ -11,7 +12,7 @@ namespace dawgdic {
 
 class RankedGuide {
  public:
-  RankedGuide() : units_(NULL), size_(0), units_buf_() {}
+  RankedGuide() : units_(NULL), size_(0), units_buf_(), huge_page_buf_() {}
 
   const RankedGuideUnit *units() const {
     return units_;
@@ -25,6 +26,11 @@ class RankedGuide {
   SizeType file_size() const {
     return sizeof(BaseType) + total_size();
   }
+  // Number of bytes in huge pages around units, which may be read from
+  // a file or mapped. See HugePageBuffer::CountHugePageBytes().
+  SizeType huge_page_bytes() const {
+    return HugePageBuffer::CountHugePageBytes(units_, total_size());
+  }
 
   // The root index.
   BaseType root() const {
@@ -55,6 +61,20 @@ class RankedGuide {
     SwapUnitsBuf(&units_buf);
     return true;
   }
+  // Reads a guide from an input stream into huge pages. See HugePageBuffer
+  // for flags.
+  bool Read(std::istream *input, int huge_page_flags) {
+    HugePageBuffer huge_page_buf;
+    if (!huge_page_buf.Read(input, sizeof(RankedGuideUnit), huge_page_flags)) {
+      return false;
+    }
+
+    Clear();
+    units_ = static_cast<const RankedGuideUnit *>(huge_page_buf.address());
+    size_ = huge_page_buf.size() / sizeof(RankedGuideUnit);
+    huge_page_buf_.Swap(&huge_page_buf);
+    return true;
+  }
 
   // Writes a dictionry to an output stream.
   bool Write(std::ostream *output) const {
@@ -90,6 +110,7 @@ class RankedGuide {
     std::swap(units_, guide->units_);
     std::swap(size_, guide->size_);
     units_buf_.swap(guide->units_buf_);
+    huge_page_buf_.Swap(&guide->huge_page_buf_);
   }
 
   // Initializes a RankedGuide.
@@ -97,6 +118,7 @@ class RankedGuide {
     units_ = NULL;
     size_ = 0;
     std::vector<RankedGuideUnit>(0).swap(units_buf_);
+    huge_page_buf_.Clear();
   }
 
  public:
@@ -107,12 +129,14 @@ class RankedGuide {
     units_ = &(*units_buf)[0];
     size_ = static_cast<BaseType>(units_buf->size());
     units_buf_.swap(*units_buf);
+    huge_page_buf_.Clear();
   }
 
  private:
   const RankedGuideUnit *units_;
   SizeType size_;
   std::vector<RankedGuideUnit> units_buf_;
+  HugePageBuffer huge_page_buf_;
 
   // Disables copies.
   RankedGuide(const RankedGuide &);
@@ -0,0 +1,634 @@
+#ifndef DAWGDIC_SORTED_KEY_FEEDER_H
+#define DAWGDIC_SORTED_KEY_FEEDER_H
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "base-types.h"
+#include "temp-file.h"
+
+namespace dawgdic {
+
+// Front end of builders for unsorted keys. Keys are buffered in a run,
+// which is sorted by worker threads and spilled to a temporary file when
+// it reaches a size. Feed() merges runs, resolves duplicate keys by a
+// policy, and inserts the keys into a builder in order, such as
+// DawgBuilder, ParallelDawgBuilder or ExternalDawgBuilder.
+class SortedKeyFeeder {
+ public:
+  // Policies for values of duplicate keys.
+  enum DuplicatePolicy {
+    // Keeps the value of the first occurrence.
+    KEEP_FIRST,
+    // Keeps the value of the last occurrence.
+    KEEP_LAST,
+    // Keeps the maximum value.
+    KEEP_MAX,
+    // Sums values, which saturates at the maximum value.
+    SUM_VALUES
+  };
+
+  enum {
+    // Default number of bytes in a run (256 MiB).
+    DEFAULT_RUN_SIZE = 1 << 28
+  };
+
+  explicit SortedKeyFeeder(DuplicatePolicy policy = KEEP_LAST,
+                           SizeType num_threads = 1,
+                           SizeType run_size = DEFAULT_RUN_SIZE,
+                           const char *temp_dir = NULL)
+    : policy_(policy), num_threads_((num_threads != 0) ? num_threads : 1),
+      run_size_(run_size), temp_dir_(TempFile::Dir(temp_dir)), key_buf_(),
+      key_ends_(), values_(), order_(), run_file_names_(), num_of_keys_(0),
+      num_of_duplicates_(0), num_of_spilled_runs_(0) {}
+  ~SortedKeyFeeder() {
+    Clear();
+  }
+
+  DuplicatePolicy policy() const {
+    return policy_;
+  }
+  SizeType num_threads() const {
+    return num_threads_;
+  }
+  SizeType run_size() const {
+    return run_size_;
+  }
+  // Number of inserted keys.
+  SizeType num_of_keys() const {
+    return num_of_keys_;
+  }
+  // Number of duplicate keys, which are resolved into other keys.
+  SizeType num_of_duplicates() const {
+    return num_of_duplicates_;
+  }
+  // Number of runs spilled to temporary files.
+  SizeType num_of_spilled_runs() const {
+    return num_of_spilled_runs_;
+  }
+  // Number of bytes used by the current run.
+  SizeType memory_usage() const {
+    return key_buf_.capacity() + sizeof(SizeType) *
+        (key_ends_.capacity() + order_.capacity()) +
+        sizeof(ValueType) * values_.capacity();
+  }
+
+  // Initializes a feeder and removes temporary files.
+  void Clear() {
+    ClearRuns();
+    num_of_keys_ = 0;
+    num_of_duplicates_ = 0;
+    num_of_spilled_runs_ = 0;
+  }
+
+  // Inserts a key in any order.
+  bool Insert(const CharType *key, ValueType value = 0) {
+    if (key == NULL || *key == '\0' || value < 0) {
+      return false;
+    }
+    SizeType length = 1;
+    while (key[length]) {
+      ++length;
+    }
+    return InsertKey(key, length, value);
+  }
+
+  // Inserts a key in any order.
+  bool Insert(const CharType *key, SizeType length, ValueType value) {
+    if (key == NULL || length <= 0 || value < 0) {
+      return false;
+    }
+    for (SizeType i = 0; i < length; ++i) {
+      if (key[i] == '\0') {
+        return false;
+      }
+    }
+    return InsertKey(key, length, value);
+  }
+
+  // Inserts sorted and deduplicated keys into a builder, whose Insert()
+  // is called as builder->Insert(key, length, value). Statistics are kept
+  // until Clear().
+  template <typename BUILDER_TYPE>
+  bool Feed(BUILDER_TYPE *builder) {
+    BuilderInserter<BUILDER_TYPE> inserter(builder);
+    bool is_fed = true;
+    if (run_file_names_.empty()) {
+      SortRun();
+      is_fed = ResolveRun(&inserter);
+    } else if (!key_ends_.empty() && !SpillRun()) {
+      is_fed = false;
+    } else {
+      is_fed = MergeRuns(&inserter);
+    }
+    ClearRuns();
+    return is_fed;
+  }
+
+ private:
+  const DuplicatePolicy policy_;
+  const SizeType num_threads_;
+  const SizeType run_size_;
+  const std::string temp_dir_;
+  std::vector<CharType> key_buf_;
+  std::vector<SizeType> key_ends_;
+  std::vector<ValueType> values_;
+  std::vector<SizeType> order_;
+  std::vector<std::string> run_file_names_;
+  SizeType num_of_keys_;
+  SizeType num_of_duplicates_;
+  SizeType num_of_spilled_runs_;
+
+  // Disallows copies.
+  SortedKeyFeeder(const SortedKeyFeeder &);
+  SortedKeyFeeder &operator=(const SortedKeyFeeder &);
+
+  // Inserts resolved keys into a builder.
+  template <typename BUILDER_TYPE>
+  class BuilderInserter {
+   public:
+    explicit BuilderInserter(BUILDER_TYPE *builder) : builder_(builder) {}
+
+    bool operator()(const CharType *key, SizeType length, ValueType value) {
+      return builder_->Insert(key, length, value);
+    }
+
+   private:
+    BUILDER_TYPE *builder_;
+  };
+
+  // Writes resolved keys to a run file as records of a length, a value
+  // and a key.
+  class RunWriter {
+   public:
+    explicit RunWriter(std::ostream *output) : output_(output) {}
+
+    bool operator()(const CharType *key, SizeType length, ValueType value) {
+      BaseType base_length = static_cast<BaseType>(length);
+      return output_->write(reinterpret_cast<const char *>(&base_length),
+                            sizeof(BaseType)) &&
+          output_->write(reinterpret_cast<const char *>(&value),
+                         sizeof(ValueType)) &&
+          output_->write(key, length);
+    }
+
+   private:
+    std::ostream *output_;
+  };
+
+  // Reads records of a run file in order.
+  class RunReader {
+   public:
+    RunReader() : input_(), key_(), value_(0) {}
+
+    const std::string &key() const {
+      return key_;
+    }
+    ValueType value() const {
+      return value_;
+    }
+
+    bool Open(const char *file_name) {
+      input_.open(file_name, std::ios::binary);
+      return input_.is_open();
+    }
+
+    // Reads the next record.
+    bool Next() {
+      BaseType length;
+      if (!input_.read(reinterpret_cast<char *>(&length), sizeof(BaseType)) ||
+          !input_.read(reinterpret_cast<char *>(&value_), sizeof(ValueType))) {
+        return false;
+      }
+      key_.resize(length);
+      return static_cast<bool>(input_.read(&key_[0], length));
+    }
+
+   private:
+    std::ifstream input_;
+    std::string key_;
+    ValueType value_;
+
+    // Disallows copies.
+    RunReader(const RunReader &);
+    RunReader &operator=(const RunReader &);
+  };
+
+  // For popping the smallest key of the earliest run first.
+  class RunComparer {
+   public:
+    explicit RunComparer(const std::vector<RunReader *> &readers)
+      : readers_(&readers) {}
+
+    bool operator()(SizeType lhs, SizeType rhs) const {
+      const std::string &lhs_key = (*readers_)[lhs]->key();
+      const std::string &rhs_key = (*readers_)[rhs]->key();
+      int result = Compare(lhs_key.data(), lhs_key.length(),
+                           rhs_key.data(), rhs_key.length());
+      return (result != 0) ? (result > 0) : (lhs > rhs);
+    }
+
+   private:
+    const std::vector<RunReader *> *readers_;
+  };
+
+  // For sorting keys of a run, and keys of the same content are sorted in
+  // order of insertion.
+  class KeyComparer {
+   public:
+    explicit KeyComparer(const SortedKeyFeeder &feeder) : feeder_(&feeder) {}
+
+    bool operator()(SizeType lhs, SizeType rhs) const {
+      int result = Compare(feeder_->key(lhs), feeder_->length(lhs),
+                           feeder_->key(rhs), feeder_->length(rhs));
+      return (result != 0) ? (result < 0) : (lhs < rhs);
+    }
+
+   private:
+    const SortedKeyFeeder *feeder_;
+  };
+
+  // Range of a run whose keys share their first labels, as many as its
+  // depth.
+  class Bucket {
+   public:
+    Bucket(SizeType begin, SizeType end, SizeType depth)
+      : begin_(begin), end_(end), depth_(depth) {}
+
+    SizeType begin() const {
+      return begin_;
+    }
+    SizeType end() const {
+      return end_;
+    }
+    SizeType depth() const {
+      return depth_;
+    }
+    SizeType size() const {
+      return end_ - begin_;
+    }
+
+   private:
+    SizeType begin_;
+    SizeType end_;
+    SizeType depth_;
+
+    // Copyable.
+  };
+
+  // Buckets of a run shared by worker threads. Each worker takes the next
+  // bucket, and either splits it by the next labels or sorts it. A large
+  // bucket is split into buckets for other workers, so keys which share a
+  // long prefix are also sorted in parallel.
+  class SortJob {
+   public:
+    SortJob(const SortedKeyFeeder &feeder, SizeType num_threads,
+            std::vector<SizeType> *order)
+      : feeder_(feeder), order_(order), buckets_(), num_of_busy_threads_(0),
+        min_split_size_(order->size() / (num_threads * 16)) {
+      if (min_split_size_ < MIN_SPLIT_SIZE) {
+        min_split_size_ = MIN_SPLIT_SIZE;
+      }
+      buckets_.push_back(Bucket(0, order->size(), 0));
+      ::pthread_mutex_init(&mutex_, NULL);
+      ::pthread_cond_init(&cond_, NULL);
+    }
+    ~SortJob() {
+      ::pthread_cond_destroy(&cond_);
+      ::pthread_mutex_destroy(&mutex_);
+    }
+
+    // Sorts buckets with worker threads and the calling thread.
+    void Run(SizeType num_threads) {
+      std::vector<pthread_t> threads;
+      for (SizeType i = 1; i < num_threads; ++i) {
+        pthread_t thread;
+        if (::pthread_create(&thread, NULL, &SortJob::Work, this) != 0) {
+          break;
+        }
+        threads.push_back(thread);
+      }
+      Work(this);
+      for (SizeType i = 0; i < threads.size(); ++i) {
+        ::pthread_join(threads[i], NULL);
+      }
+    }
+
+   private:
+    enum {
+      // Buckets of this size or smaller are sorted without being split.
+      MIN_SPLIT_SIZE = 1 << 10
+    };
+
+    const SortedKeyFeeder &feeder_;
+    std::vector<SizeType> *order_;
+    std::vector<Bucket> buckets_;
+    SizeType num_of_busy_threads_;
+    SizeType min_split_size_;
+    pthread_mutex_t mutex_;
+    pthread_cond_t cond_;
+
+    // Disallows copies.
+    SortJob(const SortJob &);
+    SortJob &operator=(const SortJob &);
+
+    // Takes buckets until no bucket is left and no busy thread may add
+    // a bucket.
+    static void *Work(void *arg) {
+      SortJob *job = static_cast<SortJob *>(arg);
+      std::vector<Bucket> sub_buckets;
+      ::pthread_mutex_lock(&job->mutex_);
+      for ( ; ; ) {
+        while (job->buckets_.empty() && job->num_of_busy_threads_ != 0) {
+          ::pthread_cond_wait(&job->cond_, &job->mutex_);
+        }
+        if (job->buckets_.empty()) {
+          break;
+        }
+        Bucket bucket = job->buckets_.back();
+        job->buckets_.pop_back();
+        ++job->num_of_busy_threads_;
+        ::pthread_mutex_unlock(&job->mutex_);
+
+        sub_buckets.clear();
+        if (bucket.size() > job->min_split_size_) {
+          job->Split(bucket, &sub_buckets);
+        } else {
+          std::sort(job->order_->begin() + bucket.begin(),
+                    job->order_->begin() + bucket.end(),
+                    KeyComparer(job->feeder_));
+        }
+
+        ::pthread_mutex_lock(&job->mutex_);
+        --job->num_of_busy_threads_;
+        job->buckets_.insert(job->buckets_.end(),
+                             sub_buckets.begin(), sub_buckets.end());
+        if (!sub_buckets.empty() || job->num_of_busy_threads_ == 0) {
+          ::pthread_cond_broadcast(&job->cond_);
+        }
+      }
+      ::pthread_mutex_unlock(&job->mutex_);
+      return NULL;
+    }
+
+    // Distributes keys of a bucket in place by their labels after their
+    // common prefix, as American flag sort does. Labels are cached so that
+    // keys are read only once. Keys which end there are the same, so they
+    // are sorted in order of insertion and come first.
+    void Split(const Bucket &bucket, std::vector<Bucket> *sub_buckets) {
+      std::vector<SizeType> &order = *order_;
+      SizeType depth = bucket.depth() + FindCommonPrefixLength(bucket);
+      std::vector<UCharType> labels(bucket.size());
+      SizeType heads[256];
+      SizeType ends[256];
+      for (SizeType i = 0; i < 256; ++i) {
+        ends[i] = 0;
+      }
+      for (SizeType i = 0; i < labels.size(); ++i) {
+        labels[i] = Label(order[bucket.begin() + i], depth);
+        ++ends[labels[i]];
+      }
+      SizeType end = 0;
+      for (SizeType i = 0; i < 256; ++i) {
+        heads[i] = end;
+        end += ends[i];
+        ends[i] = end;
+      }
+
+      for (SizeType i = 0; i < 256; ++i) {
+        while (heads[i] < ends[i]) {
+          UCharType label = labels[heads[i]];
+          if (label == i) {
+            ++heads[i];
+          } else {
+            std::swap(order[bucket.begin() + heads[i]],
+                      order[bucket.begin() + heads[label]]);
+            std::swap(labels[heads[i]], labels[heads[label]++]);
+          }
+        }
+      }
+
+      std::sort(order.begin() + bucket.begin(),
+                order.begin() + bucket.begin() + ends[0]);
+      for (SizeType i = 1; i < 256; ++i) {
+        if (ends[i] - ends[i - 1] > 1) {
+          sub_buckets->push_back(Bucket(bucket.begin() + ends[i - 1],
+                                        bucket.begin() + ends[i], depth + 1));
+        }
+      }
+    }
+
+    // Finds the length of a prefix which keys of a bucket share after its
+    // depth. Skipping it saves passes for keys which share a long prefix.
+    SizeType FindCommonPrefixLength(const Bucket &bucket) const {
+      const std::vector<SizeType> &order = *order_;
+      const CharType *first_key = feeder_.key(order[bucket.begin()]);
+      SizeType length = feeder_.length(order[bucket.begin()]) - bucket.depth();
+      for (SizeType i = bucket.begin() + 1;
+           i < bucket.end() && length != 0; ++i) {
+        const CharType *key = feeder_.key(order[i]);
+        SizeType max_length = feeder_.length(order[i]) - bucket.depth();
+        if (max_length < length) {
+          length = max_length;
+        }
+        SizeType j = 0;
+        while (j < length &&
+               key[bucket.depth() + j] == first_key[bucket.depth() + j]) {
+          ++j;
+        }
+        length = j;
+      }
+      return length;
+    }
+
+    // Gets a label of a key at a depth, or '\0' if the key ends there. Keys
+    // never have '\0' as a label.
+    UCharType Label(SizeType key_id, SizeType depth) const {
+      if (feeder_.length(key_id) <= depth) {
+        return '\0';
+      }
+      return static_cast<UCharType>(feeder_.key(key_id)[depth]);
+    }
+  };
+
+  const CharType *key(SizeType key_id) const {
+    return &key_buf_[(key_id != 0) ? key_ends_[key_id - 1] : 0];
+  }
+  SizeType length(SizeType key_id) const {
+    return key_ends_[key_id] - ((key_id != 0) ? key_ends_[key_id - 1] : 0);
+  }
+
+  // Appends a key to the current run, which is spilled if it is full.
+  bool InsertKey(const CharType *key, SizeType length, ValueType value) {
+    key_buf_.insert(key_buf_.end(), key, key + length);
+    key_ends_.push_back(key_buf_.size());
+    values_.push_back(value);
+    ++num_of_keys_;
+
+    if (key_buf_.size() + (sizeof(SizeType) * 2 + sizeof(ValueType)) *
+        key_ends_.size() >= run_size_) {
+      return SpillRun();
+    }
+    return true;
+  }
+
+  // Sorts keys of the current run. Keys are distributed to buckets by
+  // their labels, and then buckets are sorted in parallel.
+  void SortRun() {
+    std::vector<SizeType>(key_ends_.size()).swap(order_);
+    for (SizeType i = 0; i < order_.size(); ++i) {
+      order_[i] = i;
+    }
+
+    SortJob job(*this, num_threads_, &order_);
+    job.Run(num_threads_);
+  }
+
+  // Passes sorted keys of the current run to a writer, and values of
+  // duplicate keys are resolved by a policy.
+  template <typename WRITER_TYPE>
+  bool ResolveRun(WRITER_TYPE *writer) {
+    for (SizeType i = 0; i < order_.size(); ) {
+      SizeType key_id = order_[i];
+      ValueType value = values_[key_id];
+      for (++i; i < order_.size() && Compare(key(key_id), length(key_id),
+           key(order_[i]), length(order_[i])) == 0; ++i) {
+        value = Resolve(value, values_[order_[i]]);
+        ++num_of_duplicates_;
+      }
+      if (!(*writer)(key(key_id), length(key_id), value)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Sorts the current run and writes it to a temporary file.
+  bool SpillRun() {
+    SortRun();
+
+    std::string file_name;
+    if (!TempFile::Create(temp_dir_, &file_name)) {
+      return false;
+    }
+    run_file_names_.push_back(file_name);
+    ++num_of_spilled_runs_;
+
+    std::ofstream file(file_name.c_str(), std::ios::binary);
+    RunWriter writer(&file);
+    if (!ResolveRun(&writer) || !file.flush()) {
+      return false;
+    }
+    ClearRun();
+    return true;
+  }
+
+  // Merges runs and passes their keys to a writer.
+  template <typename WRITER_TYPE>
+  bool MergeRuns(WRITER_TYPE *writer) {
+    std::vector<RunReader *> readers(run_file_names_.size(), NULL);
+    std::priority_queue<SizeType, std::vector<SizeType>, RunComparer>
+        queue((RunComparer(readers)));
+    bool is_merged = true;
+    for (SizeType i = 0; i < readers.size(); ++i) {
+      readers[i] = new RunReader;
+      if (!readers[i]->Open(run_file_names_[i].c_str())) {
+        is_merged = false;
+      } else if (readers[i]->Next()) {
+        queue.push(i);
+      }
+    }
+
+    std::string key;
+    ValueType value = 0;
+    while (is_merged && !queue.empty()) {
+      SizeType run_id = queue.top();
+      queue.pop();
+      if (key.empty()) {
+        key = readers[run_id]->key();
+        value = readers[run_id]->value();
+      } else if (key == readers[run_id]->key()) {
+        value = Resolve(value, readers[run_id]->value());
+        ++num_of_duplicates_;
+      } else {
+        is_merged = (*writer)(key.data(), key.length(), value);
+        key = readers[run_id]->key();
+        value = readers[run_id]->value();
+      }
+
+      if (readers[run_id]->Next()) {
+        queue.push(run_id);
+      }
+    }
+    if (is_merged && !key.empty()) {
+      is_merged = (*writer)(key.data(), key.length(), value);
+    }
+
+    for (SizeType i = 0; i < readers.size(); ++i) {
+      delete readers[i];
+    }
+    return is_merged;
+  }
+
+  // Resolves a value of a key and a value of its later occurrence.
+  ValueType Resolve(ValueType value, ValueType later_value) const {
+    switch (policy_) {
+      case KEEP_FIRST: {
+        return value;
+      }
+      case KEEP_LAST: {
+        return later_value;
+      }
+      case KEEP_MAX: {
+        return std::max(value, later_value);
+      }
+      default: {
+        if (value > std::numeric_limits<ValueType>::max() - later_value) {
+          return std::numeric_limits<ValueType>::max();
+        }
+        return value + later_value;
+      }
+    }
+  }
+
+  // Frees memory for the current run.
+  void ClearRun() {
+    std::vector<CharType>(0).swap(key_buf_);
+    std::vector<SizeType>(0).swap(key_ends_);
+    std::vector<ValueType>(0).swap(values_);
+    std::vector<SizeType>(0).swap(order_);
+  }
+
+  // Frees memory for the current run and removes spilled runs.
+  void ClearRuns() {
+    ClearRun();
+    for (SizeType i = 0; i < run_file_names_.size(); ++i) {
+      std::remove(run_file_names_[i].c_str());
+    }
+    std::vector<std::string>(0).swap(run_file_names_);
+  }
+
+  // Compares keys as sequences of unsigned labels, as memcmp() does.
+  static int Compare(const CharType *lhs, SizeType lhs_length,
+                     const CharType *rhs, SizeType rhs_length) {
+    int result = std::memcmp(lhs, rhs, std::min(lhs_length, rhs_length));
+    if (result != 0) {
+      return result;
+    } else if (lhs_length != rhs_length) {
+      return (lhs_length < rhs_length) ? -1 : 1;
+    }
+    return 0;
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_SORTED_KEY_FEEDER_H
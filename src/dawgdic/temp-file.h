@@ -0,0 +1,48 @@
+#ifndef DAWGDIC_TEMP_FILE_H
+#define DAWGDIC_TEMP_FILE_H
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "base-types.h"
+
+namespace dawgdic {
+
+// Helpers for temporary files of builders, which are created in TMPDIR
+// or /tmp by default (POSIX only).
+class TempFile {
+ public:
+  // Gets a directory for temporary files. If dir is NULL or empty, TMPDIR
+  // or /tmp is used.
+  static std::string Dir(const char *dir = NULL) {
+    if (dir == NULL || *dir == '\0') {
+      dir = std::getenv("TMPDIR");
+    }
+    return (dir != NULL && *dir != '\0') ? dir : "/tmp";
+  }
+
+  // Creates an empty file with a unique name in a directory.
+  static bool Create(const std::string &dir, std::string *file_name) {
+    std::string name_template = dir + "/dawgdic-XXXXXX";
+    std::vector<char> name_buf(name_template.begin(), name_template.end());
+    name_buf.push_back('\0');
+    int fd = ::mkstemp(&name_buf[0]);
+    if (fd == -1) {
+      return false;
+    }
+    ::close(fd);
+    *file_name = &name_buf[0];
+    return true;
+  }
+
+ private:
+  // Disallows instantiation.
+  TempFile();
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_TEMP_FILE_H
@@ -0,0 +1,45 @@
+#ifndef DAWGDIC_TEXT_MATCH_H
+#define DAWGDIC_TEXT_MATCH_H
+
+#include "base-types.h"
+
+namespace dawgdic {
+
+// Occurrence of a key in a text.
+class TextMatch {
+ public:
+  TextMatch() : offset_(0), length_(0), value_(-1) {}
+  TextMatch(SizeType offset, SizeType length, ValueType value)
+    : offset_(offset), length_(length), value_(value) {}
+
+  void set_offset(SizeType offset) {
+    offset_ = offset;
+  }
+  void set_length(SizeType length) {
+    length_ = length;
+  }
+  void set_value(ValueType value) {
+    value_ = value;
+  }
+
+  SizeType offset() const {
+    return offset_;
+  }
+  SizeType length() const {
+    return length_;
+  }
+  ValueType value() const {
+    return value_;
+  }
+
+ private:
+  SizeType offset_;
+  SizeType length_;
+  ValueType value_;
+
+  // Copyable.
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_TEXT_MATCH_H
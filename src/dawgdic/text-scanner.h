@@ -0,0 +1,248 @@
+#ifndef DAWGDIC_TEXT_SCANNER_H
+#define DAWGDIC_TEXT_SCANNER_H
+
+#include <pthread.h>
+
+#include <vector>
+
+#include "dictionary.h"
+#include "text-match.h"
+
+namespace dawgdic {
+
+// Scanner for finding all the occurrences of keys in a text. A text is
+// split into chunks of start offsets, and a match starting in a chunk may
+// end in the following chunks, so chunks can be scanned independently.
+// Matches are passed to a sink, which is called as (*sink)(match), in
+// ascending order of offsets and then lengths. Transitions from the root
+// are looked up in a table, so an offset whose label does not start any key
+// costs one load. The table is built in the constructor, so a dictionary
+// must not be changed while a scanner is used.
+class TextScanner {
+ public:
+  enum {
+    // Default number of start offsets in a chunk.
+    DEFAULT_CHUNK_SIZE = 1 << 16,
+    // Number of chunks which may be scanned ahead per thread.
+    NUM_OF_CHUNKS_AHEAD = 4
+  };
+
+  explicit TextScanner(const Dictionary &dic,
+                       SizeType chunk_size = DEFAULT_CHUNK_SIZE)
+    : dic_(&dic), chunk_size_((chunk_size != 0) ? chunk_size : 1) {
+    for (SizeType label = 0; label < 256; ++label) {
+      BaseType index = dic.root();
+      first_indices_[label] =
+          (label != 0 && dic.Follow(static_cast<CharType>(label), &index)) ?
+          index : 0;
+    }
+  }
+
+  const Dictionary &dic() const {
+    return *dic_;
+  }
+  SizeType chunk_size() const {
+    return chunk_size_;
+  }
+
+  // Scans a text in the calling thread.
+  template <typename SINK_TYPE>
+  void Scan(const CharType *text, SizeType length, SINK_TYPE *sink) const {
+    ScanRange(text, length, 0, length, sink);
+  }
+
+  // Scans chunks of a text in worker threads, while the calling thread
+  // passes matches to a sink. If no thread can be created, the calling
+  // thread scans a text by itself.
+  template <typename SINK_TYPE>
+  void Scan(const CharType *text, SizeType length, SizeType num_threads,
+            SINK_TYPE *sink) const {
+    if (num_threads <= 1) {
+      Scan(text, length, sink);
+      return;
+    }
+
+    ScanJob job(*this, text, length, num_threads);
+    if (job.Start() == 0) {
+      Scan(text, length, sink);
+      return;
+    }
+
+    std::vector<TextMatch> matches;
+    for (SizeType chunk_id = 0; chunk_id < job.num_of_chunks(); ++chunk_id) {
+      job.Take(chunk_id, &matches);
+      for (SizeType i = 0; i < matches.size(); ++i) {
+        (*sink)(matches[i]);
+      }
+    }
+    job.Join();
+  }
+
+  // Finds matches which start in [begin, end) of a text.
+  template <typename SINK_TYPE>
+  void ScanRange(const CharType *text, SizeType length,
+                 SizeType begin, SizeType end, SINK_TYPE *sink) const {
+    for (SizeType offset = begin; offset < end; ++offset) {
+      BaseType index =
+          first_indices_[static_cast<UCharType>(text[offset])];
+      if (index == 0) {
+        continue;
+      }
+      if (dic_->has_value(index)) {
+        (*sink)(TextMatch(offset, 1, dic_->value(index)));
+      }
+      for (SizeType i = offset + 1; i < length; ++i) {
+        if (!dic_->Follow(text[i], &index)) {
+          break;
+        }
+        if (dic_->has_value(index)) {
+          (*sink)(TextMatch(offset, i + 1 - offset, dic_->value(index)));
+        }
+      }
+    }
+  }
+
+ private:
+  // Sink which appends matches to a vector.
+  class MatchAppender {
+   public:
+    explicit MatchAppender(std::vector<TextMatch> *matches)
+      : matches_(matches) {}
+
+    void operator()(const TextMatch &match) {
+      matches_->push_back(match);
+    }
+
+   private:
+    std::vector<TextMatch> *matches_;
+  };
+
+  // Chunks shared by worker threads. Each worker takes the next chunk,
+  // and the calling thread takes the results in order of chunks.
+  class ScanJob {
+   public:
+    ScanJob(const TextScanner &scanner, const CharType *text,
+            SizeType length, SizeType num_threads)
+      : scanner_(scanner), text_(text), length_(length),
+        num_of_chunks_((length + scanner.chunk_size() - 1) /
+                       scanner.chunk_size()),
+        max_chunks_ahead_(num_threads * NUM_OF_CHUNKS_AHEAD),
+        num_threads_(num_threads), threads_(), results_(num_of_chunks_),
+        is_done_(num_of_chunks_, false), next_chunk_id_(0),
+        num_of_taken_chunks_(0) {
+      ::pthread_mutex_init(&mutex_, NULL);
+      ::pthread_cond_init(&cond_, NULL);
+    }
+    ~ScanJob() {
+      Join();
+      ::pthread_cond_destroy(&cond_);
+      ::pthread_mutex_destroy(&mutex_);
+    }
+
+    SizeType num_of_chunks() const {
+      return num_of_chunks_;
+    }
+
+    // Starts worker threads and returns the number of started threads.
+    SizeType Start() {
+      for (SizeType i = 0; i < num_threads_; ++i) {
+        pthread_t thread;
+        if (::pthread_create(&thread, NULL, &ScanJob::Run, this) != 0) {
+          break;
+        }
+        threads_.push_back(thread);
+      }
+      return threads_.size();
+    }
+
+    // Waits for a chunk and takes its matches.
+    void Take(SizeType chunk_id, std::vector<TextMatch> *matches) {
+      ::pthread_mutex_lock(&mutex_);
+      while (!is_done_[chunk_id]) {
+        ::pthread_cond_wait(&cond_, &mutex_);
+      }
+      matches->swap(results_[chunk_id]);
+      std::vector<TextMatch>(0).swap(results_[chunk_id]);
+      ++num_of_taken_chunks_;
+      ::pthread_cond_broadcast(&cond_);
+      ::pthread_mutex_unlock(&mutex_);
+    }
+
+    // Waits for worker threads.
+    void Join() {
+      for (SizeType i = 0; i < threads_.size(); ++i) {
+        ::pthread_join(threads_[i], NULL);
+      }
+      threads_.clear();
+    }
+
+   private:
+    const TextScanner &scanner_;
+    const CharType *text_;
+    SizeType length_;
+    SizeType num_of_chunks_;
+    SizeType max_chunks_ahead_;
+    SizeType num_threads_;
+    std::vector<pthread_t> threads_;
+    std::vector<std::vector<TextMatch> > results_;
+    std::vector<bool> is_done_;
+    SizeType next_chunk_id_;
+    SizeType num_of_taken_chunks_;
+    pthread_mutex_t mutex_;
+    pthread_cond_t cond_;
+
+    // Disallows copies.
+    ScanJob(const ScanJob &);
+    ScanJob &operator=(const ScanJob &);
+
+    static void *Run(void *job) {
+      static_cast<ScanJob *>(job)->Work();
+      return NULL;
+    }
+
+    // Scans chunks until all the chunks are taken. A worker does not go
+    // too far ahead of the calling thread to bound memory usage.
+    void Work() {
+      std::vector<TextMatch> matches;
+      ::pthread_mutex_lock(&mutex_);
+      for ( ; ; ) {
+        while (next_chunk_id_ < num_of_chunks_ &&
+               next_chunk_id_ >= num_of_taken_chunks_ + max_chunks_ahead_) {
+          ::pthread_cond_wait(&cond_, &mutex_);
+        }
+        if (next_chunk_id_ >= num_of_chunks_) {
+          break;
+        }
+        SizeType chunk_id = next_chunk_id_++;
+        ::pthread_mutex_unlock(&mutex_);
+
+        SizeType begin = chunk_id * scanner_.chunk_size();
+        SizeType end = begin + scanner_.chunk_size();
+        if (end > length_) {
+          end = length_;
+        }
+        MatchAppender appender(&matches);
+        scanner_.ScanRange(text_, length_, begin, end, &appender);
+
+        ::pthread_mutex_lock(&mutex_);
+        results_[chunk_id].swap(matches);
+        is_done_[chunk_id] = true;
+        ::pthread_cond_broadcast(&cond_);
+        matches.clear();
+      }
+      ::pthread_mutex_unlock(&mutex_);
+    }
+  };
+
+  const Dictionary *dic_;
+  SizeType chunk_size_;
+  // Indices of states after the first labels, or 0 if the root has no
+  // transition with a label.
+  BaseType first_indices_[256];
+
+  // Copyable.
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_TEXT_SCANNER_H
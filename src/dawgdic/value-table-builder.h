@@ -0,0 +1,68 @@
+#ifndef DAWGDIC_VALUE_TABLE_BUILDER_H
+#define DAWGDIC_VALUE_TABLE_BUILDER_H
+
+#include "value-table.h"
+
+#include <map>
+#include <vector>
+
+namespace dawgdic {
+
+// Builder of a value table. Wide values are interned into dense ids, which
+// are inserted into a dawg as values of keys. Keys with the same wide value
+// share an id, so a dawg can merge their states.
+template <typename VALUE_TYPE>
+class ValueTableBuilder {
+ public:
+  typedef VALUE_TYPE WideValueType;
+
+  ValueTableBuilder() : units_(), id_map_() {}
+
+  // Number of distinct values.
+  SizeType size() const {
+    return units_.size();
+  }
+
+  // Gets the id of a wide value, which is assigned in order of appearance.
+  // Fails if there are too many distinct values for ValueType.
+  bool Intern(const WideValueType &value, ValueType *id) {
+    typename std::map<WideValueType, ValueType>::const_iterator it =
+        id_map_.find(value);
+    if (it != id_map_.end()) {
+      *id = it->second;
+      return true;
+    }
+
+    if (units_.size() > static_cast<SizeType>(~DictionaryUnit::IS_LEAF_BIT)) {
+      return false;
+    }
+    *id = static_cast<ValueType>(units_.size());
+    id_map_.insert(std::make_pair(value, *id));
+    units_.push_back(value);
+    return true;
+  }
+
+  // Moves interned values to a table.
+  void Finish(ValueTable<WideValueType> *table) {
+    table->SwapUnitsBuf(&units_);
+    Clear();
+  }
+
+  // Removes all values.
+  void Clear() {
+    std::vector<WideValueType>(0).swap(units_);
+    id_map_.clear();
+  }
+
+ private:
+  std::vector<WideValueType> units_;
+  std::map<WideValueType, ValueType> id_map_;
+
+  // Disallows copies.
+  ValueTableBuilder(const ValueTableBuilder &);
+  ValueTableBuilder &operator=(const ValueTableBuilder &);
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_VALUE_TABLE_BUILDER_H
@@ -0,0 +1,142 @@
+#ifndef DAWGDIC_VALUE_TABLE_H
+#define DAWGDIC_VALUE_TABLE_H
+
+#include "dictionary.h"
+
+#include <iostream>
+#include <vector>
+
+namespace dawgdic {
+
+// Array of fixed-width values, such as 64-bit ids, which are referred to
+// by values of a dictionary. A key is mapped to its wide value by one walk
+// of a dictionary and one access to this array.
+template <typename VALUE_TYPE>
+class ValueTable {
+ public:
+  typedef VALUE_TYPE WideValueType;
+
+  ValueTable() : units_(NULL), size_(0), units_buf_() {}
+
+  const WideValueType *units() const {
+    return units_;
+  }
+  SizeType size() const {
+    return size_;
+  }
+  SizeType total_size() const {
+    return sizeof(WideValueType) * size_;
+  }
+  SizeType file_size() const {
+    return sizeof(BaseType) + total_size();
+  }
+
+  // Gets a wide value from a value of a dictionary.
+  const WideValueType &value(ValueType id) const {
+    return units_[id];
+  }
+
+  // Exact matching.
+  bool Find(const Dictionary &dic, const CharType *key,
+            WideValueType *value) const {
+    ValueType id;
+    if (!dic.Find(key, &id) || static_cast<SizeType>(id) >= size_) {
+      return false;
+    }
+    *value = units_[id];
+    return true;
+  }
+  bool Find(const Dictionary &dic, const CharType *key, SizeType length,
+            WideValueType *value) const {
+    ValueType id;
+    if (!dic.Find(key, length, &id) || static_cast<SizeType>(id) >= size_) {
+      return false;
+    }
+    *value = units_[id];
+    return true;
+  }
+
+  // Reads a table from an input stream.
+  bool Read(std::istream *input) {
+    BaseType base_size;
+    if (!input->read(reinterpret_cast<char *>(&base_size), sizeof(BaseType))) {
+      return false;
+    }
+
+    SizeType size = static_cast<SizeType>(base_size);
+    std::vector<WideValueType> units_buf(size);
+    if (!input->read(reinterpret_cast<char *>(&units_buf[0]),
+                     sizeof(WideValueType) * size)) {
+      return false;
+    }
+
+    SwapUnitsBuf(&units_buf);
+    return true;
+  }
+
+  // Writes a table to an output stream.
+  bool Write(std::ostream *output) const {
+    BaseType base_size = static_cast<BaseType>(size_);
+    if (!output->write(reinterpret_cast<const char *>(&base_size),
+                       sizeof(BaseType))) {
+      return false;
+    }
+
+    if (!output->write(reinterpret_cast<const char *>(units_),
+                       sizeof(WideValueType) * size_)) {
+      return false;
+    }
+
+    return true;
+  }
+
+  // Maps memory with its size.
+  void Map(const void *address) {
+    Clear();
+    units_ = reinterpret_cast<const WideValueType *>(
+        static_cast<const BaseType *>(address) + 1);
+    size_ = *static_cast<const BaseType *>(address);
+  }
+  void Map(const void *address, SizeType size) {
+    Clear();
+    units_ = static_cast<const WideValueType *>(address);
+    size_ = size;
+  }
+
+  // Swaps tables.
+  void Swap(ValueTable *table) {
+    std::swap(units_, table->units_);
+    std::swap(size_, table->size_);
+    units_buf_.swap(table->units_buf_);
+  }
+
+  // Initializes a table.
+  void Clear() {
+    units_ = NULL;
+    size_ = 0;
+    std::vector<WideValueType>(0).swap(units_buf_);
+  }
+
+ public:
+  // Following member function is called from ValueTableBuilder.
+
+  // Swaps buffers for units.
+  void SwapUnitsBuf(std::vector<WideValueType> *units_buf) {
+    units_ = units_buf->empty() ? NULL : &(*units_buf)[0];
+    size_ = units_buf->size();
+    units_buf_.swap(*units_buf);
+  }
+
+ private:
+  const WideValueType *units_;
+  SizeType size_;
+  std::vector<WideValueType> units_buf_;
+
+  // Disallows copies.
+  ValueTable(const ValueTable &);
+  ValueTable &operator=(const ValueTable &);
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_VALUE_TABLE_H
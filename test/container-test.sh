@@ -0,0 +1,105 @@
+#! /bin/sh
+
+build_bin="${TOP_BUILDDIR:-..}/src/dawgdic-build"
+find_bin="${TOP_BUILDDIR:-..}/src/dawgdic-find"
+test_dir="${TOP_SRCDIR:-..}/test"
+
+if [ ! -f "$build_bin" ]
+then
+  echo "error: $build_bin: not found"
+  exit 1
+fi
+
+if [ ! -f "$find_bin" ]
+then
+  echo "error: $build_bin: not found"
+  exit 1
+fi
+
+## Builds a dictionary with a guide in container format.
+$build_bin -gtc "${test_dir}/lexicon" lexicon.dic
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Finds prefix keys and completes keys from a lexicon.
+$find_bin lexicon.dic < "${test_dir}/query" > dictionary-result
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+$find_bin -g lexicon.dic < "${test_dir}/query" > completer-result
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Builds a dictionary with a ranked guide in container format.
+$build_bin -rtc "${test_dir}/lexicon" lexicon.dic
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Completes ranked keys from a lexicon.
+$find_bin -r lexicon.dic < "${test_dir}/query" > ranked-completer-result
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Builds a dictionary with a best value table, which does not change
+## ranked completion.
+$build_bin -tb "${test_dir}/lexicon" lexicon.dic
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+$find_bin -r lexicon.dic < "${test_dir}/query" > best-value-result
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Builds a dictionary with an ordinal table.
+$build_bin -to "${test_dir}/lexicon" lexicon.dic
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Maps keys of a lexicon to their ordinals.
+$find_bin -o lexicon.dic < "${test_dir}/query" > ordinal-result
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Builds a dictionary with 64-bit values, and finds prefix keys.
+$build_bin -w "${test_dir}/lexicon" lexicon.dic
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+$find_bin -w lexicon.dic < "${test_dir}/query" > wide-result
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Checks the results.
+cmp dictionary-result "${test_dir}/dictionary-answer" &&
+cmp completer-result "${test_dir}/completer-answer" &&
+cmp ranked-completer-result "${test_dir}/ranked-completer-answer" &&
+cmp best-value-result "${test_dir}/ranked-completer-answer" &&
+cmp ordinal-result "${test_dir}/ordinal-answer" &&
+cmp wide-result "${test_dir}/dictionary-answer"
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Removes temporary files.
+rm -f lexicon.dic dictionary-result completer-result ranked-completer-result \
+  best-value-result ordinal-result wide-result
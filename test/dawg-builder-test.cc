@@ -1,11 +1,660 @@
+#include <pthread.h>
+
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
 #include <string>
+#include <vector>
 
+#include <dawgdic/block-arena.h>
+#include <dawgdic/completer.h>
 #include <dawgdic/dawg-builder.h>
 #include <dawgdic/dictionary-builder.h>
+#include <dawgdic/dictionary-handle.h>
+#include <dawgdic/external-dawg-builder.h>
+#include <dawgdic/external-dictionary-builder.h>
+#include <dawgdic/guide-builder.h>
+#include <dawgdic/live-dictionary.h>
+#include <dawgdic/ordinal-mapper.h>
+#include <dawgdic/ordinal-table-builder.h>
+#include <dawgdic/parallel-dawg-builder.h>
+#include <dawgdic/ranked-completer.h>
+#include <dawgdic/ranked-guide-builder.h>
+#include <dawgdic/sorted-key-feeder.h>
+#include <dawgdic/value-table-builder.h>
+
+namespace {
+
+// Checks if two dawgs have the same transitions and statistics. The right
+// one may be a PagedDawg.
+template <typename DAWG_TYPE>
+bool AreEqual(const dawgdic::Dawg &lhs, const DAWG_TYPE &rhs) {
+  if (lhs.size() != rhs.size() ||
+      lhs.num_of_states() != rhs.num_of_states() ||
+      lhs.num_of_merged_transitions() != rhs.num_of_merged_transitions() ||
+      lhs.num_of_merged_states() != rhs.num_of_merged_states() ||
+      lhs.num_of_merging_states() != rhs.num_of_merging_states()) {
+    return false;
+  }
+  for (dawgdic::BaseType i = 0; i < lhs.size(); ++i) {
+    if (lhs.label(i) != rhs.label(i) || lhs.value(i) != rhs.value(i) ||
+        lhs.sibling(i) != rhs.sibling(i) ||
+        lhs.is_merging(i) != rhs.is_merging(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Generates random keys whose first labels are in [a, f].
+void GenerateKeys(std::set<std::string> *keys) {
+  std::srand(0);
+  while (keys->size() < 4096) {
+    std::string key;
+    std::size_t length = 1 + std::rand() % 8;
+    for (std::size_t i = 0; i < length; ++i) {
+      key += static_cast<char>('a' + std::rand() % 6);
+    }
+    keys->insert(key);
+  }
+}
+
+// Builds a dawg of random keys in parallel, and compares it with a dawg
+// built by DawgBuilder.
+void TestParallelBuild(std::size_t num_threads) {
+  std::set<std::string> keys;
+  GenerateKeys(&keys);
+
+  dawgdic::DawgBuilder dawg_builder;
+  dawgdic::ParallelDawgBuilder parallel_builder(num_threads);
+  dawgdic::ValueType value = 0;
+  for (std::set<std::string>::const_iterator it = keys.begin();
+       it != keys.end(); ++it) {
+    assert(dawg_builder.Insert(it->c_str(), value % 16));
+    assert(parallel_builder.Insert(it->c_str(), value % 16));
+    ++value;
+  }
+  assert(!parallel_builder.Insert("aa"));
+  assert(parallel_builder.num_of_keys() == keys.size());
+
+  dawgdic::Dawg dawg;
+  dawg_builder.Finish(&dawg);
+  dawgdic::Dawg parallel_dawg;
+  assert(parallel_builder.Finish(&parallel_dawg));
+  assert(AreEqual(dawg, parallel_dawg));
+}
+
+// Builds a dictionary and guides of very long keys. This runs on a thread
+// with a small stack, which builders must not overflow.
+void *TestDeepKeys(void *) {
+  const std::size_t DEPTH = 1 << 16;
+  std::string keys[3];
+  keys[0] = std::string(DEPTH, 'a') + 'b';
+  keys[1] = std::string(DEPTH, 'a') + 'c';
+  keys[2] = std::string(DEPTH / 2, 'a') + 'd';
+
+  dawgdic::DawgBuilder dawg_builder;
+  for (std::size_t i = 0; i < 3; ++i) {
+    assert(dawg_builder.Insert(keys[i].c_str(),
+                               static_cast<dawgdic::ValueType>(i)));
+  }
+  dawgdic::Dawg dawg;
+  assert(dawg_builder.Finish(&dawg));
+
+  dawgdic::BuildProgress progress;
+  dawgdic::Dictionary dic;
+  assert(dawgdic::DictionaryBuilder::Build(dawg, &dic, NULL, &progress));
+  assert(progress.num_of_states() == dawg.num_of_states());
+  assert(progress.num_of_visited_states() >= DEPTH);
+  assert(progress.max_depth() >= DEPTH);
+  assert(dic.Find(keys[2].c_str()) == 2);
+
+  dawgdic::Guide guide;
+  assert(dawgdic::GuideBuilder::Build(dawg, dic, &guide, &progress));
+  assert(progress.max_depth() >= DEPTH);
+  dawgdic::Completer completer(dic, guide);
+  completer.Start(dic.root());
+  assert(completer.Next() && completer.key() == keys[0]);
+
+  dawgdic::RankedGuide ranked_guide;
+  assert(dawgdic::RankedGuideBuilder::Build(dawg, dic, &ranked_guide,
+                                            &progress));
+  assert(progress.max_depth() >= DEPTH);
+  dawgdic::RankedCompleter ranked_completer(dic, ranked_guide);
+  ranked_completer.Start(dic.root());
+  assert(ranked_completer.Next() && ranked_completer.key() == keys[2]);
+
+  dawgdic::OrdinalTable table;
+  assert(dawgdic::OrdinalTableBuilder::Build(dawg, dic, &table, &progress));
+  assert(progress.max_depth() >= DEPTH);
+  dawgdic::OrdinalMapper mapper(dic, table);
+  dawgdic::BaseType id = 0;
+  assert(mapper.Rank(keys[1].c_str(), &id) && id == 1);
+  return NULL;
+}
+
+// Builds a dictionary of random keys with many labels, whose nodes have
+// many children, and finds all the keys.
+void TestWideDictionary() {
+  std::set<std::string> keys;
+  std::srand(1);
+  while (keys.size() < 4096) {
+    std::string key;
+    std::size_t length = 1 + std::rand() % 4;
+    for (std::size_t i = 0; i < length; ++i) {
+      key += static_cast<char>(1 + std::rand() % 255);
+    }
+    keys.insert(key);
+  }
+
+  dawgdic::DawgBuilder dawg_builder;
+  dawgdic::ValueType value = 0;
+  for (std::set<std::string>::const_iterator it = keys.begin();
+       it != keys.end(); ++it) {
+    assert(dawg_builder.Insert(it->c_str(), value++));
+  }
+  dawgdic::Dawg dawg;
+  assert(dawg_builder.Finish(&dawg));
+  dawgdic::Dictionary dic;
+  assert(dawgdic::DictionaryBuilder::Build(dawg, &dic));
+
+  value = 0;
+  for (std::set<std::string>::const_iterator it = keys.begin();
+       it != keys.end(); ++it) {
+    assert(dic.Find(it->c_str()) == value++);
+  }
+  assert(!dic.Contains("\x01\x01\x01\x01\x01"));
+}
+
+// Builds a dawg of random keys from a tiny hash table, which is expanded
+// and migrated many times, and compares it with a dawg built from a large
+// hash table.
+void TestHashTable() {
+  std::set<std::string> keys;
+  GenerateKeys(&keys);
+
+  dawgdic::DawgBuilder dawg_builder(1 << 16);
+  dawgdic::DawgBuilder tiny_builder(1);
+  dawgdic::ValueType value = 0;
+  for (std::set<std::string>::const_iterator it = keys.begin();
+       it != keys.end(); ++it) {
+    assert(dawg_builder.Insert(it->c_str(), value % 16));
+    assert(tiny_builder.Insert(it->c_str(), value % 16));
+    ++value;
+  }
+
+  dawgdic::Dawg dawg;
+  assert(dawg_builder.Finish(&dawg));
+  dawgdic::Dawg tiny_dawg;
+  assert(tiny_builder.Finish(&tiny_dawg));
+  assert(AreEqual(dawg, tiny_dawg));
+
+  // Statistics are kept after Finish().
+  assert(dawg_builder.num_of_expansions() == 0);
+  assert(dawg_builder.num_of_rehashed_states() == 0);
+  assert(tiny_builder.num_of_expansions() > 8);
+  assert(tiny_builder.num_of_rehashed_states() > 0);
+  assert(tiny_builder.num_of_lookups() == dawg_builder.num_of_lookups());
+  assert(tiny_builder.num_of_probes() >= tiny_builder.num_of_lookups());
+  assert(tiny_builder.max_probe_length() >= 1);
+  assert(tiny_builder.rehash_time() >= 0.0);
+}
+
+// Builds a dictionary with an access profile, and checks that units on the
+// paths of profiled keys are packed into the hot region.
+void TestHotRegion() {
+  std::set<std::string> keys;
+  GenerateKeys(&keys);
+
+  dawgdic::DawgBuilder dawg_builder;
+  dawgdic::AccessProfile profile;
+  dawgdic::SizeType key_id = 0;
+  for (std::set<std::string>::const_iterator it = keys.begin();
+       it != keys.end(); ++it, ++key_id) {
+    assert(dawg_builder.Insert(it->c_str()));
+    if (key_id % 64 == 0) {
+      profile.Add(it->c_str());
+    }
+  }
+  dawgdic::Dawg dawg;
+  assert(dawg_builder.Finish(&dawg));
+
+  const dawgdic::SizeType hot_region_size =
+      dawgdic::DictionaryBuilder::BLOCK_SIZE * 4;
+  dawgdic::Dictionary dic, cold_dic;
+  assert(dawgdic::DictionaryBuilder::Build(dawg, profile, &dic, NULL,
+                                           hot_region_size));
+  assert(dawgdic::DictionaryBuilder::Build(dawg, &cold_dic));
+
+  // Paths of profiled keys stay in the hot region and its last block, which
+  // is shared with cold units, while they spread out without a profile.
+  const dawgdic::SizeType max_index =
+      hot_region_size + dawgdic::DictionaryBuilder::BLOCK_SIZE;
+  dawgdic::BaseType max_cold_index = 0;
+  for (dawgdic::SizeType i = 0; i < profile.size(); ++i) {
+    const dawgdic::CharType *key =
+        reinterpret_cast<const dawgdic::CharType *>(profile.key(i));
+    dawgdic::BaseType index = dic.root();
+    dawgdic::BaseType cold_index = cold_dic.root();
+    for (dawgdic::SizeType j = 0; j < profile.length(i); ++j) {
+      assert(dic.Follow(key[j], &index));
+      assert(index < max_index);
+      assert(cold_dic.Follow(key[j], &cold_index));
+      max_cold_index = std::max(max_cold_index, cold_index);
+    }
+    assert(dic.has_value(index));
+    assert(dic.value(index) == cold_dic.value(cold_index));
+  }
+  assert(max_cold_index >= max_index);
+}
+
+// Builds a dawg and a dictionary of random keys within memory budgets, and
+// compares them with those built in memory. All the keys share a prefix, so
+// batches are spilled in the middle of keys.
+void TestExternalBuild(dawgdic::SizeType memory_budget) {
+  std::set<std::string> keys;
+  GenerateKeys(&keys);
+
+  dawgdic::DawgBuilder dawg_builder;
+  dawgdic::ExternalDawgBuilder external_builder(memory_budget);
+  dawgdic::AccessProfile profile;
+  dawgdic::ValueType value = 0;
+  for (std::set<std::string>::const_iterator it = keys.begin();
+       it != keys.end(); ++it) {
+    std::string key = "/usr/" + *it;
+    assert(dawg_builder.Insert(key.c_str(), value % 16));
+    assert(external_builder.Insert(key.c_str(), value % 16));
+    if (value % 64 == 0) {
+      profile.Add(key.c_str());
+    }
+    ++value;
+  }
+  assert(!external_builder.Insert("/usr/aa"));
+
+  dawgdic::Dawg dawg;
+  assert(dawg_builder.Finish(&dawg));
+  dawgdic::PagedDawg external_dawg;
+  assert(external_builder.Finish(&external_dawg));
+  assert(external_builder.num_of_spilled_batches() > 1);
+  assert(external_builder.num_of_partitions() >= 1);
+  assert(AreEqual(dawg, external_dawg));
+  assert(!external_dawg.has_error());
+
+  // A dawg written in the same format can also be mapped.
+  std::ostringstream dawg_stream;
+  assert(dawg.Write(&dawg_stream));
+  std::string dawg_bytes = dawg_stream.str();
+  dawgdic::Dawg mapped_dawg;
+  mapped_dawg.Map(dawg_bytes.data());
+  assert(AreEqual(dawg, mapped_dawg));
+
+  // A dictionary is written while it is built from the paged dawg, which
+  // shares the budget.
+  dawgdic::Dictionary dic;
+  assert(dawgdic::DictionaryBuilder::Build(dawg, &dic));
+  std::ostringstream dic_stream;
+  assert(dic.Write(&dic_stream));
+  dawgdic::ExternalDictionaryBuilder dic_builder(
+      std::max(memory_budget, external_dawg.memory_usage()) -
+      external_dawg.memory_usage());
+  std::ostringstream external_dic_stream;
+  assert(dic_builder.Build(external_dawg, &external_dic_stream));
+  assert(dic_builder.num_of_units() == dic.size());
+  assert(external_dic_stream.str() == dic_stream.str());
+
+  const dawgdic::SizeType hot_region_size =
+      dawgdic::DictionaryBuilder::BLOCK_SIZE * 4;
+  assert(dawgdic::DictionaryBuilder::Build(dawg, profile, &dic, NULL,
+                                           hot_region_size));
+  dic_stream.str("");
+  assert(dic.Write(&dic_stream));
+  external_dic_stream.str("");
+  assert(dic_builder.Build(external_dawg, profile, &external_dic_stream,
+                           hot_region_size));
+  assert(external_dic_stream.str() == dic_stream.str());
+
+  // Buffers of passes exceed a tiny budget, but not a larger one.
+  if (memory_budget >= (1 << 17)) {
+    assert(external_builder.is_within_budget());
+    assert(external_dawg.memory_usage() + dic_builder.peak_memory_usage() <=
+           memory_budget);
+  }
+}
+
+// Sorts shuffled keys with duplicates, and compares a dawg built from them
+// with a dawg built from sorted keys. All the keys start with a prefix.
+void TestSortedKeyFeeder(dawgdic::SortedKeyFeeder::DuplicatePolicy policy,
+                         std::size_t num_threads, std::size_t run_size,
+                         const std::string &prefix) {
+  std::set<std::string> key_set;
+  GenerateKeys(&key_set);
+  std::vector<std::string> keys;
+  for (int i = 0; i < 2; ++i) {
+    for (std::set<std::string>::const_iterator it = key_set.begin();
+         it != key_set.end(); ++it) {
+      keys.push_back(prefix + *it);
+    }
+  }
+  for (std::size_t i = keys.size(); i > 1; --i) {
+    std::swap(keys[i - 1], keys[std::rand() % i]);
+  }
+
+  dawgdic::SortedKeyFeeder feeder(policy, num_threads, run_size);
+  std::map<std::string, dawgdic::ValueType> values;
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    dawgdic::ValueType value = static_cast<dawgdic::ValueType>(i % 100);
+    assert(feeder.Insert(keys[i].c_str(), value));
+
+    std::map<std::string, dawgdic::ValueType>::iterator it =
+        values.find(keys[i]);
+    if (it == values.end()) {
+      values[keys[i]] = value;
+    } else if (policy == dawgdic::SortedKeyFeeder::KEEP_LAST) {
+      it->second = value;
+    } else if (policy == dawgdic::SortedKeyFeeder::KEEP_MAX) {
+      it->second = std::max(it->second, value);
+    } else if (policy == dawgdic::SortedKeyFeeder::SUM_VALUES) {
+      it->second += value;
+    }
+  }
+  assert(!feeder.Insert(""));
+
+  dawgdic::DawgBuilder dawg_builder;
+  for (std::map<std::string, dawgdic::ValueType>::const_iterator it =
+       values.begin(); it != values.end(); ++it) {
+    assert(dawg_builder.Insert(it->first.c_str(), it->second));
+  }
+  dawgdic::Dawg dawg;
+  dawg_builder.Finish(&dawg);
+
+  dawgdic::DawgBuilder fed_builder;
+  assert(feeder.Feed(&fed_builder));
+  assert(feeder.num_of_keys() == keys.size());
+  assert(feeder.num_of_duplicates() == keys.size() - values.size());
+  dawgdic::Dawg fed_dawg;
+  fed_builder.Finish(&fed_dawg);
+  assert(AreEqual(dawg, fed_dawg));
+}
+
+typedef std::map<std::string, dawgdic::ValueType> KeyValueMap;
+
+// Checks if a live dictionary has the same keys as a map.
+void CheckLiveDictionary(const dawgdic::LiveDictionary &dic,
+                         const KeyValueMap &answers, const char *prefix) {
+  for (KeyValueMap::const_iterator it = answers.begin();
+       it != answers.end(); ++it) {
+    dawgdic::ValueType value = -1;
+    assert(dic.Find(it->first.c_str(), &value) && value == it->second);
+  }
+
+  std::vector<dawgdic::LiveDictionary::ResultType> expected;
+  std::string prefix_str(prefix);
+  for (KeyValueMap::const_iterator it = answers.lower_bound(prefix_str);
+       it != answers.end() && it->first.compare(
+           0, prefix_str.length(), prefix_str) == 0; ++it) {
+    expected.push_back(*it);
+  }
+
+  std::vector<dawgdic::LiveDictionary::ResultType> results;
+  assert(dic.Complete(prefix, expected.size() + 1, &results) ==
+         expected.size());
+  assert(results == expected);
+  assert(dic.Complete(prefix, 3, &results) == std::min(
+      expected.size(), static_cast<std::size_t>(3)));
+
+  // Ties of values may be in any order.
+  const std::size_t MAX_NUM_OF_RESULTS = 10;
+  assert(dic.CompleteRanked(prefix, MAX_NUM_OF_RESULTS, &results));
+  std::vector<dawgdic::ValueType> values;
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    values.push_back(expected[i].second);
+  }
+  std::sort(values.begin(), values.end());
+  std::reverse(values.begin(), values.end());
+  values.resize(std::min(values.size(), MAX_NUM_OF_RESULTS));
+  assert(results.size() == values.size());
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    assert(results[i].second == values[i]);
+    KeyValueMap::const_iterator it = answers.find(results[i].first);
+    assert(it != answers.end() && it->second == results[i].second);
+  }
+}
+
+void *UpdateLiveDictionary(void *arg) {
+  dawgdic::LiveDictionary *dic = static_cast<dawgdic::LiveDictionary *>(arg);
+  for (int i = 0; i < 2048; ++i) {
+    std::ostringstream key;
+    key << 'g' << i;
+    assert(dic->Insert(key.str().c_str(), i));
+  }
+  return NULL;
+}
+
+// Updates a live dictionary of random keys, and compares it with a map
+// before and after compactions.
+void TestLiveDictionary() {
+  std::set<std::string> keys;
+  GenerateKeys(&keys);
+
+  dawgdic::DawgBuilder dawg_builder;
+  KeyValueMap answers;
+  dawgdic::ValueType value = 0;
+  for (std::set<std::string>::const_iterator it = keys.begin();
+       it != keys.end(); ++it) {
+    assert(dawg_builder.Insert(it->c_str(), value % 16));
+    answers[*it] = value++ % 16;
+  }
+  dawgdic::Dawg dawg;
+  assert(dawg_builder.Finish(&dawg));
+
+  dawgdic::LiveDictionary dic(true);
+  assert(dic.Build(dawg));
+  CheckLiveDictionary(dic, answers, "ab");
+
+  // Updates, insertions and removals.
+  for (int i = 0; i < 1024; ++i) {
+    std::string key;
+    std::size_t length = 1 + std::rand() % 8;
+    for (std::size_t j = 0; j < length; ++j) {
+      key += static_cast<char>('a' + std::rand() % 7);
+    }
+    if (std::rand() % 3 == 0) {
+      assert(dic.Remove(key.c_str()) == (answers.erase(key) != 0));
+    } else {
+      assert(dic.Insert(key.c_str(), i % 32));
+      answers[key] = i % 32;
+    }
+  }
+  assert(!dic.Insert(""));
+  assert(!dic.Insert("apple", -1));
+  assert(!dic.Contains("apple pie"));
+  assert(dic.num_of_updates() > 0);
+  CheckLiveDictionary(dic, answers, "");
+  CheckLiveDictionary(dic, answers, "ab");
+  CheckLiveDictionary(dic, answers, "g");
+
+  assert(dic.Compact());
+  assert(dic.num_of_updates() == 0 && dic.num_of_compactions() == 1);
+  CheckLiveDictionary(dic, answers, "");
+  CheckLiveDictionary(dic, answers, "ab");
+
+  // Compactions in background while a thread inserts keys.
+  assert(dic.StartCompaction(1));
+  assert(!dic.StartCompaction(1));
+  pthread_t thread;
+  assert(::pthread_create(&thread, NULL, &UpdateLiveDictionary, &dic) == 0);
+  assert(::pthread_join(thread, NULL) == 0);
+  dic.StopCompaction();
+  for (int i = 0; i < 2048; ++i) {
+    std::ostringstream key;
+    key << 'g' << i;
+    answers[key.str()] = i;
+  }
+  CheckLiveDictionary(dic, answers, "g1");
+
+  assert(dic.Compact());
+  assert(dic.num_of_updates() == 0);
+  CheckLiveDictionary(dic, answers, "");
+
+  // A dictionary without a ranked guide.
+  dawgdic::LiveDictionary unranked_dic;
+  std::vector<dawgdic::LiveDictionary::ResultType> results;
+  assert(unranked_dic.Complete("", 10, &results) == 0);
+  assert(unranked_dic.Insert("apple"));
+  assert(unranked_dic.Complete("a", 10, &results) == 1);
+  assert(!unranked_dic.CompleteRanked("a", 10, &results));
+  assert(unranked_dic.Compact());
+  assert(unranked_dic.Contains("apple") && !unranked_dic.Remove("banana"));
+}
+
+// Builds a set whose keys have the same value.
+dawgdic::DictionarySet *BuildDictionarySet(dawgdic::ValueType value) {
+  dawgdic::DawgBuilder dawg_builder;
+  assert(dawg_builder.Insert("apple", value));
+  assert(dawg_builder.Insert("cherry", value));
+  dawgdic::Dawg dawg;
+  assert(dawg_builder.Finish(&dawg));
+
+  dawgdic::Dictionary dic;
+  assert(dawgdic::DictionaryBuilder::Build(dawg, &dic));
+  dawgdic::Guide guide;
+  assert(dawgdic::GuideBuilder::Build(dawg, dic, &guide));
+
+  dawgdic::DictionarySet *set = new dawgdic::DictionarySet;
+  set->Swap(&dic, &guide);
+  return set;
+}
+
+bool is_handle_test_done = false;
+
+// Reads sets from a handle until the test is done. All the keys of a set
+// must have the same value.
+void *ReadDictionaryHandle(void *arg) {
+  const dawgdic::DictionaryHandle *handle =
+      static_cast<const dawgdic::DictionaryHandle *>(arg);
+  while (!__atomic_load_n(&is_handle_test_done, __ATOMIC_ACQUIRE)) {
+    dawgdic::DictionaryHandle::Snapshot snapshot(*handle);
+    if (!snapshot.set().has_dic()) {
+      continue;
+    }
+    dawgdic::ValueType value = snapshot.dic().Find("apple");
+    assert(value >= 0);
+    assert(snapshot.dic().Find("cherry") == value);
+    assert(snapshot.set().has_guide());
+  }
+  return NULL;
+}
+
+// Replaces sets of a handle while threads read them.
+void TestDictionaryHandle() {
+  dawgdic::DictionaryHandle handle;
+  {
+    dawgdic::DictionaryHandle::Snapshot snapshot(handle);
+    assert(!snapshot.set().has_dic());
+  }
+
+  const int NUM_OF_READERS = 4;
+  pthread_t threads[NUM_OF_READERS];
+  for (int i = 0; i < NUM_OF_READERS; ++i) {
+    assert(::pthread_create(&threads[i], NULL, &ReadDictionaryHandle,
+                            &handle) == 0);
+  }
+  for (int i = 0; i < 256; ++i) {
+    handle.Reset(BuildDictionarySet(i));
+  }
+  __atomic_store_n(&is_handle_test_done, true, __ATOMIC_RELEASE);
+  for (int i = 0; i < NUM_OF_READERS; ++i) {
+    assert(::pthread_join(threads[i], NULL) == 0);
+  }
+  assert(handle.num_of_resets() == 256);
+
+  // A set is mapped from a raw file of a dictionary and a guide.
+  dawgdic::DictionarySet *set = BuildDictionarySet(7);
+  {
+    std::ofstream file("dictionary-handle.dic", std::ios::binary);
+    assert(set->dic().Write(&file) && set->guide().Write(&file));
+  }
+  delete set;
+  assert(handle.Open("dictionary-handle.dic"));
+  assert(!handle.Open("dictionary-handle.none"));
+  std::remove("dictionary-handle.dic");
+
+  dawgdic::DictionaryHandle::Snapshot snapshot(handle);
+  assert(snapshot.set().file().is_open());
+  assert(snapshot.dic().Find("cherry") == 7);
+  dawgdic::Completer completer(snapshot.dic(), snapshot.guide());
+  completer.Start(snapshot.dic().root());
+  assert(completer.Next() && completer.key() == std::string("apple"));
+}
+
+// Builds small dawgs many times with an arena and small blocks, and
+// compares them with a dawg built with the default allocator.
+void TestBlockArena() {
+  std::set<std::string> keys;
+  GenerateKeys(&keys);
+
+  dawgdic::DawgBuilder dawg_builder;
+  for (std::set<std::string>::const_iterator it = keys.begin();
+       it != keys.end(); ++it) {
+    assert(dawg_builder.Insert(it->c_str()));
+  }
+  dawgdic::Dawg dawg;
+  assert(dawg_builder.Finish(&dawg));
+
+  dawgdic::BlockArena arena;
+  std::size_t num_of_blocks = 0;
+  for (int i = 0; i < 8; ++i) {
+    dawgdic::DawgBuilder arena_builder(1 << 8, &arena, 1 << 6);
+    for (std::set<std::string>::const_iterator it = keys.begin();
+         it != keys.end(); ++it) {
+      assert(arena_builder.Insert(it->c_str()));
+    }
+    dawgdic::Dawg arena_dawg;
+    assert(arena_builder.Finish(&arena_dawg));
+    assert(AreEqual(dawg, arena_dawg));
+    assert(arena_dawg.memory_usage() < dawg.memory_usage());
+
+    // Later builds take all their blocks from the arena.
+    if (i == 0) {
+      num_of_blocks = arena.num_of_blocks();
+    }
+    assert(arena.num_of_blocks() == num_of_blocks);
+  }
+  assert(arena.num_of_reuses() > 0);
+  assert(arena.num_of_free_blocks() == arena.num_of_blocks());
+
+  // A reset pool keeps its blocks.
+  dawgdic::ObjectPool<int> pool(&arena, 100);
+  assert(pool.block_size() == 128);
+  for (int i = 0; i < 1000; ++i) {
+    pool[pool.Allocate()] = i;
+  }
+  std::size_t memory_usage = pool.memory_usage();
+  num_of_blocks = arena.num_of_blocks();
+  pool.Reset();
+  assert(pool.size() == 0 && pool.memory_usage() == memory_usage);
+  for (int i = 0; i < 1000; ++i) {
+    assert(pool[pool.Allocate()] == 0);
+  }
+  assert(arena.num_of_blocks() == num_of_blocks);
+  pool.Clear();
+  assert(arena.num_of_free_blocks() == arena.num_of_blocks());
+  arena.Clear();
+  assert(arena.num_of_blocks() == 0 && arena.memory_usage() == 0);
+}
+
+}  // namespace
 
 int main() {
+  // Units of a builder are packed.
+  assert(sizeof(dawgdic::DawgUnit) == 8);
+
   dawgdic::DawgBuilder dawg_builder;
   assert(dawg_builder.Insert("apple"));
   assert(dawg_builder.Insert("cherry"));
@@ -28,5 +677,93 @@ int main() {
   assert(dawg_dic.Contains("green"));
   assert(dawg_dic.Contains("mandarin"));
 
+  dawgdic::PrefixMatch matches[2];
+  assert(dawg_dic.CommonPrefixSearch("apple pie", matches, 2) == 1);
+  assert(matches[0].length() == 5);
+  assert(dawg_dic.CommonPrefixSearch("mandarin orange", 8, matches, 2) == 1);
+  assert(matches[0].length() == 8 && matches[0].value() == 0);
+  assert(dawg_dic.CommonPrefixSearch("banana", matches, 2) == 0);
+  assert(dawg_dic.LongestPrefixMatch("greenery", matches));
+  assert(matches[0].length() == 5);
+  assert(!dawg_dic.LongestPrefixMatch("durian", 5, matches));
+
+  // Keys with 64-bit values, which are interned into a value table.
+  dawgdic::ValueTableBuilder<dawgdic::UInt64Type> value_builder;
+  dawgdic::ValueType value_ids[3];
+  assert(value_builder.Intern(1ULL << 40, &value_ids[0]));
+  assert(value_builder.Intern(~0ULL, &value_ids[1]));
+  assert(value_builder.Intern(1ULL << 40, &value_ids[2]));
+  assert(value_ids[0] == value_ids[2] && value_builder.size() == 2);
+
+  dawgdic::DawgBuilder wide_dawg_builder;
+  assert(wide_dawg_builder.Insert("fig", value_ids[0]));
+  assert(wide_dawg_builder.Insert("grape", value_ids[1]));
+  assert(wide_dawg_builder.Insert("kiwi", value_ids[2]));
+  dawgdic::Dawg wide_dawg;
+  wide_dawg_builder.Finish(&wide_dawg);
+
+  dawgdic::Dictionary wide_dic;
+  dawgdic::DictionaryBuilder::Build(wide_dawg, &wide_dic);
+  dawgdic::ValueTable<dawgdic::UInt64Type> wide_values;
+  value_builder.Finish(&wide_values);
+
+  dawgdic::UInt64Type wide_value = 0;
+  assert(wide_values.Find(wide_dic, "grape", &wide_value));
+  assert(wide_value == ~0ULL);
+  assert(wide_values.Find(wide_dic, "kiwi", 4, &wide_value));
+  assert(wide_value == 1ULL << 40);
+  assert(!wide_values.Find(wide_dic, "banana", &wide_value));
+
+  // Builders must not recurse for each label of keys.
+  pthread_attr_t attr;
+  assert(::pthread_attr_init(&attr) == 0);
+  assert(::pthread_attr_setstacksize(&attr, 1 << 16) == 0);
+  pthread_t thread;
+  assert(::pthread_create(&thread, &attr, &TestDeepKeys, NULL) == 0);
+  assert(::pthread_join(thread, NULL) == 0);
+  ::pthread_attr_destroy(&attr);
+
+  // Offsets of nodes with many children must not collide.
+  TestWideDictionary();
+
+  // Expansions of a hash table must not change a dawg.
+  TestHashTable();
+
+  // Blocks of dawgs are reused through an arena.
+  TestBlockArena();
+
+  // Profiled keys are packed into the hot region of a dictionary.
+  TestHotRegion();
+
+  // Dawgs built in parallel must be the same as those of DawgBuilder.
+  TestParallelBuild(1);
+  TestParallelBuild(2);
+  TestParallelBuild(3);
+
+  // Dawgs built within a memory budget must be the same.
+  TestExternalBuild(1 << 10);
+  TestExternalBuild(1 << 17);
+
+  // Unsorted keys are sorted in memory or with spilled runs.
+  TestSortedKeyFeeder(dawgdic::SortedKeyFeeder::KEEP_FIRST, 1, 1 << 20, "");
+  TestSortedKeyFeeder(dawgdic::SortedKeyFeeder::KEEP_LAST, 2, 1 << 20, "");
+  TestSortedKeyFeeder(dawgdic::SortedKeyFeeder::KEEP_MAX, 2, 1 << 12, "");
+  TestSortedKeyFeeder(dawgdic::SortedKeyFeeder::SUM_VALUES, 3, 1 << 12, "");
+
+  // Keys which share a long prefix are also sorted in parallel.
+  TestSortedKeyFeeder(dawgdic::SortedKeyFeeder::KEEP_FIRST, 4, 1 << 20,
+                      "http://www.");
+
+  // Updates of a live dictionary are merged by compactions.
+  TestLiveDictionary();
+
+  // Sets of a handle are replaced while they are read.
+  TestDictionaryHandle();
+
+  dawgdic::ParallelDawgBuilder empty_builder(2);
+  dawgdic::Dawg empty_dawg;
+  assert(empty_builder.Finish(&empty_dawg));
+  assert(empty_dawg.size() == 1);
+
   return 0;
 }
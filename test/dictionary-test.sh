@@ -37,5 +37,92 @@ then
   exit 1
 fi
 
+## Builds a dictionary with worker threads, which must be the same as the
+## dictionary built by a single thread.
+$build_bin -t -j 4 "${test_dir}/lexicon" lexicon-j.dic
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+cmp lexicon.dic lexicon-j.dic
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Builds a dictionary within a memory budget, which must also be the same
+## as the dictionary built in memory. Spilling batches of a dawg is tested by
+## dawg-builder-test, because it exceeds a budget for such a small lexicon.
+$build_bin -t -m 256K "${test_dir}/lexicon" lexicon-m.dic
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+cmp lexicon.dic lexicon-m.dic
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Builds a dictionary from a reversed lexicon with duplicate keys, which
+## are sorted and resolved by dawgdic-build.
+awk '{ lines[NR] = $0 } END { for (i = NR; i > 0; --i) print lines[i] }' \
+  "${test_dir}/lexicon" "${test_dir}/lexicon" | \
+  $build_bin -t -u - lexicon-u.dic
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+cmp lexicon.dic lexicon-u.dic
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Builds a dictionary whose hot region is given by a query log.
+$build_bin -t -p "${test_dir}/query" "${test_dir}/lexicon" lexicon.dic
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Builds the same dictionary within a memory budget.
+$build_bin -t -m 256K -p "${test_dir}/query" "${test_dir}/lexicon" \
+  lexicon-m.dic
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+cmp lexicon.dic lexicon-m.dic
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Finds prefix keys from a lexicon, and checks the result.
+$find_bin lexicon.dic < "${test_dir}/query" > dictionary-result
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+cmp dictionary-result "${test_dir}/dictionary-answer"
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Reads a dictionary into huge pages, and checks the result.
+$find_bin -H - "${test_dir}/query" < lexicon.dic > dictionary-result
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+cmp dictionary-result "${test_dir}/dictionary-answer"
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
 ## Removes temporary files.
-rm -f lexicon.dic dictionary-result
+rm -f lexicon.dic lexicon-j.dic lexicon-m.dic lexicon-u.dic \
+  dictionary-result
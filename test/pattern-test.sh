@@ -0,0 +1,41 @@
+#! /bin/sh
+
+build_bin="${TOP_BUILDDIR:-..}/src/dawgdic-build"
+find_bin="${TOP_BUILDDIR:-..}/src/dawgdic-find"
+test_dir="${TOP_SRCDIR:-..}/test"
+
+if [ ! -f "$build_bin" ]
+then
+  echo "error: $build_bin: not found"
+  exit 1
+fi
+
+if [ ! -f "$find_bin" ]
+then
+  echo "error: $find_bin: not found"
+  exit 1
+fi
+
+## Builds a dictionary with a guide from a lexicon.
+$build_bin -gt "${test_dir}/lexicon" pattern-lexicon.dic
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Finds keys which match patterns.
+$find_bin -p pattern-lexicon.dic < "${test_dir}/pattern-query" > pattern-result
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Checks the result.
+cmp pattern-result "${test_dir}/pattern-answer"
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Removes temporary files.
+rm -f pattern-lexicon.dic pattern-result
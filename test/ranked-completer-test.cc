@@ -1,6 +1,13 @@
+#include <dawgdic/best-value-table.h>
+#include <dawgdic/completion-buffer.h>
 #include <dawgdic/dawg-builder.h>
 #include <dawgdic/dictionary-builder.h>
+#include <dawgdic/fuzzy-ranked-completer.h>
+#include <dawgdic/fuzzy-search.h>
 #include <dawgdic/guide-builder.h>
+#include <dawgdic/ordinal-mapper.h>
+#include <dawgdic/ordinal-table-builder.h>
+#include <dawgdic/pattern-search.h>
 #include <dawgdic/ranked-completer.h>
 #include <dawgdic/ranked-guide-builder.h>
 
@@ -8,6 +15,7 @@
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -103,6 +111,124 @@ bool TestDictionary(const dawgdic::Dictionary &dic,
   return true;
 }
 
+// Looks up more keys than lanes, whose lengths are mixed so that many keys
+// are finished in the same round.
+bool TestMixedBatch(dawgdic::BatchKernel::KernelType kernel_type) {
+  static const std::size_t NUM_QUERIES = 100;
+  static const char * const KEYS[] = { "a", "aa", "aaa" };
+
+  dawgdic::DawgBuilder builder;
+  for (std::size_t i = 0; i < 3; ++i) {
+    builder.Insert(KEYS[i], static_cast<dawgdic::ValueType>(i));
+  }
+  dawgdic::Dawg dawg;
+  dawgdic::Dictionary dic;
+  if (!builder.Finish(&dawg) ||
+      !dawgdic::DictionaryBuilder::Build(dawg, &dic)) {
+    std::cerr << "error: failed to build Dictionary" << std::endl;
+    return false;
+  }
+
+  std::vector<const char *> queries;
+  for (std::size_t i = 0; i < NUM_QUERIES; ++i) {
+    queries.push_back(KEYS[(i * 7) % 3]);
+  }
+  std::vector<dawgdic::ValueType> values(queries.size());
+  dic.FindBatch(&queries[0], NULL, queries.size(), &values[0], kernel_type);
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    if (values[i] != dic.Find(queries[i])) {
+      std::cerr << "error: wrong batch value: " << queries[i] << ": "
+        << values[i] << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TestBatch(const dawgdic::Dictionary &dic,
+               const std::vector<std::string> &keys,
+               dawgdic::BatchKernel::KernelType kernel_type) {
+  if (!TestMixedBatch(kernel_type)) {
+    return false;
+  }
+
+  // Mixes registered keys with their prefixes, which are not registered.
+  std::vector<const char *> queries;
+  std::vector<std::size_t> lengths;
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    queries.push_back(keys[i].c_str());
+    lengths.push_back(keys[i].length() - (i % 2));
+  }
+
+  std::vector<dawgdic::ValueType> values(queries.size());
+  dic.FindBatch(&queries[0], &lengths[0], queries.size(), &values[0],
+                kernel_type);
+
+  bool *results = new bool[queries.size()];
+  dic.ContainsBatch(&queries[0], NULL, queries.size(), results, kernel_type);
+
+  bool is_valid = true;
+
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    dawgdic::ValueType value = dic.Find(queries[i], lengths[i]);
+    if (values[i] != value) {
+      std::cerr << "error: wrong batch value: "
+        << values[i] << '/' << value << std::endl;
+      is_valid = false;
+      break;
+    } else if (!results[i]) {
+      std::cerr << "error: failed to find key in batch: "
+        << keys[i] << std::endl;
+      is_valid = false;
+      break;
+    }
+  }
+  delete [] results;
+  return is_valid;
+}
+
+bool TestOrdinal(const std::vector<std::string> &keys) {
+  // Values are not needed, so all the keys have the same value.
+  dawgdic::DawgBuilder builder;
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    builder.Insert(keys[i].c_str());
+  }
+  dawgdic::Dawg dawg;
+  builder.Finish(&dawg);
+
+  dawgdic::Dictionary dic;
+  dawgdic::OrdinalTable table;
+  if (!dawgdic::DictionaryBuilder::Build(dawg, &dic) ||
+      !dawgdic::OrdinalTableBuilder::Build(dawg, dic, &table)) {
+    std::cerr << "error: failed to build OrdinalTable" << std::endl;
+    return false;
+  } else if (table.num_of_keys() != keys.size()) {
+    std::cerr << "error: wrong number of ordinals: "
+      << table.num_of_keys() << '/' << keys.size() << std::endl;
+    return false;
+  }
+
+  dawgdic::OrdinalMapper mapper(dic, table);
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    dawgdic::BaseType id;
+    if (!mapper.Rank(keys[i].c_str(), &id) || id != i) {
+      std::cerr << "error: wrong ordinal: " << keys[i] << std::endl;
+      return false;
+    } else if (!mapper.Select(id) || keys[i] != mapper.key()) {
+      std::cerr << "error: wrong key: " << id << std::endl;
+      return false;
+    }
+  }
+
+  dawgdic::BaseType id;
+  if (mapper.Rank(keys[0].c_str(), keys[0].length() - 1, &id) ||
+      mapper.Select(static_cast<dawgdic::BaseType>(keys.size()))) {
+    std::cerr << "error: found a missing ordinal" << std::endl;
+    return false;
+  }
+  return true;
+}
+
 bool TestCompleter(const dawgdic::Dictionary &dic,
                    const dawgdic::RankedGuide &guide,
                    const std::vector<std::string> &keys,
@@ -134,6 +260,397 @@ bool TestCompleter(const dawgdic::Dictionary &dic,
   return true;
 }
 
+bool TestTopK(const dawgdic::Dictionary &dic,
+              const dawgdic::RankedGuide &guide,
+              const std::vector<int> &values) {
+  static const std::size_t K = 10;
+
+  dawgdic::RankedCompleterBase<Comparer> completer(dic, guide,
+                                                   Comparer(values));
+  dawgdic::RankedCompleterBase<Comparer> top_k_completer(dic, guide,
+                                                         Comparer(values));
+  top_k_completer.Reserve(1 << 10);
+  dawgdic::CompletionBuffer results;
+  results.Reserve(K, K * (KEY_LENGTH + 1));
+  std::size_t memory_usage = results.memory_usage();
+
+  for (char first_label = 'A'; first_label <= 'Z'; ++first_label) {
+    dawgdic::BaseType index = dic.root();
+    if (!dic.Follow(first_label, &index)) {
+      continue;
+    }
+
+    // Top-k keys must be the first keys given by Next().
+    std::size_t num_of_results =
+        top_k_completer.TopK(index, &first_label, 1, K, &results);
+    completer.Start(index, &first_label, 1);
+    for (std::size_t i = 0; i < num_of_results; ++i) {
+      if (!completer.Next() || completer.key() !=
+          std::string(results.key(i), results.length(i)) ||
+          completer.value() != results.value(i)) {
+        std::cerr << "error: wrong top-k key: " << results.key(i)
+          << std::endl;
+        return false;
+      }
+    }
+    if (num_of_results < K && completer.Next()) {
+      std::cerr << "error: too few top-k keys: " << num_of_results
+        << std::endl;
+      return false;
+    }
+
+    // The number of nodes is limited.
+    static const std::size_t MAX_NUM_OF_NODES = 16;
+    top_k_completer.TopK(index, &first_label, 1, K, &results,
+                         MAX_NUM_OF_NODES);
+    if (top_k_completer.num_of_nodes() >
+        MAX_NUM_OF_NODES + KEY_LENGTH * 2) {
+      std::cerr << "error: too many nodes: "
+        << top_k_completer.num_of_nodes() << std::endl;
+      return false;
+    }
+  }
+
+  // Buffers do not grow after reserving memory.
+  if (results.memory_usage() != memory_usage) {
+    std::cerr << "error: buffer has grown: "
+      << results.memory_usage() << '/' << memory_usage << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Completes keys with a threshold, which prunes subtrees by best values.
+bool TestBestValues(const std::vector<std::string> &keys,
+                    const std::vector<int> &values) {
+  dawgdic::DawgBuilder builder;
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    builder.Insert(keys[i].c_str(), static_cast<dawgdic::ValueType>(i));
+  }
+  dawgdic::Dawg dawg;
+  builder.Finish(&dawg);
+
+  dawgdic::Dictionary dic;
+  dawgdic::RankedGuide guide;
+  dawgdic::BestValueTable table;
+  if (!dawgdic::DictionaryBuilder::Build(dawg, &dic) ||
+      !dawgdic::RankedGuideBuilder::Build(dawg, dic, &guide, &table,
+                                          Comparer(values))) {
+    std::cerr << "error: failed to build BestValueTable" << std::endl;
+    return false;
+  } else if (table.size() != dic.size()) {
+    std::cerr << "error: wrong table size: " << table.size() << std::endl;
+    return false;
+  }
+
+  // A key whose value is used as a threshold.
+  static const int MIN_VALUE = MAX_VALUE * 9 / 10;
+  dawgdic::ValueType min_value = 0;
+  while (values[min_value] != MIN_VALUE) {
+    ++min_value;
+  }
+
+  dawgdic::RankedCompleterBase<Comparer> completer(dic, guide,
+                                                   Comparer(values));
+  dawgdic::RankedCompleterBase<Comparer> pruned_completer(dic, guide,
+                                                          Comparer(values));
+  pruned_completer.set_table(table);
+  pruned_completer.set_min_value(min_value);
+  std::size_t num_of_nodes = 0;
+  std::size_t num_of_pruned_nodes = 0;
+  for (char first_label = 'A'; first_label <= 'Z'; ++first_label) {
+    dawgdic::BaseType index = dic.root();
+    if (!dic.Follow(first_label, &index)) {
+      continue;
+    }
+
+    // The best value under a prefix is the value of the first key.
+    dawgdic::ValueType best_value;
+    completer.Start(index, &first_label, 1);
+    if (!table.Find(dic, &first_label, 1, &best_value) ||
+        !completer.Next() || values[best_value] != values[completer.value()]) {
+      std::cerr << "error: wrong best value: " << first_label << std::endl;
+      return false;
+    }
+
+    std::set<std::string> expected_keys;
+    completer.Start(index, &first_label, 1);
+    while (completer.Next() && values[completer.value()] >= MIN_VALUE) {
+      expected_keys.insert(completer.key());
+    }
+    num_of_nodes += completer.num_of_nodes();
+
+    std::set<std::string> pruned_keys;
+    pruned_completer.Start(index, &first_label, 1);
+    while (pruned_completer.Next()) {
+      pruned_keys.insert(pruned_completer.key());
+    }
+    num_of_pruned_nodes += pruned_completer.num_of_nodes();
+    if (pruned_keys != expected_keys) {
+      std::cerr << "error: wrong pruned keys: " << pruned_keys.size()
+        << '/' << expected_keys.size() << std::endl;
+      return false;
+    }
+  }
+  if (num_of_pruned_nodes >= num_of_nodes) {
+    std::cerr << "error: no node is pruned: " << num_of_pruned_nodes
+      << '/' << num_of_nodes << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// Finds edit distances between a prefix and prefixes of a key. The last
+// distance is returned if is_prefix is false, or else the least distance.
+std::size_t FindDistance(const std::string &prefix, const std::string &key,
+                         bool is_prefix = false) {
+  std::vector<std::size_t> row(prefix.length() + 1);
+  std::vector<std::size_t> next_row(prefix.length() + 1);
+  for (std::size_t i = 0; i < row.size(); ++i) {
+    row[i] = i;
+  }
+  std::size_t distance = row.back();
+  for (std::size_t i = 0; i < key.length(); ++i) {
+    next_row[0] = row[0] + 1;
+    for (std::size_t j = 1; j < row.size(); ++j) {
+      next_row[j] = std::min(std::min(row[j], next_row[j - 1]) + 1,
+                             row[j - 1] + (prefix[j - 1] != key[i]));
+    }
+    distance = is_prefix ? std::min(distance, next_row.back()) :
+        next_row.back();
+    row.swap(next_row);
+  }
+  return distance;
+}
+
+// Completes keys from prefixes with typos, and compares them with keys
+// found by brute force.
+bool TestFuzzy(const dawgdic::Dictionary &dic,
+               const dawgdic::RankedGuide &guide,
+               const std::vector<std::string> &keys,
+               const std::vector<int> &values) {
+  static const std::size_t NUM_QUERIES = 16;
+  static const std::size_t PREFIX_LENGTH = 5;
+
+  dawgdic::FuzzyRankedCompleterBase<Comparer> completer(dic, guide,
+                                                        Comparer(values));
+  if (completer.Start("A", dawgdic::FuzzyRankedCompleter::MAX_DISTANCE + 1)) {
+    std::cerr << "error: too large distance is accepted" << std::endl;
+    return false;
+  }
+
+  for (std::size_t query_id = 0; query_id < NUM_QUERIES; ++query_id) {
+    // Replaces a label of a prefix of a key.
+    std::string prefix =
+        keys[std::rand() % keys.size()].substr(0, PREFIX_LENGTH);
+    prefix[std::rand() % prefix.length()] = 'A' + (std::rand() % 26);
+    std::size_t max_distance = 1 + (query_id % 2);
+
+    std::set<std::string> expected_keys;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      if (FindDistance(prefix, keys[i], true) <= max_distance) {
+        expected_keys.insert(keys[i]);
+      }
+    }
+
+    std::set<std::string> found_keys;
+    completer.Start(prefix.c_str(), max_distance);
+    dawgdic::ValueType prev_value = -1;
+    while (completer.Next()) {
+      std::string key(completer.key(), completer.length());
+      if (!found_keys.insert(key).second) {
+        std::cerr << "error: repeated key: " << key << std::endl;
+        return false;
+      } else if (prev_value != -1 && values[completer.value()] >
+                 values[prev_value]) {
+        std::cerr << "error: wrong order: " << key << std::endl;
+        return false;
+      } else if (completer.distance() != FindDistance(prefix, key, true)) {
+        std::cerr << "error: wrong distance: " << key << ": "
+          << completer.distance() << std::endl;
+        return false;
+      }
+      prev_value = completer.value();
+    }
+    if (found_keys != expected_keys) {
+      std::cerr << "error: wrong fuzzy keys: " << prefix << ": "
+        << found_keys.size() << '/' << expected_keys.size() << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Finds keys within edit distances of words, and compares them with keys
+// found by brute force.
+bool TestFuzzySearch(const std::vector<std::string> &keys) {
+  static const std::size_t NUM_QUERIES = 32;
+
+  dawgdic::DawgBuilder builder;
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    builder.Insert(keys[i].c_str(), static_cast<dawgdic::ValueType>(i));
+  }
+  dawgdic::Dawg dawg;
+  builder.Finish(&dawg);
+
+  dawgdic::Dictionary dic;
+  dawgdic::Guide guide;
+  if (!dawgdic::DictionaryBuilder::Build(dawg, &dic) ||
+      !dawgdic::GuideBuilder::Build(dawg, dic, &guide)) {
+    std::cerr << "error: failed to build Guide" << std::endl;
+    return false;
+  }
+
+  dawgdic::FuzzySearch search(dic, guide);
+  dawgdic::CompletionBuffer results;
+  std::string long_word(dawgdic::FuzzySearch::MAX_LENGTH + 1, 'A');
+  if (search.Find(long_word.c_str(), 1, &results)) {
+    std::cerr << "error: too long word is accepted" << std::endl;
+    return false;
+  }
+
+  for (std::size_t query_id = 0; query_id < NUM_QUERIES; ++query_id) {
+    // Replaces, inserts or removes a label of a key.
+    std::string word = keys[std::rand() % keys.size()];
+    std::size_t pos = std::rand() % word.length();
+    switch (query_id % 3) {
+      case 0: {
+        word[pos] = 'A' + (std::rand() % 26);
+        break;
+      }
+      case 1: {
+        word.insert(pos, 1, 'A' + (std::rand() % 26));
+        break;
+      }
+      case 2: {
+        word.erase(pos, 1);
+        break;
+      }
+    }
+    std::size_t max_distance = query_id % 3;
+
+    std::set<std::pair<std::string, std::size_t> > expected_keys;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      std::size_t distance = FindDistance(word, keys[i]);
+      if (distance <= max_distance) {
+        expected_keys.insert(std::make_pair(keys[i], distance));
+      }
+    }
+
+    std::set<std::pair<std::string, std::size_t> > found_keys;
+    search.Find(word.c_str(), max_distance, &results);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      std::string key(results.key(i), results.length(i));
+      if (keys[results.value(i)] != key) {
+        std::cerr << "error: wrong value: " << key << std::endl;
+        return false;
+      }
+      found_keys.insert(std::make_pair(key, search.distance(i)));
+    }
+    if (found_keys != expected_keys) {
+      std::cerr << "error: wrong fuzzy search: " << word << ": "
+        << found_keys.size() << '/' << expected_keys.size() << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Checks if a key matches a pattern of labels, '?' and '*'.
+bool MatchPattern(const char *pattern, const char *key) {
+  if (*pattern == '\0') {
+    return *key == '\0';
+  } else if (*pattern == '*') {
+    return MatchPattern(pattern + 1, key) ||
+        (*key != '\0' && MatchPattern(pattern, key + 1));
+  }
+  return *key != '\0' && (*pattern == '?' || *pattern == *key) &&
+      MatchPattern(pattern + 1, key + 1);
+}
+
+// Finds keys which match patterns, and compares them with keys found by
+// brute force. A selective pattern must not visit the whole dictionary.
+bool TestPatternSearch(const std::vector<std::string> &keys) {
+  static const std::size_t NUM_QUERIES = 32;
+
+  dawgdic::DawgBuilder builder;
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    builder.Insert(keys[i].c_str(), static_cast<dawgdic::ValueType>(i));
+  }
+  dawgdic::Dawg dawg;
+  builder.Finish(&dawg);
+
+  dawgdic::Dictionary dic;
+  dawgdic::Guide guide;
+  if (!dawgdic::DictionaryBuilder::Build(dawg, &dic) ||
+      !dawgdic::GuideBuilder::Build(dawg, dic, &guide)) {
+    std::cerr << "error: failed to build Guide" << std::endl;
+    return false;
+  }
+
+  dawgdic::PatternSearch search(dic, guide);
+  dawgdic::CompletionBuffer results;
+  if (search.Find("[A-", &results) || search.Find("A\\", 2, &results)) {
+    std::cerr << "error: invalid pattern is accepted" << std::endl;
+    return false;
+  }
+  search.Find("*", &results);
+  std::size_t num_of_states = search.num_of_states();
+  if (results.size() != keys.size()) {
+    std::cerr << "error: wrong number of keys: " << results.size()
+      << std::endl;
+    return false;
+  }
+
+  for (std::size_t query_id = 0; query_id < NUM_QUERIES; ++query_id) {
+    // Replaces labels of a key with wildcards.
+    std::string pattern = keys[std::rand() % keys.size()];
+    for (std::size_t i = 0; i < pattern.length(); ++i) {
+      switch (std::rand() % 4) {
+        case 0: {
+          pattern[i] = '?';
+          break;
+        }
+        case 1: {
+          pattern[i] = '*';
+          break;
+        }
+      }
+    }
+
+    std::set<std::pair<std::string, dawgdic::ValueType> > expected_keys;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      if (MatchPattern(pattern.c_str(), keys[i].c_str())) {
+        expected_keys.insert(std::make_pair(
+            keys[i], static_cast<dawgdic::ValueType>(i)));
+      }
+    }
+
+    std::set<std::pair<std::string, dawgdic::ValueType> > found_keys;
+    if (!search.Find(pattern.c_str(), &results)) {
+      std::cerr << "error: failed to find pattern: " << pattern << std::endl;
+      return false;
+    }
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      found_keys.insert(std::make_pair(
+          std::string(results.key(i), results.length(i)), results.value(i)));
+    }
+    if (found_keys != expected_keys) {
+      std::cerr << "error: wrong pattern search: " << pattern << ": "
+        << found_keys.size() << '/' << expected_keys.size() << std::endl;
+      return false;
+    }
+  }
+
+  search.Find("[AB]?C*", &results);
+  if (search.num_of_states() * 10 > num_of_states) {
+    std::cerr << "error: too many states: " << search.num_of_states()
+      << '/' << num_of_states << std::endl;
+    return false;
+  }
+  return true;
+}
+
 }  // namespace
 
 int main() {
@@ -160,8 +677,45 @@ int main() {
     return 3;
   }
 
+  // Compares batch lookups with each kernel which runs on the CPU.
+  const dawgdic::BatchKernel::KernelType kernels[] = {
+    dawgdic::BatchKernel::SCALAR_KERNEL,
+    dawgdic::BatchKernel::AVX2_KERNEL,
+    dawgdic::BatchKernel::AVX512_KERNEL
+  };
+  for (std::size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); ++i) {
+    if (dawgdic::BatchKernel::IsSupported(kernels[i]) &&
+        !TestBatch(dic, keys, kernels[i])) {
+      return 4;
+    }
+  }
+
   if (!TestCompleter(dic, guide, keys, values)) {
-    return 4;
+    return 5;
+  }
+
+  if (!TestOrdinal(keys)) {
+    return 6;
+  }
+
+  if (!TestTopK(dic, guide, values)) {
+    return 7;
+  }
+
+  if (!TestBestValues(keys, values)) {
+    return 8;
+  }
+
+  if (!TestFuzzy(dic, guide, keys, values)) {
+    return 9;
+  }
+
+  if (!TestFuzzySearch(keys)) {
+    return 10;
+  }
+
+  if (!TestPatternSearch(keys)) {
+    return 11;
   }
 
   return 0;
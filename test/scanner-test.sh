@@ -0,0 +1,43 @@
+#! /bin/sh
+
+build_bin="${TOP_BUILDDIR:-..}/src/dawgdic-build"
+scan_bin="${TOP_BUILDDIR:-..}/src/dawgdic-scan"
+test_dir="${TOP_SRCDIR:-..}/test"
+
+if [ ! -f "$build_bin" ]
+then
+  echo "error: $build_bin: not found"
+  exit 1
+fi
+
+if [ ! -f "$scan_bin" ]
+then
+  echo "error: $scan_bin: not found"
+  exit 1
+fi
+
+## Builds a dictionary from a lexicon.
+$build_bin -t "${test_dir}/lexicon" lexicon.dic
+if [ $? -ne 0 ]
+then
+  exit 1
+fi
+
+## Scans a text with different numbers of threads and chunk sizes.
+for options in "-j1" "-j2 -s1" "-j4 -s5" "-j3 -s64"
+do
+  $scan_bin $options lexicon.dic "${test_dir}/query" > scanner-result
+  if [ $? -ne 0 ]
+  then
+    exit 1
+  fi
+
+  cmp scanner-result "${test_dir}/scanner-answer"
+  if [ $? -ne 0 ]
+  then
+    exit 1
+  fi
+done
+
+## Removes temporary files.
+rm -f lexicon.dic scanner-result